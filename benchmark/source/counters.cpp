@@ -0,0 +1,150 @@
+#include <string.h>
+#include "counters.h"
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+PerfCounters::PerfCounters()
+{
+	for (int i = 0; i < COUNT; i++) {
+		fds[i] = -1;
+		values[i] = 0;
+		for (int j = 0; j < 3; j++)
+			startData[i][j] = 0;
+	}
+}
+
+PerfCounters::~PerfCounters()
+{
+	close();
+}
+
+const char* PerfCounters::getName(Counter counter)
+{
+	static const char* names[COUNT] = {
+		"cycles",
+		"instructions",
+		"branch_misses",
+		"l1d_misses",
+		"llc_misses"
+	};
+	return names[counter];
+}
+
+#ifdef __linux__
+
+bool PerfCounters::open()
+{
+	close();
+
+	struct Event {
+		unsigned int type;
+		unsigned long long config;
+	};
+	const Event events[COUNT] = {
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+			(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+			(PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+			(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+			(PERF_COUNT_HW_CACHE_RESULT_MISS << 16) }
+	};
+
+	/* The counters are opened separately, so that an unsupported one does not
+	   disable the others. If the processor multiplexes them, the values are
+	   scaled by the time they were actually counting within the region. */
+	for (int i = 0; i < COUNT; i++) {
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = events[i].type;
+		attr.config = events[i].config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+	}
+
+	return isOpen();
+}
+
+void PerfCounters::close()
+{
+	for (int i = 0; i < COUNT; i++) {
+		if (fds[i] >= 0)
+			::close(fds[i]);
+		fds[i] = -1;
+	}
+}
+
+void PerfCounters::start()
+{
+	for (int i = 0; i < COUNT; i++) {
+		if (fds[i] < 0) continue;
+		ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+		if (read(fds[i], startData[i], sizeof(startData[i])) != sizeof(startData[i]))
+			memset(startData[i], 0, sizeof(startData[i]));
+		ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+}
+
+void PerfCounters::stop()
+{
+	for (int i = 0; i < COUNT; i++) {
+		if (fds[i] >= 0)
+			ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+	}
+
+	for (int i = 0; i < COUNT; i++) {
+		values[i] = 0;
+		if (fds[i] < 0) continue;
+
+		/* value, time enabled, time running, less those at start */
+		unsigned long long data[3];
+		if (read(fds[i], data, sizeof(data)) != sizeof(data))
+			continue;
+		unsigned long long value = data[0] - startData[i][0];
+		unsigned long long enabled = data[1] - startData[i][1];
+		unsigned long long running = data[2] - startData[i][2];
+		if (running == 0)
+			continue;
+		values[i] = static_cast<double>(value) * enabled / running;
+	}
+}
+
+#else
+
+bool PerfCounters::open()
+{
+	return false;
+}
+
+void PerfCounters::close()
+{
+}
+
+void PerfCounters::start()
+{
+}
+
+void PerfCounters::stop()
+{
+}
+
+#endif
+
+bool PerfCounters::isOpen() const
+{
+	for (int i = 0; i < COUNT; i++) {
+		if (fds[i] >= 0)
+			return true;
+	}
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+/* Hardware performance counters around a measured region, read through
+   perf_event_open. Only available on Linux; elsewhere (or when the kernel
+   does not allow it) no counter is opened and the harness reports only the
+   timings. Counters that the processor does not support are skipped. */
+class PerfCounters
+{
+public:
+	enum Counter {
+		CYCLES = 0,
+		INSTRUCTIONS = 1,
+		BRANCH_MISSES = 2,
+		L1D_MISSES = 3,
+		LLC_MISSES = 4,
+		COUNT = 5
+	};
+
+	PerfCounters();
+	~PerfCounters();
+
+	bool open();
+	void close();
+	bool isOpen() const;
+	bool isAvailable(Counter counter) const { return fds[counter] >= 0; }
+	void start();
+	void stop();
+	double getValue(Counter counter) const { return values[counter]; }
+	static const char* getName(Counter counter);
+
+protected:
+	int fds[COUNT];
+	double values[COUNT];
+
+	/* The value, the time enabled and the time running of every counter at
+	   start; the reset clears only the value, so the times are taken as
+	   differences. */
+	unsigned long long startData[COUNT][3];
+};
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include "harness.h"
+
+static std::atomic<unsigned long long> allocationCount(0);
+
+void* operator new(size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	void* p = malloc(size > 0 ? size : 1);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
+
+Harness::Harness(double minimumTime, const std::string& filter) :
+	minimumTime(minimumTime),
+	filter(filter)
+{
+}
+
+Harness::~Harness()
+{
+}
+
+unsigned long long Harness::getAllocationCount()
+{
+	return allocationCount.load(std::memory_order_relaxed);
+}
+
+bool Harness::enableCounters()
+{
+	return counters.open();
+}
+
+bool Harness::isSelected(const std::string& name) const
+{
+	return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+void Harness::run(const std::string& name, const Operation& operation)
+{
+	if (!isSelected(name))
+		return;
+
+	/* Warm up the caches and the lazily allocated buffers. */
+	operation(1);
+
+	/* Grow the number of operations until the run is long enough. */
+	long long n = 1;
+	double seconds = 0;
+	unsigned long long allocations = 0;
+	for (;;) {
+		unsigned long long allocationsBefore = getAllocationCount();
+		counters.start();
+		auto start = std::chrono::steady_clock::now();
+		operation(n);
+		auto end = std::chrono::steady_clock::now();
+		counters.stop();
+		allocations = getAllocationCount() - allocationsBefore;
+		seconds = std::chrono::duration<double>(end - start).count();
+		if (seconds >= minimumTime || n >= 1000000000LL)
+			break;
+
+		double factor = (seconds > 0 ? 1.2 * minimumTime / seconds : 100);
+		if (factor < 2) factor = 2;
+		if (factor > 100) factor = 100;
+		n = static_cast<long long>(n * factor);
+	}
+
+	Result result;
+	result.name = name;
+	result.operations = n;
+	result.seconds = seconds;
+	result.nsPerOperation = seconds * 1e9 / n;
+	result.operationsPerSecond = (seconds > 0 ? n / seconds : 0);
+	result.allocationsPerOperation = static_cast<double>(allocations) / n;
+	for (int i = 0; i < PerfCounters::COUNT; i++) {
+		PerfCounters::Counter counter = static_cast<PerfCounters::Counter>(i);
+		result.counted[i] = counters.isAvailable(counter);
+		result.countersPerOperation[i] = counters.getValue(counter) / n;
+	}
+	results.push_back(result);
+
+	fprintf(stderr, "%-40s %12.1f ns/op %14.0f op/s %8.3f allocs/op",
+		name.c_str(),
+		result.nsPerOperation,
+		result.operationsPerSecond,
+		result.allocationsPerOperation
+	);
+	if (result.counted[PerfCounters::CYCLES] && result.counted[PerfCounters::INSTRUCTIONS]) {
+		fprintf(stderr, " %6.2f IPC",
+			getIpc(result)
+		);
+	}
+	if (result.counted[PerfCounters::BRANCH_MISSES])
+		fprintf(stderr, " %8.2f br-miss/op", result.countersPerOperation[PerfCounters::BRANCH_MISSES]);
+	if (result.counted[PerfCounters::L1D_MISSES])
+		fprintf(stderr, " %8.2f L1-miss/op", result.countersPerOperation[PerfCounters::L1D_MISSES]);
+	if (result.counted[PerfCounters::LLC_MISSES])
+		fprintf(stderr, " %8.2f LLC-miss/op", result.countersPerOperation[PerfCounters::LLC_MISSES]);
+	fprintf(stderr, "\n");
+}
+
+double Harness::getIpc(const Result& result)
+{
+	double cycles = result.countersPerOperation[PerfCounters::CYCLES];
+	return (cycles > 0 ? result.countersPerOperation[PerfCounters::INSTRUCTIONS] / cycles : 0);
+}
+
+std::string Harness::toJson() const
+{
+	std::string json = "{\n  \"benchmarks\": [";
+	char line[512];
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result& result = results[i];
+		snprintf(line, sizeof(line),
+			"%s\n    {\"name\": \"%s\", \"operations\": %lld, \"seconds\": %.6f, "
+			"\"ns_per_op\": %.3f, \"ops_per_second\": %.1f, \"allocations_per_op\": %.6f",
+			(i > 0 ? "," : ""),
+			result.name.c_str(),
+			result.operations,
+			result.seconds,
+			result.nsPerOperation,
+			result.operationsPerSecond,
+			result.allocationsPerOperation
+		);
+		json += line;
+
+		/* Only the counters that were available are reported. */
+		for (int c = 0; c < PerfCounters::COUNT; c++) {
+			if (!result.counted[c]) continue;
+			snprintf(line, sizeof(line), ", \"%s_per_op\": %.3f",
+				PerfCounters::getName(static_cast<PerfCounters::Counter>(c)),
+				result.countersPerOperation[c]
+			);
+			json += line;
+		}
+		if (result.counted[PerfCounters::CYCLES] && result.counted[PerfCounters::INSTRUCTIONS]) {
+			snprintf(line, sizeof(line), ", \"ipc\": %.3f", getIpc(result));
+			json += line;
+		}
+		json += "}";
+	}
+	json += "\n  ]\n}\n";
+	return json;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include "counters.h"
+
+/* Runs the measured regions and collects the results. An operation is
+   repeated until it has run for at least the minimum time. The allocations
+   are counted by the global operator new, which the harness replaces. If
+   enabled, the hardware counters are read around the measured region. */
+class Harness
+{
+public:
+	struct Result {
+		std::string name;
+		long long operations;
+		double seconds;
+		double nsPerOperation;
+		double operationsPerSecond;
+		double allocationsPerOperation;
+		bool counted[PerfCounters::COUNT];
+		double countersPerOperation[PerfCounters::COUNT];
+	};
+
+	/* Runs the measured operation the given number of times. */
+	typedef std::function<void(long long)> Operation;
+
+	Harness() = delete;
+	Harness(double minimumTime, const std::string& filter);
+	~Harness();
+
+	bool enableCounters();
+	bool isSelected(const std::string& name) const;
+	void run(const std::string& name, const Operation& operation);
+	std::string toJson() const;
+
+	static unsigned long long getAllocationCount();
+	static double getIpc(const Result& result);
+
+protected:
+	double minimumTime;
+	std::string filter;
+	PerfCounters counters;
+	std::vector<Result> results;
+};
\ No newline at end of file
@@ -0,0 +1,928 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "harness.h"
+#include "engine.h"
+#include "physics.h"
+#include "terrain.h"
+#include "logchannel.h"
+#include "logstore.h"
+#include "arena.h"
+#include "philox.h"
+#include "randomizer.h"
+#include "batchsimulator.h"
+#include "episodebatch.h"
+#include "rollout.h"
+#include "trajectoryoptimizer.h"
+#include "policy.h"
+#include "transitiontable.h"
+#include "rolloutbuffer.h"
+#include "framestream.h"
+#ifdef _WIN32
+#include <Windows.h>
+#include "simulator.h"
+#include "recording.h"
+#endif
+
+static volatile double sink = 0;
+
+/* Terrains of growing complexity. The crater lists end with a zero width. */
+struct TerrainCase {
+	const char* name;
+	std::vector<Engine::Crater> craters;
+};
+
+static std::vector<TerrainCase> createTerrains()
+{
+	std::vector<TerrainCase> terrains(3);
+	terrains[0].name = "flat";
+	terrains[0].craters.push_back({ 0, 0, 0 });
+
+	terrains[1].name = "crater";
+	terrains[1].craters.push_back({ 0, 10, 1 });
+	terrains[1].craters.push_back({ 0, 0, 0 });
+
+	/* Craters side by side, as many as fit between -100 and 100 m. */
+	terrains[2].name = "craters1000";
+	double width = 200.0 / 1000;
+	for (int i = 0; i < 1000; i++)
+		terrains[2].craters.push_back({ -100 + width * (i + 0.5), width * 0.99, width / 10 });
+	terrains[2].craters.push_back({ 0, 0, 0 });
+
+	return terrains;
+}
+
+/* Positions of the cart spread over the terrain in a fixed pseudo-random order,
+   so that the branches of the floor lookup are not trivially predicted. */
+static std::vector<double> createPositions(int count)
+{
+	std::vector<double> positions(count);
+	unsigned int seed = 12345;
+	for (int i = 0; i < count; i++) {
+		seed = seed * 1664525 + 1013904223;
+		positions[i] = -95 + 190 * (seed >> 8) / 16777216.0;
+	}
+	return positions;
+}
+
+static void benchmarkCart(Harness& harness)
+{
+	harness.run("cart/tick", [](long long n) {
+		CartPhysics cart;
+		cart.reset(0, 0, 0, 0.1, 0, 0);
+		double F = 1;
+		for (long long i = 0; i < n; i++) {
+			cart.tick(F, 0.02);
+			F = -F;
+		}
+		sink = cart.theta;
+	});
+}
+
+static void benchmarkTerrain(Harness& harness, const std::vector<TerrainCase>& terrains)
+{
+	const std::vector<double> positions = createPositions(1024);
+
+	/* One segment of the slope of a crater. */
+	harness.run("terrain/bezier_y", [&positions](long long n) {
+		Point point(-4, 0);
+		Bezier bezier(Point(-3.5, 0), Point(-2.5, -0.5));
+		double sum = 0;
+		for (long long i = 0; i < n; i++) {
+			double y = 0;
+			Terrain::computeBezierY(point, bezier, -4 + 1.5 * (i & 1023) / 1024.0, y);
+			sum += y;
+		}
+		sink = sum;
+	});
+
+	for (const TerrainCase& terrainCase : terrains) {
+		Terrain terrain;
+		terrain.compute(&terrainCase.craters[0]);
+		std::string suffix = std::string("/") + terrainCase.name;
+
+		harness.run("terrain/floor_height" + suffix, [&terrain, &positions](long long n) {
+			double sum = 0;
+			for (long long i = 0; i < n; i++)
+				sum += terrain.getFloorHeight(positions[i & 1023]);
+			sink = sum;
+		});
+
+		harness.run("terrain/cart_angle" + suffix, [&terrain, &positions](long long n) {
+			CartPhysics cart;
+			double r = cart.getWheelDistance() / 2;
+			double sum = 0;
+			for (long long i = 0; i < n; i++) {
+				double ycorrection = 0;
+				sum += terrain.computeCartAngle(positions[i & 1023], r, 0.01, ycorrection);
+			}
+			sink = sum;
+		});
+
+		harness.run("terrain/align" + suffix, [&terrain, &positions](long long n) {
+			CartPhysics cart;
+			for (long long i = 0; i < n; i++) {
+				cart.x = positions[i & 1023];
+				terrain.align(cart);
+			}
+			sink = cart.phi;
+		});
+
+		harness.run("terrain/align_lanes" + suffix, [&terrain, &positions](long long n) {
+			const int count = 1024;
+			double wheelDistance = CartPhysics().getWheelDistance();
+			std::vector<double> y(count);
+			std::vector<double> phi(count);
+			for (long long i = 0; i < n; i += count)
+				terrain.alignLanes(count, &positions[0], wheelDistance, &y[0], &phi[0]);
+			sink = phi[0];
+		});
+	}
+}
+
+/* Filling a container of episode-sized data and dropping it, from the heap and
+   from an arena that is released as a whole. */
+static void benchmarkArena(Harness& harness)
+{
+	const int count = 1000;
+	harness.run("episode_data/heap", [count](long long n) {
+		for (long long i = 0; i < n; i += count) {
+			std::vector<double> data;
+			for (int j = 0; j < count; j++)
+				data.push_back(j);
+			sink = data.back();
+		}
+	});
+
+	harness.run("episode_data/arena", [count](long long n) {
+		Arena arena(64 * 1024);
+		ArenaAllocator<double> allocator(&arena);
+		for (long long i = 0; i < n; i += count) {
+			{
+				std::vector<double, ArenaAllocator<double>> data(allocator);
+				for (int j = 0; j < count; j++)
+					data.push_back(j);
+				sink = data.back();
+			}
+			arena.release();
+		}
+	});
+}
+
+/* Sampling a new episode for a batch of environments: one block of the
+   generator, and all the physical parameters and the initial state. */
+static void benchmarkRandomizer(Harness& harness)
+{
+	harness.run("random/philox", [](long long n) {
+		uint32_t sum = 0;
+		for (long long i = 0; i < n; i++)
+			sum += Philox::generate(static_cast<uint32_t>(i), 0, 0, 0, 1).v[0];
+		sink = sum;
+	});
+
+	Engine::Randomization randomization = {};
+	randomization.seed = 1;
+	Engine::Distribution uniform = { Engine::DistributionType::UNIFORM_DISTRIBUTION, 0.8, 1.2 };
+	Engine::Distribution normal = { Engine::DistributionType::NORMAL_DISTRIBUTION, 0, 0.05 };
+	randomization.cartMass = uniform;
+	randomization.cartDamping = uniform;
+	randomization.poleMass = uniform;
+	randomization.poleSize = uniform;
+	randomization.poleDamping = uniform;
+	randomization.gravity = { Engine::DistributionType::UNIFORM_DISTRIBUTION, 9.7, 9.9 };
+	randomization.x = normal;
+	randomization.dx = normal;
+	randomization.theta = normal;
+	randomization.dtheta = normal;
+
+	const int count = 1024;
+	std::vector<PhysicalParameters> parameters(count, CartPhysics::getSimulatorParameters());
+	std::vector<Engine::InitialState> states(count);
+	harness.run("randomizer/sample/1024", [&](long long n) {
+		for (long long i = 0; i < n; i += count)
+			Randomizer::sample(randomization, 0, count, static_cast<uint32_t>(i / count), &parameters[0], &states[0]);
+		sink = parameters[0].cartMass + states[0].theta;
+	});
+}
+
+/* The physics of 1024 lanes alone, as the batches step them, with the
+   parameters shared by every lane or with those of every lane read from the
+   columns. One iteration is the tick of one lane. */
+static void benchmarkLanes(Harness& harness)
+{
+	const int count = 1024;
+	const double dt = 0.02;
+	PhysicalParameters uniform = CartPhysics::getSimulatorParameters();
+	PhysicsColumns columns;
+	columns.resize(count);
+	for (int lane = 0; lane < count; lane++) {
+		PhysicalParameters parameters = uniform;
+		parameters.cartMass *= 0.5 + lane / (double)count;
+		parameters.poleMass *= 1.5 - lane / (double)count;
+		parameters.poleLength *= 0.75 + 0.5 * (lane % 7) / 6;
+		columns.set(lane, parameters);
+	}
+
+	std::vector<double> forces(count);
+	std::vector<double> phi(count, 0.0);
+	for (int lane = 0; lane < count; lane++)
+		forces[lane] = (lane % 2 == 0 ? 1 : -1);
+
+	for (int varied = 0; varied < 2; varied++) {
+		std::vector<double> x(count, 0.0), y(count, 0.0), dx(count, 0.0), ddx(count, 0.0);
+		std::vector<double> theta(count, 0.1), dtheta(count, 0.0), ddtheta(count, 0.0);
+		harness.run(std::string("physics/lanes/1024/") + (varied ? "varied" : "uniform"), [&](long long n) {
+			for (long long i = 0; i < n; i += count) {
+				if (varied) {
+					CartPhysics::stepLanes(count, dt, columns, &forces[0], &phi[0],
+						&x[0], &y[0], &dx[0], &ddx[0], &theta[0], &dtheta[0], &ddtheta[0]);
+				}
+				else {
+					CartPhysics::stepLanes(count, dt, uniform, &forces[0], &phi[0],
+						&x[0], &y[0], &dx[0], &ddx[0], &theta[0], &dtheta[0], &ddtheta[0]);
+				}
+				for (int lane = 0; lane < count; lane++)
+					forces[lane] = -forces[lane];
+			}
+			sink = theta[0];
+		});
+	}
+}
+
+/* Stepping a batch of environments, as the C API does; one iteration is the
+   tick of one lane. The episodes end on the default limits of the task. */
+static void benchmarkBatch(Harness& harness, const std::vector<TerrainCase>& terrains)
+{
+	const int count = 1024;
+	Engine::SimulatorParameters simulatorParameters = Engine::simulatorParameters;
+	simulatorParameters.termination.angleLimit = 0.2;
+	simulatorParameters.termination.positionLimit = 2.4;
+	simulatorParameters.termination.maxEpisodeTime = 10;
+
+	std::vector<double> forces(count);
+	std::vector<double> observations(count * BatchSimulator::OBSERVATION_SIZE);
+	std::vector<double> rewards(count);
+	std::vector<uint8_t> dones(count);
+	for (int lane = 0; lane < count; lane++)
+		forces[lane] = (lane % 2 == 0 ? 1 : -1);
+
+	for (const TerrainCase& terrainCase : terrains) {
+		simulatorParameters.craters = &terrainCase.craters[0];
+		BatchSimulator batch(count, simulatorParameters);
+		harness.run(std::string("batch/step/1024/") + terrainCase.name, [&](long long n) {
+			for (long long i = 0; i < n; i += count)
+				batch.step(&forces[0], &observations[0], &rewards[0], &dones[0]);
+			sink = observations[0];
+		});
+
+		/* Every lane with its own masses and pole length. */
+		BatchSimulator varied(count, simulatorParameters);
+		for (int lane = 0; lane < count; lane++) {
+			PhysicalParameters parameters = CartPhysics::getSimulatorParameters();
+			parameters.cartMass *= 0.5 + lane / (double)count;
+			parameters.poleMass *= 1.5 - lane / (double)count;
+			parameters.poleLength *= 0.75 + 0.5 * (lane % 7) / 6;
+			varied.setParameters(lane, parameters);
+		}
+		harness.run(std::string("batch/varied/1024/") + terrainCase.name, [&](long long n) {
+			for (long long i = 0; i < n; i += count)
+				varied.step(&forces[0], &observations[0], &rewards[0], &dones[0]);
+			sink = observations[0];
+		});
+	}
+}
+
+/* Open-loop sequences of 50 forces, as a shooting planner tries them: one cart
+   from a fixed state, and a batch with the lanes in the inner loop. One
+   iteration is the tick of one cart. */
+static void benchmarkSequence(Harness& harness, const std::vector<TerrainCase>& terrains)
+{
+	const int k = 50;
+	const int count = 1024;
+	std::vector<double> forces(count * k);
+	for (int i = 0; i < count * k; i++)
+		forces[i] = ((i / 7) % 2 == 0 ? 1 : -1);
+	std::vector<Engine::SimulationState> trajectory(count * k);
+	PhysicalParameters parameters = CartPhysics::getSimulatorParameters();
+	double dt = 1.0 / Engine::simulatorParameters.actionFrequency;
+
+	Engine::SimulatorParameters simulatorParameters = Engine::simulatorParameters;
+	for (const TerrainCase& terrainCase : terrains) {
+		std::string suffix = std::string("/") + terrainCase.name;
+		Terrain terrain;
+		terrain.compute(&terrainCase.craters[0]);
+		Rollout rollout(terrain, Engine::simulatorParameters.cart.size, dt);
+		harness.run("sequence/rollout/50" + suffix, [&](long long n) {
+			for (long long i = 0; i < n; i += k) {
+				Engine::SimulationState state = { -10, 0, 0, 0, 0, 0.1, 0, 0 };
+				rollout.run(parameters, state, &forces[0], k, &trajectory[0]);
+			}
+			sink = trajectory[k - 1].theta;
+		});
+
+		simulatorParameters.craters = &terrainCase.craters[0];
+		BatchSimulator batch(count, simulatorParameters);
+		harness.run("sequence/batch/1024x50" + suffix, [&](long long n) {
+			for (long long i = 0; i < n; i += count * k)
+				batch.runSequence(&forces[0], k, &trajectory[0]);
+			sink = trajectory[0].theta;
+		});
+	}
+}
+
+/* One control step of a sampling-based planner: 1000 sequences of 50 forces
+   from a state inside the crater (if any), with a cost that keeps the pole up
+   at x = 0. One iteration is the whole evaluation. */
+static void benchmarkEvaluation(Harness& harness, const std::vector<TerrainCase>& terrains)
+{
+	const int m = 1000;
+	const int k = 50;
+	std::vector<double> forces(m * k);
+	unsigned int seed = 12345;
+	for (int i = 0; i < m * k; i++) {
+		seed = seed * 1664525 + 1013904223;
+		forces[i] = -10 + 20 * (seed >> 8) / 16777216.0;
+	}
+	std::vector<double> costs(m);
+
+	Engine::QuadraticCost cost = {};
+	cost.Q[0] = 1;
+	cost.Q[5] = 0.1;
+	cost.Q[10] = 10;
+	cost.Q[15] = 0.1;
+	cost.R = 0.01;
+	for (int i = 0; i < 16; i++)
+		cost.Qf[i] = 10 * cost.Q[i];
+
+	PhysicalParameters parameters = CartPhysics::getSimulatorParameters();
+	double dt = 1.0 / Engine::simulatorParameters.actionFrequency;
+	for (const TerrainCase& terrainCase : terrains) {
+		Terrain terrain;
+		terrain.compute(&terrainCase.craters[0]);
+		Rollout rollout(terrain, Engine::simulatorParameters.cart.size, dt);
+		Engine::SimulationState state = { -2, 0, 0, 0, 0, 0.1, 0, 0 };
+		terrain.align(state.x, 3 * Engine::simulatorParameters.cart.size / 5, state.y, state.phi);
+		harness.run(std::string("mpc/evaluate/1000x50/") + terrainCase.name, [&](long long n) {
+			for (long long i = 0; i < n; i++)
+				rollout.evaluate(parameters, state, &forces[0], m, k, cost, &costs[0]);
+			sink = costs[0];
+		});
+	}
+}
+
+/* A control step of model-predictive control: the plan of the previous step,
+   shifted by one tick, is optimised again from the state it led to. */
+static void benchmarkOptimizer(Harness& harness, const std::vector<TerrainCase>& terrains)
+{
+	const int k = 50;
+	Engine::QuadraticCost cost = {};
+	cost.Q[0] = 1;
+	cost.Q[5] = 0.1;
+	cost.Q[10] = 10;
+	cost.Q[15] = 0.1;
+	cost.R = 0.01;
+	for (int i = 0; i < 16; i++)
+		cost.Qf[i] = 10 * cost.Q[i];
+	Engine::OptimizerSettings settings = { 5, 20, 1e-4 };
+
+	PhysicalParameters parameters = CartPhysics::getSimulatorParameters();
+	double dt = 1.0 / Engine::simulatorParameters.actionFrequency;
+	for (const TerrainCase& terrainCase : terrains) {
+		Terrain terrain;
+		terrain.compute(&terrainCase.craters[0]);
+		Rollout rollout(terrain, Engine::simulatorParameters.cart.size, dt);
+		TrajectoryOptimizer optimizer(terrain, Engine::simulatorParameters.cart.size, dt);
+		Engine::SimulationState start = { -2, 0, 0, 0, 0, 0.1, 0, 0 };
+		terrain.align(start.x, 3 * Engine::simulatorParameters.cart.size / 5, start.y, start.phi);
+		Engine::SimulationState state = start;
+		std::vector<double> forces(k, 0.0);
+		long long tick = 0;
+		harness.run(std::string("mpc/ilqr/50/") + terrainCase.name, [&](long long n) {
+			for (long long i = 0; i < n; i++) {
+				/* A new episode every 5 s, before the cart has settled. */
+				if (tick++ % 250 == 0) {
+					state = start;
+					forces.assign(k, 0.0);
+				}
+				optimizer.optimize(parameters, state, &forces[0], k, cost, settings, nullptr);
+				rollout.run(parameters, state, &forces[0], 1, nullptr);
+				for (int j = 1; j < k; j++)
+					forces[j - 1] = forces[j];
+			}
+			sink = state.theta;
+		});
+	}
+}
+
+/* A 4-64-64-1 tanh network with arbitrary weights, built in memory in the
+   layout of a policy file. */
+static void benchmarkPolicy(Harness& harness)
+{
+	const uint32_t shapes[3][3] = {
+		{ 4, 64, Policy::ACTIVATION_TANH },
+		{ 64, 64, Policy::ACTIVATION_TANH },
+		{ 64, 1, Policy::ACTIVATION_LINEAR }
+	};
+	std::vector<char> file;
+	auto append = [&file](const void* data, size_t size) {
+		file.insert(file.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+	};
+	uint32_t header[3] = { Policy::magic, Policy::version, 3 };
+	append(header, sizeof(header));
+	unsigned int seed = 12345;
+	for (const uint32_t* shape : shapes) {
+		append(shape, 3 * sizeof(uint32_t));
+		for (uint32_t i = 0; i < (shape[0] + 1) * shape[1]; i++) {
+			seed = seed * 1664525 + 1013904223;
+			float value = (-1 + 2 * (seed >> 8) / 16777216.0f) / 8;
+			append(&value, sizeof(value));
+		}
+	}
+
+	Policy policy;
+	std::string error;
+	if (!policy.load(file.data(), file.size(), error)) {
+		fprintf(stderr, "Policy: %s\n", error.c_str());
+		return;
+	}
+
+	const int count = 1024;
+	std::vector<double> observations(count * BatchSimulator::OBSERVATION_SIZE);
+	for (size_t i = 0; i < observations.size(); i++)
+		observations[i] = 0.001 * (i % 997);
+	std::vector<double> forces(count);
+	harness.run("policy/mlp/4x64x64x1/1", [&](long long n) {
+		for (long long i = 0; i < n; i++)
+			forces[0] = policy.evaluate(&observations[0]);
+		sink = forces[0];
+	});
+	harness.run("policy/mlp/4x64x64x1/1024", [&](long long n) {
+		for (long long i = 0; i < n; i++)
+			policy.evaluate(&observations[0], count, BatchSimulator::OBSERVATION_SIZE, &forces[0]);
+		sink = forces[0];
+	});
+}
+
+/* Next-state lookups of tabular methods on a 21 x 21 x 37 x 21 grid with
+   three forces: one tick of the physics and the terrain from the grid point
+   and the cell it reaches, against a read from the tabulated transitions. The
+   walk restarts from the middle of the grid when it leaves it. */
+static void benchmarkTable(Harness& harness, const std::vector<TerrainCase>& terrains)
+{
+	TransitionTable::Grid grid;
+	grid.axes[0] = { -5, 5, 21 };
+	grid.axes[1] = { -5, 5, 21 };
+	grid.axes[2] = { -3.14159265358979323846, 3.14159265358979323846, 37 };
+	grid.axes[3] = { -10, 10, 21 };
+	grid.forces = { -10, 0, 10 };
+	const char* fileName = "benchmark-transitions.bin";
+	PhysicalParameters parameters = CartPhysics::getSimulatorParameters();
+	double dt = 1.0 / Engine::simulatorParameters.actionFrequency;
+	double wheelDistance = 3 * Engine::simulatorParameters.cart.size / 5;
+
+	Engine::SimulatorParameters simulatorParameters = Engine::simulatorParameters;
+	for (const TerrainCase& terrainCase : terrains) {
+		std::string suffix = std::string("/") + terrainCase.name;
+		if (!harness.isSelected("table/tick" + suffix) && !harness.isSelected("table/lookup" + suffix))
+			continue;
+
+		simulatorParameters.craters = &terrainCase.craters[0];
+		TransitionTable table;
+		std::string error;
+		if (!TransitionTable::build(simulatorParameters, grid, 0, fileName, error) || !table.open(fileName, error)) {
+			fprintf(stderr, "Transition table: %s\n", error.c_str());
+			remove(fileName);
+			return;
+		}
+		double middle[4] = { 0, 0, 0, 0 };
+		uint32_t start = table.getCell(middle);
+
+		Terrain terrain;
+		terrain.compute(&terrainCase.craters[0]);
+		Rollout rollout(terrain, Engine::simulatorParameters.cart.size, dt);
+		harness.run("table/tick" + suffix, [&](long long n) {
+			uint32_t cell = start;
+			unsigned int seed = 12345;
+			for (long long i = 0; i < n; i++) {
+				seed = seed * 1664525 + 1013904223;
+				double point[4];
+				table.getState(cell, point);
+				Engine::SimulationState state = { point[0], 0, 0, point[1], 0, point[2], point[3], 0 };
+				if (!terrain.isFlat())
+					terrain.align(state.x, wheelDistance, state.y, state.phi);
+				rollout.run(parameters, state, &grid.forces[(seed >> 16) % 3], 1, nullptr);
+				double reached[4] = { state.x, state.dx, state.theta, state.dtheta };
+				cell = table.getCell(reached);
+				if (cell == TransitionTable::outside)
+					cell = start;
+			}
+			sink = cell;
+		});
+		harness.run("table/lookup" + suffix, [&](long long n) {
+			uint32_t cell = start;
+			unsigned int seed = 12345;
+			for (long long i = 0; i < n; i++) {
+				seed = seed * 1664525 + 1013904223;
+				cell = table.lookup(cell, (seed >> 16) % 3).cell;
+				if (cell == TransitionTable::outside)
+					cell = start;
+			}
+			sink = cell;
+		});
+
+		table.close();
+		remove(fileName);
+	}
+}
+
+/* An evaluation in which 90% of the episodes end early: one environment in
+   ten holds the pole upright with no force until the time limit, the others
+   are pushed out of bounds. One iteration runs all the 1024 episodes, with the
+   ended lanes kept to the end (masked) or compacted away. */
+static void benchmarkEpisodes(Harness& harness, const std::vector<TerrainCase>& terrains)
+{
+	const int count = 1024;
+	Engine::SimulatorParameters simulatorParameters = Engine::simulatorParameters;
+	simulatorParameters.termination.angleLimit = 0.2;
+	simulatorParameters.termination.positionLimit = 2.4;
+	simulatorParameters.termination.maxEpisodeTime = 10;
+	simulatorParameters.termination.action = Engine::SimulationAction::RESET_SIMULATION;
+
+	std::vector<double> forces(count);
+	std::vector<double> observations(count * EpisodeBatch::OBSERVATION_SIZE);
+	std::vector<double> rewards(count);
+	std::vector<uint8_t> dones(count);
+
+	for (const TerrainCase& terrainCase : terrains) {
+		simulatorParameters.craters = &terrainCase.craters[0];
+		EpisodeBatch batch(count, simulatorParameters);
+		auto run = [&](long long n) {
+			for (long long i = 0; i < n; i++) {
+				int lanes = batch.start(&observations[0]);
+				while (lanes > 0) {
+					const int* ids = batch.getIds();
+					for (int lane = 0; lane < lanes; lane++)
+						forces[lane] = (ids[lane] % 10 == 0 ? 0 : (ids[lane] % 2 == 0 ? 20 : -20));
+					lanes = batch.step(&forces[0], &observations[0], &rewards[0], &dones[0]);
+				}
+			}
+			sink = batch.getEpisode(0).episodeReturn;
+		};
+
+		batch.setCompaction(1);
+		harness.run(std::string("episodes/masked/1024/") + terrainCase.name, run);
+		batch.setCompaction(0.125);
+		harness.run(std::string("episodes/compacted/1024/") + terrainCase.name, run);
+	}
+}
+
+/* Writes 100 steps of 1024 environments (about 5 MB) to .npy files and to a
+   .npz archive, the latter with the CRC of every byte. */
+static void benchmarkRolloutBuffer(Harness& harness)
+{
+	if (!harness.isSelected("rollout_buffer/save_npy/1024x100") && !harness.isSelected("rollout_buffer/save_npz/1024x100"))
+		return;
+
+	const int count = 1024;
+	const int steps = 100;
+	RolloutBuffer buffer(steps, count);
+	BatchSimulator batch(count, Engine::simulatorParameters);
+	buffer.reset(batch);
+	while (!buffer.isFull()) {
+		double* actions = buffer.getActions(buffer.getSize());
+		for (int lane = 0; lane < count; lane++)
+			actions[lane] = (lane % 2 == 0 ? 5 : -5);
+		buffer.step(batch);
+	}
+
+	const char* prefix = "benchmark-rollout-";
+	const char* archiveName = "benchmark-rollout.npz";
+	std::string error;
+	harness.run("rollout_buffer/save_npy/1024x100", [&](long long n) {
+		for (long long i = 0; i < n; i++)
+			sink = buffer.saveArrays(prefix, error);
+	});
+	harness.run("rollout_buffer/save_npz/1024x100", [&](long long n) {
+		for (long long i = 0; i < n; i++)
+			sink = buffer.saveArchive(archiveName, error);
+	});
+
+	for (const char* name : { "observations", "actions", "rewards", "dones" })
+		remove((std::string(prefix) + name + ".npy").c_str());
+	remove(archiveName);
+}
+
+/* Writes the frames of 100 steps of 1024 environments as an Arrow stream,
+   against the same frames formatted as in frames.csv. */
+static void benchmarkFrames(Harness& harness)
+{
+	if (!harness.isSelected("frames/arrow/1024x100") && !harness.isSelected("frames/csv/1024x100"))
+		return;
+
+	const int count = 1024;
+	const int steps = 100;
+	BatchSimulator batch(count, Engine::simulatorParameters);
+	std::vector<double> forces(count);
+	for (int lane = 0; lane < count; lane++)
+		forces[lane] = (lane % 2 == 0 ? 5 : -5);
+	std::vector<Engine::SimulationState> trajectory(static_cast<size_t>(steps) * count);
+	std::vector<double> sequence(static_cast<size_t>(steps) * count);
+	for (int i = 0; i < steps; i++)
+		std::copy(forces.begin(), forces.end(), sequence.begin() + static_cast<size_t>(i) * count);
+	batch.runSequence(&sequence[0], steps, &trajectory[0]);
+
+	const char* fileName = "benchmark-frames.arrows";
+	const char* csvName = "benchmark-frames.csv";
+	double dt = batch.getTimeStep();
+	harness.run("frames/arrow/1024x100", [&](long long n) {
+		for (long long i = 0; i < n; i++) {
+			FrameStream stream(65536);
+			stream.open(fileName);
+			for (int step = 0; step < steps; step++) {
+				for (int lane = 0; lane < count; lane++) {
+					const Engine::SimulationState& state = trajectory[static_cast<size_t>(step) * count + lane];
+					stream.add(1, lane, step + 1, step * dt, forces[lane], state.x, state.y, state.theta, state.phi,
+						state.dx, state.ddx, state.dtheta, state.ddtheta, 0, 0, 1);
+				}
+			}
+			sink = stream.close();
+		}
+	});
+	harness.run("frames/csv/1024x100", [&](long long n) {
+		for (long long i = 0; i < n; i++) {
+			FILE* file = fopen(csvName, "w");
+			if (file == nullptr)
+				return;
+			for (int step = 0; step < steps; step++) {
+				for (int lane = 0; lane < count; lane++) {
+					const Engine::SimulationState& state = trajectory[static_cast<size_t>(step) * count + lane];
+					std::string data = std::to_string(step + 1) + ";";
+					data += std::to_string(step * dt) + ";";
+					data += std::to_string(forces[lane]) + ";";
+					data += std::to_string(state.x) + ";";
+					data += std::to_string(state.y) + ";";
+					data += std::to_string(state.theta) + ";";
+					data += std::to_string(state.phi) + ";";
+					data += std::to_string(state.dx) + ";";
+					data += std::to_string(state.ddx) + ";";
+					data += std::to_string(state.dtheta) + ";";
+					data += std::to_string(state.ddtheta) + "\n";
+					fwrite(data.data(), 1, data.length(), file);
+				}
+			}
+			sink = fclose(file);
+		}
+	});
+
+	remove(fileName);
+	remove(csvName);
+}
+
+#ifdef _WIN32
+static void benchmarkSimulator(Harness& harness, const std::vector<TerrainCase>& terrains)
+{
+	/* Without a loaded engine, the default callbacks do nothing. */
+	double dt = 1.0 / Engine::simulatorParameters.actionFrequency;
+	for (const TerrainCase& terrainCase : terrains) {
+		Engine::simulatorParameters.craters = &terrainCase.craters[0];
+		Simulator simulator;
+		simulator.setManualAction(1);
+		harness.run(std::string("simulator/tick/") + terrainCase.name, [&simulator, dt](long long n) {
+			for (long long i = 0; i < n; i++)
+				simulator.tick(dt);
+		});
+	}
+	Engine::simulatorParameters.craters = nullptr;
+}
+
+static void benchmarkRecording(Harness& harness)
+{
+	/* The frames are recorded into a fresh recording every chunk, so that
+	   long runs do not exhaust the memory. */
+	harness.run("recording/snap", [](long long n) {
+		const long long chunk = 100000;
+		Arena arena(1024 * 1024);
+		for (long long i = 0; i < n; i += chunk) {
+			arena.release();
+			Recording recording(50, &arena);
+			long long count = (n - i < chunk ? n - i : chunk);
+			for (long long j = 0; j < count; j++)
+				recording.snap(1, j * 0.01, 0, 0.1, 0, 0.5, 0, 0.1, 0, 0, 0, 1);
+			sink = recording.frameCount();
+		}
+	});
+
+	Arena arena(1024 * 1024);
+	Recording recording(50, &arena);
+	for (int i = 0; i < 1000; i++)
+		recording.snap(1, i * 0.01, 0, 0.1, 0, 0.5, 0, 0.1, 0, 0, 0, 1);
+	if (!recording.createFolder())
+		return;
+
+	harness.run("recording/save_frames_data/1000", [&recording](long long n) {
+		for (long long i = 0; i < n; i++)
+			recording.saveFramesData();
+	});
+
+	std::string fileName = recording.getFolderName() + "\\frames.csv";
+	DeleteFileA(fileName.c_str());
+	RemoveDirectoryA(recording.getFolderName().c_str());
+}
+#endif
+
+/* Compares Philox4x32-10 with the known-answer vectors of Random123
+   (kat_vectors): a zero counter and key, all ones, and the digits of pi. */
+static bool checkPhilox()
+{
+	struct Vector {
+		uint32_t counter[4];
+		uint32_t key[2];
+		uint32_t expected[4];
+	};
+	static const Vector vectors[] = {
+		{ { 0x00000000, 0x00000000, 0x00000000, 0x00000000 }, { 0x00000000, 0x00000000 },
+		  { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+		{ { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff }, { 0xffffffff, 0xffffffff },
+		  { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+		{ { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 }, { 0xa4093822, 0x299f31d0 },
+		  { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } },
+	};
+	bool passed = true;
+	for (const Vector& vector : vectors) {
+		/* The first key word is the low half of the 64-bit key. */
+		uint64_t key = (static_cast<uint64_t>(vector.key[1]) << 32) | vector.key[0];
+		Philox::Block block = Philox::generate(vector.counter[0], vector.counter[1], vector.counter[2], vector.counter[3], key);
+		for (int i = 0; i < 4; i++) {
+			if (block.v[i] != vector.expected[i])
+				passed = false;
+		}
+	}
+	fprintf(stderr, "%-40s %d vectors: %s\n",
+		"random/philox/known-answers",
+		static_cast<int>(sizeof(vectors) / sizeof(vectors[0])),
+		(passed ? "passed" : "FAILED")
+	);
+	return passed;
+}
+
+/* Runs the tick path and fails if it allocates any memory after the warm-up.
+   The log records are drained every few ticks, as the application does. */
+static bool checkAllocations(long long ticks, const std::vector<TerrainCase>& terrains)
+{
+	const long long warmUp = 10000;
+	const int logInterval = 10;
+	bool passed = true;
+	for (const TerrainCase& terrainCase : terrains) {
+		Engine::simulatorParameters.craters = &terrainCase.craters[0];
+		double dt = 1.0 / Engine::simulatorParameters.actionFrequency;
+		LogStore log(1000);
+		char line[LogChannel::lineSize];
+
+#ifdef _WIN32
+		Simulator simulator;
+		simulator.setManualAction(1);
+		auto tick = [&simulator, dt](long long i) {
+			simulator.tick(dt);
+			if (i % 100 == 0)
+				LogChannel::write(Engine::LogLevel::LOG_DEBUG, "tick", &i, sizeof(i));
+			if (i % logInterval == 0)
+				simulator.updateLog();
+		};
+#else
+		/* Without Windows, the portable part of the tick: the physics, the
+		   terrain and the log. */
+		Terrain terrain;
+		terrain.compute(Engine::simulatorParameters.craters);
+		CartPhysics cart;
+		double time = 0;
+		auto tick = [&](long long i) {
+			cart.tick((i / 200) % 2 == 0 ? 1 : -1, dt);
+			terrain.align(cart);
+			if (cart.x < -95 || cart.x > 95)
+				cart.bounce();
+			time += dt;
+			LogChannel::setTime(time);
+			if (i % 100 == 0)
+				LogChannel::write(Engine::LogLevel::LOG_DEBUG, "tick", &i, sizeof(i));
+			if (i % logInterval == 0) {
+				LogChannel::Record record;
+				while (LogChannel::read(record)) {
+					LogChannel::format(record, line, sizeof(line));
+					log.append(line);
+				}
+			}
+		};
+#endif
+
+		for (long long i = 0; i < warmUp; i++)
+			tick(i);
+
+		unsigned long long allocationsBefore = Harness::getAllocationCount();
+		for (long long i = warmUp; i < warmUp + ticks; i++)
+			tick(i);
+		unsigned long long allocations = Harness::getAllocationCount() - allocationsBefore;
+
+		fprintf(stderr, "%-40s %lld ticks, %llu allocations: %s\n",
+			(std::string("allocations/tick/") + terrainCase.name).c_str(),
+			ticks,
+			allocations,
+			(allocations == 0 ? "passed" : "FAILED")
+		);
+		if (allocations > 0)
+			passed = false;
+	}
+	Engine::simulatorParameters.craters = nullptr;
+
+	return passed;
+}
+
+int main(int argc, char** argv)
+{
+	/* Options: -filter <substring>, -time <seconds per benchmark>, -output <file.json>,
+	   -counters (read the hardware performance counters),
+	   -check-allocations [ticks] (fail if the tick path allocates memory) */
+	std::string filter;
+	std::string output;
+	double minimumTime = 0.5;
+	bool useCounters = false;
+	long long checkTicks = 0;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-filter") == 0 && i + 1 < argc)
+			filter = argv[++i];
+		else if (strcmp(argv[i], "-time") == 0 && i + 1 < argc)
+			minimumTime = atof(argv[++i]);
+		else if (strcmp(argv[i], "-output") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else if (strcmp(argv[i], "-counters") == 0)
+			useCounters = true;
+		else if (strcmp(argv[i], "-check-allocations") == 0) {
+			checkTicks = 1000000;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+				checkTicks = atoll(argv[++i]);
+		}
+		else {
+			fprintf(stderr,
+				"Usage: %s [-filter <substring>] [-time <seconds>] [-output <file.json>] [-counters]\n"
+				"       %s -check-allocations [ticks]\n",
+				argv[0], argv[0]
+			);
+			return 1;
+		}
+	}
+
+	Engine::InitSimulatorParameters();
+	Engine::simulatorParameters.applicationType = Engine::UIType::CONSOLE;
+	std::vector<TerrainCase> terrains = createTerrains();
+
+	/* The number of craters does not change the allocations; the dense terrain
+	   would only slow the check down. */
+	if (checkTicks > 0) {
+		std::vector<TerrainCase> checked(terrains.begin(), terrains.begin() + 2);
+		bool passed = checkPhilox();
+		if (!checkAllocations(checkTicks, checked))
+			passed = false;
+		return (passed ? 0 : 1);
+	}
+
+	Harness harness(minimumTime, filter);
+	if (useCounters && !harness.enableCounters())
+		fprintf(stderr, "Hardware performance counters are not available, only the timings are reported.\n");
+	benchmarkCart(harness);
+	benchmarkTerrain(harness, terrains);
+	benchmarkArena(harness);
+	benchmarkRandomizer(harness);
+	benchmarkLanes(harness);
+	benchmarkBatch(harness, terrains);
+	benchmarkEpisodes(harness, std::vector<TerrainCase>(terrains.begin(), terrains.begin() + 2));
+	benchmarkEvaluation(harness, terrains);
+	benchmarkOptimizer(harness, terrains);
+	benchmarkPolicy(harness);
+	benchmarkTable(harness, std::vector<TerrainCase>(terrains.begin(), terrains.begin() + 2));
+	benchmarkRolloutBuffer(harness);
+	benchmarkFrames(harness);
+	/* A batch of sequences on the dense terrain would take seconds per run. */
+	benchmarkSequence(harness, std::vector<TerrainCase>(terrains.begin(), terrains.begin() + 2));
+#ifdef _WIN32
+	benchmarkSimulator(harness, terrains);
+	benchmarkRecording(harness);
+#endif
+
+	std::string json = harness.toJson();
+	if (output.empty()) {
+		fputs(json.c_str(), stdout);
+	}
+	else {
+		FILE* file = fopen(output.c_str(), "w");
+		if (file == nullptr) {
+			fprintf(stderr, "Cannot write %s\n", output.c_str());
+			return 1;
+		}
+		fputs(json.c_str(), file);
+		fclose(file);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include <stdlib.h>
+#include <new>
+#include "arena.h"
+
+Arena::Arena(size_t chunkSize) :
+	chunkSize(chunkSize > 0 ? chunkSize : 4096),
+	first(nullptr),
+	current(nullptr),
+	offset(0),
+	used(0),
+	reserved(0)
+{
+}
+
+Arena::~Arena()
+{
+	Chunk* chunk = first;
+	while (chunk != nullptr) {
+		Chunk* next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+}
+
+Arena::Chunk* Arena::createChunk(size_t size)
+{
+	Chunk* chunk = static_cast<Chunk*>(malloc(sizeof(Chunk) + size));
+	if (chunk == nullptr)
+		throw std::bad_alloc();
+	chunk->next = nullptr;
+	chunk->size = size;
+	reserved += size;
+	return chunk;
+}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+	if (alignment == 0)
+		alignment = 1;
+
+	/* Try the current chunk, then the following ones (kept from before the
+	   last release), and create a new chunk only if none of them fits. */
+	while (current != nullptr) {
+		size_t address = reinterpret_cast<size_t>(getData(current)) + offset;
+		size_t padding = (alignment - address % alignment) % alignment;
+		if (offset + padding + size <= current->size) {
+			offset += padding + size;
+			used += padding + size;
+			return reinterpret_cast<void*>(address + padding);
+		}
+		if (current->next == nullptr)
+			break;
+		current = current->next;
+		offset = 0;
+	}
+
+	Chunk* chunk = createChunk(size + alignment > chunkSize ? size + alignment : chunkSize);
+	if (current == nullptr) {
+		first = chunk;
+	}
+	else {
+		chunk->next = current->next;
+		current->next = chunk;
+	}
+	current = chunk;
+	offset = 0;
+
+	size_t address = reinterpret_cast<size_t>(getData(current));
+	size_t padding = (alignment - address % alignment) % alignment;
+	offset = padding + size;
+	used += padding + size;
+	return reinterpret_cast<void*>(address + padding);
+}
+
+void Arena::release()
+{
+	current = first;
+	offset = 0;
+	used = 0;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+#include <stddef.h>
+
+/* A monotonic memory arena. Memory is taken from large chunks by moving an
+   offset and is never freed individually; release() rewinds the arena in
+   constant time and keeps the chunks for reuse, so that after the first use
+   the arena does not touch the heap at all. Not thread-safe: every owner
+   has its own arena, e.g. the simulator for the frames of its recording,
+   released when the recording is finished, and a rollout buffer for its
+   arrays. */
+class Arena
+{
+public:
+	Arena() = delete;
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+	Arena(size_t chunkSize);
+	~Arena();
+
+	void* allocate(size_t size, size_t alignment);
+	void release();
+	size_t getUsed() const { return used; }
+	size_t getReserved() const { return reserved; }
+
+protected:
+	struct Chunk {
+		Chunk* next;
+		size_t size;
+	};
+
+	size_t chunkSize;
+	Chunk* first;
+	Chunk* current;
+	size_t offset;
+	size_t used;
+	size_t reserved;
+
+private:
+	static char* getData(Chunk* chunk) { return reinterpret_cast<char*>(chunk + 1); }
+	Chunk* createChunk(size_t size);
+};
+
+/* Lets the standard containers allocate from an arena. Deallocation does
+   nothing; the memory is returned when the arena is released. */
+template <class T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	ArenaAllocator(Arena* arena) : arena(arena) {}
+	template <class U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t n) {
+		return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+	}
+	void deallocate(T*, size_t) {}
+
+	template <class U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+	template <class U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+	Arena* arena;
+};
\ No newline at end of file
@@ -0,0 +1,267 @@
+#include <string.h>
+#include "arrowstream.h"
+
+/* Values of the Arrow schema (Schema.fbs, Message.fbs). */
+static const int16_t metadataVersion = 4;   // V5
+static const uint8_t headerSchema = 1;
+static const uint8_t headerRecordBatch = 3;
+static const uint8_t typeInt = 2;
+static const uint8_t typeFloatingPoint = 3;
+static const int16_t precisionDouble = 2;
+
+/* The continuation marker that starts every message, and the alignment of
+   the bodies and of the buffers in them. */
+static const int32_t continuation = -1;
+static const uint64_t bodyAlignment = 64;
+
+/* A FlatBuffer laid out front to back: a table comes after its vtable and
+   before the tables, the strings and the vectors it refers to, so that every
+   reference points forward, as the format wants of offsets. Tables start at
+   multiples of 8 from the start of the buffer and their fields are aligned
+   to their size. */
+class FlatBuffer
+{
+public:
+	std::string data;
+
+	size_t reserve(size_t size)
+	{
+		size_t position = data.size();
+		data.append(size, '\0');
+		return position;
+	}
+
+	void align(size_t alignment, size_t offset)
+	{
+		while ((data.size() + offset) % alignment != 0)
+			data += '\0';
+	}
+
+	template <class T> void put(size_t position, T value)
+	{
+		memcpy(&data[position], &value, sizeof(T));
+	}
+
+	void link(size_t position, size_t target)
+	{
+		put(position, static_cast<uint32_t>(target - position));
+	}
+
+	/* Lays out a table with fields of the given sizes, by field id (0 for a
+	   field left out), and returns its position and those of its fields. */
+	size_t addTable(const std::vector<int>& sizes, std::vector<size_t>& fields)
+	{
+		/* The largest fields first, after the offset of the vtable. */
+		std::vector<size_t> offsets(sizes.size(), 0);
+		size_t tableSize = sizeof(int32_t);
+		for (int size = 8; size >= 1; size /= 2) {
+			for (size_t i = 0; i < sizes.size(); i++) {
+				if (sizes[i] != size)
+					continue;
+				tableSize = (tableSize + size - 1) / size * size;
+				offsets[i] = tableSize;
+				tableSize += size;
+			}
+		}
+
+		align(2, 0);
+		size_t vtable = reserve(2 * (2 + sizes.size()));
+		put(vtable, static_cast<uint16_t>(2 * (2 + sizes.size())));
+		put(vtable + 2, static_cast<uint16_t>(tableSize));
+		for (size_t i = 0; i < sizes.size(); i++)
+			put(vtable + 4 + 2 * i, static_cast<uint16_t>(offsets[i]));
+
+		align(8, 0);
+		size_t table = reserve(tableSize);
+		put(table, static_cast<int32_t>(table - vtable));
+		fields.resize(sizes.size());
+		for (size_t i = 0; i < sizes.size(); i++)
+			fields[i] = (sizes[i] != 0 ? table + offsets[i] : 0);
+		return table;
+	}
+
+	size_t addString(const std::string& text)
+	{
+		align(4, 0);
+		size_t position = reserve(sizeof(uint32_t) + text.length() + 1);
+		put(position, static_cast<uint32_t>(text.length()));
+		memcpy(&data[position + sizeof(uint32_t)], text.data(), text.length());
+		return position;
+	}
+
+	/* A vector of count elements, aligned for elements of the given
+	   alignment; the elements start 4 bytes after the returned position. */
+	size_t addVector(size_t count, size_t elementSize, size_t alignment)
+	{
+		align(alignment > 4 ? alignment : 4, sizeof(uint32_t));
+		size_t position = reserve(sizeof(uint32_t) + count * elementSize);
+		put(position, static_cast<uint32_t>(count));
+		return position;
+	}
+};
+
+/* A Message table with the given header, at the root of the buffer; returns
+   the position of the header field. */
+static size_t addMessage(FlatBuffer& buffer, uint8_t headerType, int64_t bodyLength)
+{
+	size_t root = buffer.reserve(sizeof(uint32_t));
+	std::vector<size_t> fields;
+	size_t message = buffer.addTable({ 2, 1, 4, 8 }, fields);   // version, header type, header, body length
+	buffer.link(root, message);
+	buffer.put(fields[0], metadataVersion);
+	buffer.put(fields[1], headerType);
+	buffer.put(fields[3], bodyLength);
+	return fields[2];
+}
+
+ArrowStream::ArrowStream() :
+	file(nullptr),
+	position(0)
+{
+}
+
+ArrowStream::~ArrowStream()
+{
+	if (file != nullptr)
+		fclose(file);
+}
+
+bool ArrowStream::open(const char* fileName, const Column* columns, int count, std::string& error)
+{
+	std::string ignored;
+	if (file != nullptr)
+		close(ignored);
+
+	this->fileName = fileName;
+	this->columns.assign(columns, columns + count);
+	file = fopen(fileName, "wb");
+	position = 0;
+	if (file == nullptr) {
+		error = std::string("Cannot write ") + fileName;
+		return false;
+	}
+
+	FlatBuffer buffer;
+	size_t header = addMessage(buffer, headerSchema, 0);
+	std::vector<size_t> schema;
+	buffer.link(header, buffer.addTable({ 2, 4 }, schema));   // endianness, fields
+	buffer.put(schema[0], static_cast<int16_t>(0));          // little-endian
+	size_t fields = buffer.addVector(count, sizeof(uint32_t), 4);
+	buffer.link(schema[1], fields);
+
+	for (int i = 0; i < count; i++) {
+		/* name, nullable, type type, type, dictionary (left out), children */
+		std::vector<size_t> field;
+		buffer.link(fields + 4 + 4 * i, buffer.addTable({ 4, 1, 1, 4, 0, 4 }, field));
+		buffer.put(field[1], static_cast<uint8_t>(0));
+
+		std::vector<size_t> type;
+		if (columns[i].type == INT32) {
+			buffer.put(field[2], typeInt);
+			buffer.link(field[3], buffer.addTable({ 4, 1 }, type));   // bit width, signed
+			buffer.put(type[0], static_cast<int32_t>(32));
+			buffer.put(type[1], static_cast<uint8_t>(1));
+		}
+		else {
+			buffer.put(field[2], typeFloatingPoint);
+			buffer.link(field[3], buffer.addTable({ 2 }, type));      // precision
+			buffer.put(type[0], precisionDouble);
+		}
+
+		buffer.link(field[0], buffer.addString(columns[i].name));
+		buffer.link(field[5], buffer.addVector(0, sizeof(uint32_t), 4));
+	}
+
+	if (!writeMessage(buffer.data, 0, nullptr, error)) {
+		fclose(file);
+		file = nullptr;
+		return false;
+	}
+	return true;
+}
+
+bool ArrowStream::write(int64_t rows, const void* const* values, std::string& error)
+{
+	/* Every column has an empty validity buffer (no nulls) and its values. */
+	size_t count = columns.size();
+	int64_t bodyLength = 0;
+	for (size_t i = 0; i < count; i++) {
+		uint64_t size = rows * getSize(columns[i].type);
+		bodyLength += (size + bodyAlignment - 1) / bodyAlignment * bodyAlignment;
+	}
+
+	FlatBuffer buffer;
+	size_t header = addMessage(buffer, headerRecordBatch, bodyLength);
+	std::vector<size_t> batch;
+	buffer.link(header, buffer.addTable({ 8, 4, 4 }, batch));   // length, nodes, buffers
+	buffer.put(batch[0], rows);
+
+	/* The nodes (length, null count) and the buffers (offset, length) are
+	   structs of two int64_t. */
+	size_t nodes = buffer.addVector(count, 16, 8);
+	buffer.link(batch[1], nodes);
+	for (size_t i = 0; i < count; i++) {
+		buffer.put(nodes + 4 + 16 * i, rows);
+		buffer.put(nodes + 12 + 16 * i, static_cast<int64_t>(0));
+	}
+
+	size_t buffers = buffer.addVector(2 * count, 16, 8);
+	buffer.link(batch[2], buffers);
+	int64_t offset = 0;
+	for (size_t i = 0; i < count; i++) {
+		int64_t size = rows * getSize(columns[i].type);
+		buffer.put(buffers + 4 + 32 * i, offset);
+		buffer.put(buffers + 12 + 32 * i, static_cast<int64_t>(0));
+		buffer.put(buffers + 20 + 32 * i, offset);
+		buffer.put(buffers + 28 + 32 * i, size);
+		offset += (size + bodyAlignment - 1) / bodyAlignment * bodyAlignment;
+	}
+
+	return writeMessage(buffer.data, rows, values, error);
+}
+
+bool ArrowStream::close(std::string& error)
+{
+	if (file == nullptr)
+		return true;
+
+	int32_t end[2] = { continuation, 0 };
+	bool written = writeBytes(end, sizeof(end));
+	written = (fclose(file) == 0) && written;
+	file = nullptr;
+	if (!written)
+		error = std::string("Cannot write ") + fileName;
+	return written;
+}
+
+/* The continuation marker, the size of the metadata, the metadata padded so
+   that the body starts at a multiple of 64 bytes, and the body. */
+bool ArrowStream::writeMessage(const std::string& metadata, int64_t rows, const void* const* values, std::string& error)
+{
+	static const char zeros[bodyAlignment] = {};
+	uint64_t end = position + 2 * sizeof(int32_t) + metadata.length();
+	int32_t size = static_cast<int32_t>(metadata.length() + (bodyAlignment - end % bodyAlignment) % bodyAlignment);
+
+	bool written =
+		writeBytes(&continuation, sizeof(continuation)) &&
+		writeBytes(&size, sizeof(size)) &&
+		writeBytes(metadata.data(), metadata.length()) &&
+		writeBytes(zeros, size - metadata.length());
+
+	for (size_t i = 0; values != nullptr && i < columns.size() && written; i++) {
+		size_t bytes = static_cast<size_t>(rows * getSize(columns[i].type));
+		written = writeBytes(values[i], bytes) && writeBytes(zeros, (bodyAlignment - bytes % bodyAlignment) % bodyAlignment);
+	}
+
+	if (!written)
+		error = std::string("Cannot write ") + fileName;
+	return written;
+}
+
+bool ArrowStream::writeBytes(const void* data, size_t size)
+{
+	if (size == 0)
+		return true;
+	position += size;
+	return fwrite(data, 1, size, file) == size;
+}
\ No newline at end of file
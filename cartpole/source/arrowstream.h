@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/* Writes a table in the Arrow IPC streaming format: a schema message, one
+   record batch message per write, and the end-of-stream marker. The
+   messages are FlatBuffers built here, and the columns of a batch are
+   written as they are in memory, so that readers (pyarrow, Polars, DuckDB)
+   map them without converting anything. Every column is a primitive one
+   with no nulls; the bodies start at a multiple of 64 bytes in the file, as
+   the format recommends, and so does every buffer in them. */
+class ArrowStream
+{
+public:
+	enum Type {
+		INT32 = 0,
+		FLOAT64
+	};
+
+	struct Column {
+		const char* name;
+		Type type;
+	};
+
+	ArrowStream();
+	~ArrowStream();
+
+	/* Creates the file and writes the schema of the columns. */
+	bool open(const char* fileName, const Column* columns, int count, std::string& error);
+
+	/* Writes a record batch: the values of every column, in the order of the
+	   schema, rows values each. */
+	bool write(int64_t rows, const void* const* values, std::string& error);
+
+	/* Writes the end-of-stream marker and closes the file. */
+	bool close(std::string& error);
+	bool isOpen() const { return file != nullptr; }
+
+protected:
+	FILE* file;
+	uint64_t position;
+	std::string fileName;
+	std::vector<Column> columns;
+
+	static uint64_t getSize(Type type) { return type == INT32 ? 4 : 8; }
+	bool writeMessage(const std::string& metadata, int64_t rows, const void* const* values, std::string& error);
+	bool writeBytes(const void* data, size_t size);
+};
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include <string.h>
+#include "batchsimulator.h"
+#include "randomizer.h"
+#include "rollout.h"
+#include "termination.h"
+#include "trajectoryoptimizer.h"
+
+BatchSimulator::BatchSimulator(int count, const Engine::SimulatorParameters& simulatorParameters) :
+	count(count > 0 ? count : 1),
+	x(this->count),
+	y(this->count),
+	dx(this->count),
+	ddx(this->count),
+	theta(this->count),
+	dtheta(this->count),
+	ddtheta(this->count),
+	phi(this->count),
+	laneParameters(this->count),
+	episodes(this->count),
+	lastEpisodes(this->count),
+	savedState(static_cast<size_t>(this->count) * 8)
+{
+	dt = 1.0 / simulatorParameters.actionFrequency;
+	cartSize = simulatorParameters.cart.size;
+	wheelDistance = 3 * simulatorParameters.cart.size / 5;
+	leftBound = -100 + simulatorParameters.cart.size / 2;
+	rightBound = 100 - simulatorParameters.cart.size / 2;
+	termination = simulatorParameters.termination;
+	randomization = simulatorParameters.randomization;
+	randomized = Randomizer::isEnabled(randomization);
+
+	simulatorPhysics.cartMass = simulatorParameters.cart.mass;
+	simulatorPhysics.cartDamping = simulatorParameters.cart.damping;
+	simulatorPhysics.poleMass = simulatorParameters.pole.mass;
+	simulatorPhysics.poleLength = simulatorParameters.pole.size;
+	simulatorPhysics.poleDamping = simulatorParameters.pole.damping;
+	simulatorPhysics.gravity = simulatorParameters.gravity;
+	uniform = !Randomizer::isPhysicsEnabled(randomization);
+	physics.resize(this->count);
+	for (int lane = 0; lane < this->count; lane++)
+		laneParameters[lane] = simulatorPhysics;
+
+	/* The floor is computed here, so the craters need not outlive the batch. */
+	terrain.compute(simulatorParameters.craters);
+	flat = terrain.isFlat();
+
+	for (int lane = 0; lane < this->count; lane++) {
+		episodes[lane] = {};
+		episodes[lane].number = 1;
+		lastEpisodes[lane] = {};
+	}
+	reset(nullptr);
+}
+
+BatchSimulator::~BatchSimulator()
+{
+}
+
+void BatchSimulator::reset(double* observations)
+{
+	for (int lane = 0; lane < count; lane++) {
+		endEpisode(lane, Engine::TerminationReason::RESET_REQUESTED);
+		startEpisode(lane);
+		if (observations != nullptr)
+			observe(lane, observations + lane * OBSERVATION_SIZE);
+	}
+}
+
+void BatchSimulator::setParameters(int lane, const PhysicalParameters& parameters)
+{
+	laneParameters[lane] = parameters;
+	physics.set(lane, parameters);
+	uniform = false;
+}
+
+void BatchSimulator::step(const double* forces, double* observations, double* rewards, uint8_t* dones)
+{
+	/* The lanes are independent, so a tick is made of passes over the lanes,
+	   as in runSequence, with the episodes checked in the last one. */
+	stepPhysics(forces);
+
+	for (int lane = 0; lane < count; lane++) {
+		Engine::EpisodeStatistics& episode = episodes[lane];
+		episode.length++;
+		episode.time += dt;
+		Engine::TerminationReason reason = Termination::check(termination, x[lane], theta[lane], episode.time, dt);
+		double reward = termination.stepReward;
+		if (reason == Engine::TerminationReason::TARGET_REACHED)
+			reward += termination.targetReward;
+		episode.episodeReturn += reward;
+
+		if (rewards != nullptr)
+			rewards[lane] = reward;
+		if (dones != nullptr)
+			dones[lane] = static_cast<uint8_t>(reason);
+
+		/* There is no engine to ask: every rule that applies ends the episode. */
+		if (reason != Engine::TerminationReason::NOT_TERMINATED) {
+			endEpisode(lane, reason);
+			startEpisode(lane);
+		}
+
+		if (observations != nullptr)
+			observe(lane, observations + lane * OBSERVATION_SIZE);
+	}
+}
+
+void BatchSimulator::runSequence(const double* forces, int k, Engine::SimulationState* trajectory)
+{
+	/* The lanes are stepped in place, as by step, and put back afterwards. */
+	std::vector<double>* columns[] = { &x, &y, &dx, &ddx, &theta, &dtheta, &ddtheta, &phi };
+	size_t columnSize = static_cast<size_t>(count) * sizeof(double);
+	for (size_t column = 0; column < 8; column++)
+		memcpy(&savedState[column * count], &(*columns[column])[0], columnSize);
+
+	for (int i = 0; i < k; i++) {
+		stepPhysics(forces + static_cast<size_t>(i) * count);
+
+		if (trajectory != nullptr) {
+			Engine::SimulationState* states = trajectory + static_cast<size_t>(i) * count;
+			for (int lane = 0; lane < count; lane++) {
+				Engine::SimulationState& state = states[lane];
+				state.x = x[lane];
+				state.y = y[lane];
+				state.phi = phi[lane];
+				state.dx = dx[lane];
+				state.ddx = ddx[lane];
+				state.theta = theta[lane];
+				state.dtheta = dtheta[lane];
+				state.ddtheta = ddtheta[lane];
+			}
+		}
+	}
+
+	for (size_t column = 0; column < 8; column++)
+		memcpy(&(*columns[column])[0], &savedState[column * count], columnSize);
+}
+
+void BatchSimulator::evaluateSequences(int lane, const double* forces, int m, int k, const Engine::QuadraticCost& cost, double* costs) const
+{
+	Rollout rollout(terrain, cartSize, dt);
+	rollout.evaluate(physics.get(lane), getState(lane), forces, m, k, cost, costs);
+}
+
+int BatchSimulator::optimizeSequence(
+	int lane,
+	double* forces,
+	int k,
+	const Engine::QuadraticCost& cost,
+	const Engine::OptimizerSettings& settings,
+	double* result
+) const {
+	TrajectoryOptimizer optimizer(terrain, cartSize, dt);
+	return optimizer.optimize(physics.get(lane), getState(lane), forces, k, cost, settings, result);
+}
+
+Engine::SimulationState BatchSimulator::getState(int lane) const
+{
+	Engine::SimulationState state;
+	state.x = x[lane];
+	state.y = y[lane];
+	state.phi = phi[lane];
+	state.dx = dx[lane];
+	state.ddx = ddx[lane];
+	state.theta = theta[lane];
+	state.dtheta = dtheta[lane];
+	state.ddtheta = ddtheta[lane];
+	return state;
+}
+
+void BatchSimulator::endEpisode(int lane, Engine::TerminationReason reason)
+{
+	Engine::EpisodeStatistics& episode = episodes[lane];
+	if (episode.length == 0)
+		return;
+
+	episode.reason = reason;
+	lastEpisodes[lane] = episode;
+
+	episode.number++;
+	episode.length = 0;
+	episode.time = 0;
+	episode.episodeReturn = 0;
+}
+
+void BatchSimulator::startEpisode(int lane)
+{
+	/* Each lane has its own stream, so a lane samples the same episodes as a
+	   simulator whose stream is randomization.stream + lane. */
+	Engine::InitialState state = {};
+	PhysicalParameters parameters = laneParameters[lane];
+	if (randomized) {
+		Randomizer::sample(randomization, randomization.stream + lane, 1,
+			static_cast<uint32_t>(episodes[lane].number), &parameters, &state);
+	}
+	physics.set(lane, parameters);
+
+	x[lane] = state.x;
+	dx[lane] = state.dx;
+	ddx[lane] = state.ddx;
+	theta[lane] = state.theta;
+	dtheta[lane] = state.dtheta;
+	ddtheta[lane] = state.ddtheta;
+	terrain.align(x[lane], wheelDistance, y[lane], phi[lane]);
+}
+
+void BatchSimulator::observe(int lane, double* observation) const
+{
+	observation[OBSERVATION_X] = x[lane];
+	observation[OBSERVATION_DX] = dx[lane];
+	observation[OBSERVATION_THETA] = theta[lane];
+	observation[OBSERVATION_DTHETA] = dtheta[lane];
+	observation[OBSERVATION_PHI] = phi[lane];
+}
+
+void BatchSimulator::stepPhysics(const double* forces)
+{
+	/* The physics alone, the alignment (skipped on a flat floor, where it
+	   gives y = 0 and phi = 0) and the bounds. */
+	if (uniform) {
+		CartPhysics::stepLanes(count, dt, simulatorPhysics, forces, &phi[0],
+			&x[0], &y[0], &dx[0], &ddx[0], &theta[0], &dtheta[0], &ddtheta[0]);
+	}
+	else {
+		CartPhysics::stepLanes(count, dt, physics, forces, &phi[0],
+			&x[0], &y[0], &dx[0], &ddx[0], &theta[0], &dtheta[0], &ddtheta[0]);
+	}
+
+	if (!flat)
+		terrain.alignLanes(count, &x[0], wheelDistance, &y[0], &phi[0]);
+
+	/* Prevent the cart from falling over the edge. */
+	for (int lane = 0; lane < count; lane++) {
+		if (x[lane] < leftBound || x[lane] > rightBound) {
+			x[lane] = (x[lane] < leftBound ? leftBound : rightBound);
+			dx[lane] = -dx[lane] * 0.5;
+			ddx[lane] = 0;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "engine.h"
+#include "physics.h"
+#include "terrain.h"
+
+/* Steps a batch of independent environments with the physics, the terrain,
+   the bounds and the termination rules of the simulator, driven by the
+   caller instead of by an engine. The state is kept as a structure of arrays
+   (one array per quantity) and the results are written to buffers owned by
+   the caller. A lane whose episode has ended is reset right away, so the
+   observation returned with a done flag is the first one of the next episode. */
+class BatchSimulator
+{
+public:
+	/* Layout of the observation of one lane. */
+	enum Observation {
+		OBSERVATION_X = 0,
+		OBSERVATION_DX,
+		OBSERVATION_THETA,
+		OBSERVATION_DTHETA,
+		OBSERVATION_PHI,
+		OBSERVATION_SIZE
+	};
+
+	BatchSimulator() = delete;
+	BatchSimulator(int count, const Engine::SimulatorParameters& simulatorParameters);
+	~BatchSimulator();
+
+	int getCount() const { return count; }
+	double getTimeStep() const { return dt; }
+	const Engine::EpisodeStatistics& getLastEpisode(int lane) const { return lastEpisodes[lane]; }
+	PhysicalParameters getParameters(int lane) const { return physics.get(lane); }
+
+	/* The episode running in a lane, and the state of the lane. */
+	const Engine::EpisodeStatistics& getEpisode(int lane) const { return episodes[lane]; }
+	Engine::SimulationState getState(int lane) const;
+
+	/* Gives a lane its own physical parameters instead of the simulator
+	   ones, at once and for its next episodes; the quantities that are
+	   randomised are still sampled at the start of every episode. */
+	void setParameters(int lane, const PhysicalParameters& parameters);
+
+	/* Starts a new episode in all the lanes. The observations hold
+	   OBSERVATION_SIZE values per lane and may be nullptr. */
+	void reset(double* observations);
+
+	/* Applies one force per lane for one tick. The rewards and the dones hold
+	   one value per lane; a done is the Engine::TerminationReason of the
+	   episode (NOT_TERMINATED while it runs). Any output may be nullptr. */
+	void step(const double* forces, double* observations, double* rewards, uint8_t* dones);
+
+	/* Applies k forces per lane in open loop to copies of the state of the
+	   lanes: no rewards, no termination rules and no resets, and the lanes
+	   and their episodes are left as they were. The forces and the
+	   trajectory are laid out tick by tick, one value per lane in every
+	   tick; the trajectory may be nullptr. */
+	void runSequence(const double* forces, int k, Engine::SimulationState* trajectory);
+
+	/* Applies m sequences of k forces (one sequence after the other) to
+	   copies of the state of a lane, and writes the cost of every sequence. */
+	void evaluateSequences(int lane, const double* forces, int m, int k, const Engine::QuadraticCost& cost, double* costs) const;
+
+	/* Optimises k forces in place from the state of a lane (see
+	   TrajectoryOptimizer) and returns the number of iterations. */
+	int optimizeSequence(
+		int lane,
+		double* forces,
+		int k,
+		const Engine::QuadraticCost& cost,
+		const Engine::OptimizerSettings& settings,
+		double* result
+	) const;
+
+protected:
+	int count;
+	double dt;
+	double cartSize;
+	double wheelDistance;
+	double leftBound;
+	double rightBound;
+	bool flat;
+	Engine::TerminationRules termination;
+	Engine::Randomization randomization;
+	bool randomized;
+	PhysicalParameters simulatorPhysics;
+
+	/* Whether every lane has the simulator parameters, so that a tick may
+	   use them for all the lanes without reading the columns. */
+	bool uniform;
+	Terrain terrain;
+
+	std::vector<double> x;
+	std::vector<double> y;
+	std::vector<double> dx;
+	std::vector<double> ddx;
+	std::vector<double> theta;
+	std::vector<double> dtheta;
+	std::vector<double> ddtheta;
+	std::vector<double> phi;
+	PhysicsColumns physics;
+	std::vector<PhysicalParameters> laneParameters;
+	std::vector<Engine::EpisodeStatistics> episodes;
+	std::vector<Engine::EpisodeStatistics> lastEpisodes;
+
+	/* The state of the lanes while runSequence runs the copies in place. */
+	std::vector<double> savedState;
+
+	void endEpisode(int lane, Engine::TerminationReason reason);
+	void startEpisode(int lane);
+	void observe(int lane, double* observation) const;
+	void stepPhysics(const double* forces);
+};
\ No newline at end of file
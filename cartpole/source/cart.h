@@ -1,40 +1,33 @@
-#pragma once
-#include "drawingdevice.h"
-
-class Cart
-{
-public:
-	Cart();
-	~Cart();
-
-	double x;
-	double y;
-	double dx;
-	double ddx;
-	double dtheta;
-	double ddtheta;
-	double phi;
-	double theta;
-	bool frozen;
-
-	void reset(
-		double x,
-		double dx,
-		double ddx,
-		double theta,
-		double dtheta,
-		double ddtheta
-	);
-	double getWidth();
-	double getWheelDistance();
-	void bounce();
-	void dropMomentum();
-	bool isTouched(double x, double y);
-	void tick(double F, double dt);
-	void paint(DrawingDevice* drawingDevice);
-
-private:
-	static const double pi;
-	static const double negPi;
-	static const double doublePi;
+#pragma once
+#include "drawingdevice.h"
+#include "displaylist.h"
+#include "physics.h"
+#include "checkpoint.h"
+
+/* The cart as it is drawn: the physics, the pose before the last tick
+   and the recorded shape. */
+class Cart : public CartPhysics
+{
+public:
+	Cart();
+	~Cart();
+
+	void storePose();
+	void paint(DrawingDevice* drawingDevice, double interpolation = 1);
+	void writeCheckpoint(CheckpointWriter& writer) const;
+	bool readCheckpoint(CheckpointReader& reader);
+
+private:
+	double previousX;
+	double previousY;
+	double previousPhi;
+	double previousTheta;
+	DisplayList shape;
+	int bodyTransform;
+	int poleTransform;
+	int hingeTransform;
+	double shapeWidth;
+	double shapePoleLength;
+
+	void recordShape(double width, double poleLength);
 };
\ No newline at end of file
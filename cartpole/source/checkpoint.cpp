@@ -0,0 +1,147 @@
+#include <stdio.h>
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+#include "checkpoint.h"
+
+/* Header: the magic number and the version. Section: the id (uint32_t) and
+   the size of the data (uint64_t), followed by the data. */
+static const size_t headerSize = 2 * sizeof(uint32_t);
+static const size_t sectionHeaderSize = sizeof(uint32_t) + sizeof(uint64_t);
+
+CheckpointWriter::CheckpointWriter() :
+	sectionStart(0)
+{
+	clear();
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+}
+
+void CheckpointWriter::clear()
+{
+	buffer.clear();
+	uint32_t header[2] = { Checkpoint::magic, Checkpoint::version };
+	write(header, sizeof(header));
+	sectionStart = 0;
+}
+
+void CheckpointWriter::beginSection(Checkpoint::Section section)
+{
+	write(static_cast<uint32_t>(section));
+	sectionStart = buffer.size();
+	write(static_cast<uint64_t>(0));
+}
+
+void CheckpointWriter::endSection()
+{
+	uint64_t size = buffer.size() - sectionStart - sizeof(uint64_t);
+	memcpy(&buffer[sectionStart], &size, sizeof(size));
+}
+
+void CheckpointWriter::write(const void* data, size_t size)
+{
+	const char* bytes = static_cast<const char*>(data);
+	buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+void CheckpointWriter::write(const std::string& text)
+{
+	write(static_cast<uint64_t>(text.length()));
+	write(text.data(), text.length());
+}
+
+/* The checkpoint is written next to the file and then moved over it, so that
+   an interrupted write leaves the previous checkpoint intact. */
+bool CheckpointWriter::save(const char* fileName) const
+{
+	std::string temporaryName = std::string(fileName) + ".tmp";
+	FILE* file = fopen(temporaryName.c_str(), "wb");
+	if (file == nullptr)
+		return false;
+	bool written = (fwrite(&buffer[0], 1, buffer.size(), file) == buffer.size());
+	written = (fclose(file) == 0) && written;
+	if (!written)
+		return false;
+
+#ifdef _WIN32
+	return MoveFileExA(temporaryName.c_str(), fileName, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(temporaryName.c_str(), fileName) == 0;
+#endif
+}
+
+CheckpointReader::CheckpointReader() :
+	position(0),
+	end(0)
+{
+}
+
+CheckpointReader::~CheckpointReader()
+{
+}
+
+bool CheckpointReader::load(const char* fileName)
+{
+	buffer.clear();
+	position = 0;
+	end = 0;
+
+	FILE* file = fopen(fileName, "rb");
+	if (file == nullptr)
+		return false;
+	char chunk[65536];
+	size_t count;
+	while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0)
+		buffer.insert(buffer.end(), chunk, chunk + count);
+	fclose(file);
+
+	uint32_t fileMagic = 0;
+	uint32_t fileVersion = 0;
+	end = buffer.size();
+	if (!read(fileMagic) || !read(fileVersion))
+		return false;
+	return fileMagic == Checkpoint::magic && fileVersion == Checkpoint::version;
+}
+
+/* Positions the reader at the data of the section; reading stops at its end. */
+bool CheckpointReader::findSection(Checkpoint::Section section)
+{
+	size_t offset = headerSize;
+	while (offset + sectionHeaderSize <= buffer.size()) {
+		uint32_t id;
+		uint64_t size;
+		memcpy(&id, &buffer[offset], sizeof(id));
+		memcpy(&size, &buffer[offset + sizeof(id)], sizeof(size));
+		offset += sectionHeaderSize;
+		if (size > buffer.size() - offset)
+			return false;
+		if (id == static_cast<uint32_t>(section)) {
+			position = offset;
+			end = offset + static_cast<size_t>(size);
+			return true;
+		}
+		offset += static_cast<size_t>(size);
+	}
+	return false;
+}
+
+bool CheckpointReader::read(void* data, size_t size)
+{
+	if (size > end - position)
+		return false;
+	memcpy(data, &buffer[position], size);
+	position += size;
+	return true;
+}
+
+bool CheckpointReader::read(std::string& text)
+{
+	uint64_t length;
+	if (!read(length) || length > end - position)
+		return false;
+	text.assign(&buffer[position], static_cast<size_t>(length));
+	position += static_cast<size_t>(length);
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/* A checkpoint file is a header followed by sections, each with an id and
+   a size, so that a reader can skip the sections it does not know. The
+   values are stored as they are in memory, so that a resumed simulation
+   continues bit for bit. The version changes whenever the layout of a
+   known section changes. */
+class Checkpoint
+{
+public:
+	enum Section {
+		SIMULATOR = 1,
+		CART = 2,
+		RECORDING = 3,
+		LOG = 4,
+		ENGINE = 5
+	};
+
+	static const uint32_t magic = 0x4B435043;   // "CPCK"
+	static const uint32_t version = 3;
+};
+
+/* Collects a checkpoint in memory and writes it at once. The buffer is kept
+   between checkpoints, so that taking one does not allocate. */
+class CheckpointWriter
+{
+public:
+	CheckpointWriter();
+	~CheckpointWriter();
+
+	void clear();
+	void beginSection(Checkpoint::Section section);
+	void endSection();
+	void write(const void* data, size_t size);
+	void write(const std::string& text);
+	template <class T>
+	void write(const T& value) { write(&value, sizeof(T)); }
+	bool save(const char* fileName) const;
+
+protected:
+	std::vector<char> buffer;
+	size_t sectionStart;
+};
+
+class CheckpointReader
+{
+public:
+	CheckpointReader();
+	~CheckpointReader();
+
+	bool load(const char* fileName);
+	bool findSection(Checkpoint::Section section);
+	bool read(void* data, size_t size);
+	bool read(std::string& text);
+	template <class T>
+	bool read(T& value) { return read(&value, sizeof(T)); }
+	const char* getData() const { return &buffer[0] + position; }
+	size_t getRemaining() const { return end - position; }
+
+protected:
+	std::vector<char> buffer;
+	size_t position;
+	size_t end;
+};
\ No newline at end of file
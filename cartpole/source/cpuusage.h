@@ -1,16 +1,16 @@
-#pragma once
-
-class CPUUsage
-{
-public:
-	static void setFrequency(int frequency);
-	static void clear();
-	static void reportUsage(double usage);
-	static double getUsage();
-
-protected:
-	static int frequency;
-	static double usage;
-	static double sum;
-	static int count;
+#pragma once
+
+class CPUUsage
+{
+public:
+	static void setFrequency(int frequency);
+	static void clear();
+	static void reportUsage(double usage);
+	static double getUsage();
+
+protected:
+	static int frequency;
+	static double usage;
+	static double sum;
+	static int count;
 };
\ No newline at end of file
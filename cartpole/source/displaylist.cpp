@@ -0,0 +1,99 @@
+#include "displaylist.h"
+
+std::atomic<unsigned int> DisplayList::nextId(1);
+
+DisplayList::DisplayList() :
+	id(nextId++)
+{
+}
+
+DisplayList::~DisplayList()
+{
+}
+
+void DisplayList::clear()
+{
+	/* A new identity invalidates the geometry cached by the drawing devices. */
+	id = nextId++;
+	items.clear();
+	points.clear();
+	segments.clear();
+	transforms.clear();
+}
+
+int DisplayList::addTransform()
+{
+	transforms.push_back({ 0, 0, 0 });
+	return static_cast<int>(transforms.size()) - 1;
+}
+
+void DisplayList::setTransform(int transform, double x, double y, double angle)
+{
+	transforms[transform] = { x, y, angle };
+}
+
+void DisplayList::fillBackground()
+{
+	addItem(Command::BACKGROUND, nullptr, -1);
+}
+
+void DisplayList::stripe(double x, double width, unsigned char red, unsigned char green, unsigned char blue)
+{
+	Item& item = addItem(Command::STRIPE, nullptr, -1);
+	item.values[0] = x;
+	item.values[1] = width;
+	item.red = red;
+	item.green = green;
+	item.blue = blue;
+}
+
+void DisplayList::ground(double left, double right, double top, Brush brush)
+{
+	Item& item = addItem(Command::GROUND, brush, -1);
+	item.values[0] = left;
+	item.values[1] = right;
+	item.values[2] = top;
+}
+
+void DisplayList::circle(const DrawingDevice::Point& center, double radius, Brush brush, int transform)
+{
+	Item& item = addItem(Command::CIRCLE, brush, transform);
+	item.first = static_cast<int>(points.size());
+	item.count = 1;
+	item.values[0] = radius;
+	points.push_back(center);
+}
+
+void DisplayList::polygon(const DrawingDevice::Point* points, int n, Brush brush, int transform)
+{
+	Item& item = addItem(Command::POLYGON, brush, transform);
+	item.first = static_cast<int>(this->points.size());
+	item.count = n;
+	this->points.insert(this->points.end(), points, points + n);
+}
+
+void DisplayList::polygonBezier(const DrawingDevice::Bezier* segments, int n, Brush brush, int transform)
+{
+	Item& item = addItem(Command::POLYGON_BEZIER, brush, transform);
+	item.first = static_cast<int>(this->segments.size());
+	item.count = n;
+	this->segments.insert(this->segments.end(), segments, segments + n);
+}
+
+DisplayList::Item& DisplayList::addItem(Command command, Brush brush, int transform)
+{
+	Item item;
+	item.command = command;
+	item.transform = transform;
+	item.brush = brush;
+	item.first = 0;
+	item.count = 0;
+	item.values[0] = 0;
+	item.values[1] = 0;
+	item.values[2] = 0;
+	item.red = 0;
+	item.green = 0;
+	item.blue = 0;
+	items.push_back(item);
+	return items.back();
+}
\ No newline at end of file
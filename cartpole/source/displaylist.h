@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include "drawingdevice.h"
+
+/* A recorded sequence of drawing commands in world coordinates, which may be
+   replayed on any drawing device. The drawing device caches the geometry of
+   the recorded shapes, so that the list is only re-recorded when the shapes
+   change. Shapes may be placed within a movable local coordinate system
+   (transform), which is changed without re-recording the list. */
+class DisplayList
+{
+public:
+	typedef ID2D1SolidColorBrush* DrawingDevice::* Brush;
+
+	enum class Command {
+		BACKGROUND,
+		STRIPE,
+		GROUND,
+		CIRCLE,
+		POLYGON,
+		POLYGON_BEZIER
+	};
+
+	struct Item {
+		Command command;
+		int transform;
+		Brush brush;
+		int first;
+		int count;
+		double values[3];
+		unsigned char red;
+		unsigned char green;
+		unsigned char blue;
+	};
+
+	struct Transform {
+		double x;
+		double y;
+		double angle;
+	};
+
+	DisplayList();
+	~DisplayList();
+
+	unsigned int getId() const { return id; }
+	int itemCount() const { return static_cast<int>(items.size()); }
+	const Item& getItem(int i) const { return items[i]; }
+	const DrawingDevice::Point& getPoint(int i) const { return points[i]; }
+	const DrawingDevice::Bezier& getSegment(int i) const { return segments[i]; }
+	const Transform& getTransform(int i) const { return transforms[i]; }
+
+	void clear();
+	int addTransform();
+	void setTransform(int transform, double x, double y, double angle);
+	void fillBackground();
+	void stripe(double x, double width, unsigned char red, unsigned char green, unsigned char blue);
+	void ground(double left, double right, double top, Brush brush);
+	void circle(const DrawingDevice::Point& center, double radius, Brush brush, int transform = -1);
+	void polygon(const DrawingDevice::Point* points, int n, Brush brush, int transform = -1);
+	void polygonBezier(const DrawingDevice::Bezier* segments, int n, Brush brush, int transform = -1);
+
+protected:
+	unsigned int id;
+	std::vector<Item> items;
+	std::vector<DrawingDevice::Point> points;
+	std::vector<DrawingDevice::Bezier> segments;
+	std::vector<Transform> transforms;
+
+private:
+	static std::atomic<unsigned int> nextId;
+
+	Item& addItem(Command command, Brush brush, int transform);
+};
\ No newline at end of file
@@ -1,118 +1,175 @@
-﻿#include <string>
-#include "engine.h"
-
-Engine::FunctionSimulatorInitialize Engine::simulatorInitialize = Engine::defaultSimulatorInitialize;
-Engine::FunctionSimulatorShutdown Engine::simulatorShutdown = Engine::defaultSimulatorShutdown;
-Engine::FunctionSetInitialState Engine::setInitialState = Engine::defaultSetInitialState;
-Engine::FunctionStateUpdated Engine::stateUpdated = Engine::defaultStateUpdated;
-Engine::FunctionApplyAction Engine::applyAction = Engine::defaultApplyAction;
-Engine::FunctionKeyPressed Engine::keyPressed = Engine::defaultKeyPressed;
-Engine::SimulatorParameters Engine::simulatorParameters;
-HMODULE	Engine::dll = nullptr;
-
-bool Engine::Initialize(const char* dllfile)
-{
-	if (dll != nullptr)
-		return false;
-
-	if (dllfile == nullptr || *dllfile == 0)
-		dll = LoadLibrary("cartpole.dll");
-	else
-		dll = LoadLibrary(dllfile);
-
-	if (dll != nullptr) {
-		Engine::simulatorInitialize =
-			(Engine::FunctionSimulatorInitialize)GetProcAddress(dll, "simulatorInitialize");
-		if (Engine::simulatorInitialize == nullptr)
-			Engine::simulatorInitialize = Engine::defaultSimulatorInitialize;
-
-		Engine::simulatorShutdown =
-			(Engine::FunctionSimulatorShutdown)GetProcAddress(dll, "simulatorShutdown");
-		if (Engine::simulatorShutdown == nullptr)
-			Engine::simulatorShutdown = Engine::defaultSimulatorShutdown;
-
-		Engine::setInitialState =
-			(Engine::FunctionSetInitialState)GetProcAddress(dll, "setInitialState");
-		if (Engine::setInitialState == nullptr)
-			Engine::setInitialState = Engine::defaultSetInitialState;
-
-		Engine::stateUpdated =
-			(Engine::FunctionStateUpdated)GetProcAddress(dll, "stateUpdated");
-		if (Engine::stateUpdated == nullptr)
-			Engine::stateUpdated = Engine::defaultStateUpdated;
-
-		Engine::applyAction =
-			(Engine::FunctionApplyAction)GetProcAddress(dll, "applyAction");
-		if (Engine::applyAction == nullptr)
-			Engine::applyAction = Engine::defaultApplyAction;
-
-		Engine::keyPressed =
-			(Engine::FunctionKeyPressed)GetProcAddress(dll, "keyPressed");
-		if (Engine::keyPressed == nullptr)
-			Engine::keyPressed = Engine::defaultKeyPressed;
-	}
-
-	return (dll != nullptr);
-}
-
-void Engine::Destroy()
-{
-	if (dll != nullptr) {
-		FreeLibrary(dll);
-		dll = nullptr;
-	}
-}
-
-void Engine::InitSimulatorParameters(SimulatorParameters* simulatorParameters)
-{
-	simulatorParameters->argv = nullptr;
-	simulatorParameters->argc = 0;
-	simulatorParameters->applicationType = UIType::GUI;
-	simulatorParameters->engineName = nullptr;
-	simulatorParameters->windowWidth = 1000;
-	simulatorParameters->windowHeight = 300;
-	simulatorParameters->actionFrequency = 50;
-	simulatorParameters->simulationSpeed = 1;
-	simulatorParameters->gravity = 9.81;
-	simulatorParameters->manualForce = 10.0;
-	simulatorParameters->cart = { 1.0, 1.0, 0.5 };
-	simulatorParameters->pole = { 1.0, 0.1, 0.5 };
-	simulatorParameters->camera = { 0.0, 0.0, 1.0 };
-	simulatorParameters->craters = nullptr;
-	simulatorParameters->markers = nullptr;
-	simulatorParameters->pLogBuffer = nullptr;
-	simulatorParameters->logFilename = nullptr;
-}
-
-void Engine::ClearLogBuffer()
-{
-	if (Engine::simulatorParameters.pLogBuffer != nullptr)
-		*Engine::simulatorParameters.pLogBuffer = 0;
-}
-
-void Engine::defaultSimulatorInitialize(SimulatorParameters& simulatorParameters)
-{
-}
-
-void Engine::defaultSimulatorShutdown()
-{
-}
-
-void Engine::defaultSetInitialState(InitialState& initialState)
-{
-}
-
-void Engine::defaultStateUpdated(double simulationTime, SimulationState simulationState, SimulationParameters& simulationParameters)
-{
-}
-
-void Engine::defaultApplyAction(CartAction& cartAction)
-{
-	cartAction.force = 0;
-	cartAction.options = ActionOptions::APPLY_MANUAL_ACTION;
-}
-
-int Engine::defaultKeyPressed(KeyInfo& keyInfo)
-{
-	return 0;
+﻿#include <string>
+#include "engine.h"
+#include "logchannel.h"
+
+Engine::FunctionSimulatorInitialize Engine::simulatorInitialize = Engine::defaultSimulatorInitialize;
+Engine::FunctionSimulatorShutdown Engine::simulatorShutdown = Engine::defaultSimulatorShutdown;
+Engine::FunctionSetInitialState Engine::setInitialState = Engine::defaultSetInitialState;
+Engine::FunctionStateUpdated Engine::stateUpdated = Engine::defaultStateUpdated;
+Engine::FunctionApplyAction Engine::applyAction = Engine::defaultApplyAction;
+Engine::FunctionKeyPressed Engine::keyPressed = Engine::defaultKeyPressed;
+Engine::FunctionEpisodeEnded Engine::episodeEnded = Engine::defaultEpisodeEnded;
+Engine::FunctionSaveState Engine::saveState = Engine::defaultSaveState;
+Engine::FunctionLoadState Engine::loadState = Engine::defaultLoadState;
+Engine::SimulatorParameters Engine::simulatorParameters;
+HMODULE	Engine::dll = nullptr;
+
+bool Engine::Initialize(const char* dllfile)
+{
+#ifdef _WIN32
+	if (dll != nullptr)
+		return false;
+
+	if (dllfile == nullptr || *dllfile == 0)
+		dll = LoadLibrary("cartpole.dll");
+	else
+		dll = LoadLibrary(dllfile);
+
+	if (dll != nullptr) {
+		Engine::simulatorInitialize =
+			(Engine::FunctionSimulatorInitialize)GetProcAddress(dll, "simulatorInitialize");
+		if (Engine::simulatorInitialize == nullptr)
+			Engine::simulatorInitialize = Engine::defaultSimulatorInitialize;
+
+		Engine::simulatorShutdown =
+			(Engine::FunctionSimulatorShutdown)GetProcAddress(dll, "simulatorShutdown");
+		if (Engine::simulatorShutdown == nullptr)
+			Engine::simulatorShutdown = Engine::defaultSimulatorShutdown;
+
+		Engine::setInitialState =
+			(Engine::FunctionSetInitialState)GetProcAddress(dll, "setInitialState");
+		if (Engine::setInitialState == nullptr)
+			Engine::setInitialState = Engine::defaultSetInitialState;
+
+		Engine::stateUpdated =
+			(Engine::FunctionStateUpdated)GetProcAddress(dll, "stateUpdated");
+		if (Engine::stateUpdated == nullptr)
+			Engine::stateUpdated = Engine::defaultStateUpdated;
+
+		Engine::applyAction =
+			(Engine::FunctionApplyAction)GetProcAddress(dll, "applyAction");
+		if (Engine::applyAction == nullptr)
+			Engine::applyAction = Engine::defaultApplyAction;
+
+		Engine::keyPressed =
+			(Engine::FunctionKeyPressed)GetProcAddress(dll, "keyPressed");
+		if (Engine::keyPressed == nullptr)
+			Engine::keyPressed = Engine::defaultKeyPressed;
+
+		Engine::episodeEnded =
+			(Engine::FunctionEpisodeEnded)GetProcAddress(dll, "episodeEnded");
+		if (Engine::episodeEnded == nullptr)
+			Engine::episodeEnded = Engine::defaultEpisodeEnded;
+
+		Engine::saveState =
+			(Engine::FunctionSaveState)GetProcAddress(dll, "saveState");
+		if (Engine::saveState == nullptr)
+			Engine::saveState = Engine::defaultSaveState;
+
+		Engine::loadState =
+			(Engine::FunctionLoadState)GetProcAddress(dll, "loadState");
+		if (Engine::loadState == nullptr)
+			Engine::loadState = Engine::defaultLoadState;
+	}
+
+	return (dll != nullptr);
+#else
+	return false;
+#endif
+}
+
+void Engine::Destroy()
+{
+#ifdef _WIN32
+	if (dll != nullptr) {
+		FreeLibrary(dll);
+		dll = nullptr;
+	}
+#endif
+}
+
+void Engine::InitSimulatorParameters(SimulatorParameters* simulatorParameters)
+{
+	simulatorParameters->argv = nullptr;
+	simulatorParameters->argc = 0;
+	simulatorParameters->applicationType = UIType::GUI;
+	simulatorParameters->engineName = nullptr;
+	simulatorParameters->windowWidth = 1000;
+	simulatorParameters->windowHeight = 300;
+	simulatorParameters->actionFrequency = 50;
+	simulatorParameters->simulationSpeed = 1;
+	simulatorParameters->gravity = 9.81;
+	simulatorParameters->manualForce = 10.0;
+	simulatorParameters->cart = { 1.0, 1.0, 0.5 };
+	simulatorParameters->pole = { 1.0, 0.1, 0.5 };
+	simulatorParameters->camera = { 0.0, 0.0, 1.0 };
+	simulatorParameters->craters = nullptr;
+	simulatorParameters->markers = nullptr;
+	simulatorParameters->pLogBuffer = nullptr;
+	simulatorParameters->logFilename = nullptr;
+	simulatorParameters->flightRecorderDuration = 30.0;
+	simulatorParameters->flightRecorderTriggers = FlightRecorderTrigger::DUMP_ON_TERMINATE;
+	simulatorParameters->logRecord = LogChannel::write;
+	simulatorParameters->renderFrequency = 0;
+	simulatorParameters->batchStates = nullptr;
+	simulatorParameters->batchSize = 0;
+	simulatorParameters->mosaicTiles = nullptr;
+	simulatorParameters->mosaicSize = 0;
+	simulatorParameters->mosaicColumns = 0;
+	simulatorParameters->termination = { 0.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, SimulationAction::RESET_SIMULATION };
+	simulatorParameters->randomization = {};
+	simulatorParameters->randomization.seed = 1;
+	simulatorParameters->checkpointFilename = nullptr;
+	simulatorParameters->checkpointInterval = 0;
+	simulatorParameters->runSequence = nullptr;
+	simulatorParameters->evaluateSequences = nullptr;
+	simulatorParameters->optimizeSequence = nullptr;
+	simulatorParameters->policyFilename = nullptr;
+}
+
+void Engine::ClearLogBuffer()
+{
+	if (Engine::simulatorParameters.pLogBuffer != nullptr)
+		*Engine::simulatorParameters.pLogBuffer = 0;
+}
+
+void Engine::defaultSimulatorInitialize(SimulatorParameters& simulatorParameters)
+{
+}
+
+void Engine::defaultSimulatorShutdown()
+{
+}
+
+void Engine::defaultSetInitialState(InitialState& initialState)
+{
+}
+
+void Engine::defaultStateUpdated(double simulationTime, SimulationState simulationState, SimulationParameters& simulationParameters)
+{
+}
+
+void Engine::defaultApplyAction(CartAction& cartAction)
+{
+	cartAction.force = 0;
+	cartAction.options = ActionOptions::APPLY_MANUAL_ACTION;
+}
+
+int Engine::defaultKeyPressed(KeyInfo& keyInfo)
+{
+	return 0;
+}
+
+void Engine::defaultEpisodeEnded(EpisodeStatistics episodeStatistics)
+{
+}
+
+int Engine::defaultSaveState(void* buffer, int size)
+{
+	return 0;
+}
+
+int Engine::defaultLoadState(const void* buffer, int size)
+{
+	return 1;
 }
\ No newline at end of file
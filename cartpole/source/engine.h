@@ -1,149 +1,310 @@
-#pragma once
-#include <Windows.h>
-
-class Engine
-{
-public:
-	enum UIType {
-		GUI = 0,
-		CONSOLE = 1
-	};
-	
-	enum ActionOptions {
-		APPLY_NO_ACTION = 0,
-		APPLY_FORCE = 1,
-		APPLY_MANUAL_ACTION = 2,
-		APPLY_FORCE_IF_NO_MANUAL_ACTION = 3
-	};
-
-	enum SimulationAction {
-		NO_SIMULATION_ACTION = 0,
-		RESET_SIMULATION = 1,
-		TERMINATE_SIMULATION = 2
-	};
-
-	enum CameraAction {
-		NO_CAMERA_ACTION = 0,
-		UPDATE_CAMERA = 1
-	};
-
-	enum KeyState {
-		UNPRESSED = 0,
-		PRESSED = 1
-	};
-
-	struct ObjectParameters {
-		double size;
-		double mass;
-		double damping;
-	};
-
-	struct CameraParameters {
-		double x;
-		double y;
-		double zoom;
-	};
-
-	struct Marker {
-		double x;
-		double width;
-		unsigned char red;
-		unsigned char green;
-		unsigned char blue;
-	};
-
-	struct Crater {
-		double x;
-		double width;
-		double depth;
-	};
-
-	struct SimulatorParameters {
-		char** argv;
-		int argc;
-		UIType applicationType;
-		const char* engineName;
-		int windowWidth;
-		int windowHeight;
-		int actionFrequency;
-		int simulationSpeed;
-		double gravity;
-		double manualForce;
-		ObjectParameters cart;
-		ObjectParameters pole;
-		CameraParameters camera;
-		const Crater* craters;
-		const Marker* markers;
-		char* pLogBuffer;
-		const char* logFilename;
-	};
-
-	struct SimulationParameters {
-		CameraParameters cameraParameters;
-		CameraAction cameraAction;
-		SimulationAction simulationAction;
-	};
-
-	struct InitialState {
-		double x;
-		double dx;
-		double ddx;
-		double theta;
-		double dtheta;
-		double ddtheta;
-	};
-
-	struct SimulationState {
-		double x;
-		double y;
-		double phi;
-		double dx;
-		double ddx;
-		double theta;
-		double dtheta;
-		double ddtheta;
-	};
-
-	struct CartAction {
-		double force;
-		Engine::ActionOptions options;
-	};
-
-	struct KeyInfo {
-		unsigned int code;
-		char character;
-		Engine::KeyState state;
-	};
-
-	typedef void (__cdecl* FunctionSimulatorInitialize)(SimulatorParameters&);
-	typedef void (__cdecl* FunctionSimulatorShutdown)();
-	typedef void (__cdecl* FunctionSetInitialState)(InitialState&);
-	typedef void (__cdecl* FunctionStateUpdated)(double, SimulationState, SimulationParameters&);
-	typedef void (__cdecl* FunctionApplyAction)(CartAction&);
-	typedef int (__cdecl* FunctionKeyPressed)(KeyInfo&);
-
-	static bool Initialize(const char* dllfile);
-	static void Destroy();
-	static bool isLoaded() { return dll != nullptr; }
-	static void InitSimulatorParameters(SimulatorParameters* simulatorParameters = &Engine::simulatorParameters);
-	static void ClearLogBuffer();
-
-	static SimulatorParameters simulatorParameters;
-	static FunctionSimulatorInitialize simulatorInitialize;
-	static FunctionSimulatorShutdown simulatorShutdown;
-	static FunctionSetInitialState setInitialState;
-	static FunctionStateUpdated stateUpdated;
-	static FunctionApplyAction applyAction;
-	static FunctionKeyPressed keyPressed;
-
-protected:
-	static void __cdecl defaultSimulatorInitialize(SimulatorParameters& simulatorParameters);
-	static void __cdecl defaultSimulatorShutdown();
-	static void __cdecl defaultSetInitialState(InitialState& initialState);
-	static void __cdecl defaultStateUpdated(double simulationTime, SimulationState simulationState, SimulationParameters& simulationParameters);
-	static void __cdecl defaultApplyAction(CartAction& cartAction);
-	static int __cdecl defaultKeyPressed(KeyInfo& keyInfo);
-
-private:
-	static HMODULE dll;
+#pragma once
+#ifdef _WIN32
+#include <Windows.h>
+#else
+/* Without Windows, only the parameters and the callbacks are available; no
+   engine is loaded. */
+#define __cdecl
+typedef void* HMODULE;
+#endif
+
+class Engine
+{
+public:
+	enum UIType {
+		GUI = 0,
+		CONSOLE = 1
+	};
+	
+	enum ActionOptions {
+		APPLY_NO_ACTION = 0,
+		APPLY_FORCE = 1,
+		APPLY_MANUAL_ACTION = 2,
+		APPLY_FORCE_IF_NO_MANUAL_ACTION = 3
+	};
+
+	enum SimulationAction {
+		NO_SIMULATION_ACTION = 0,
+		RESET_SIMULATION = 1,
+		TERMINATE_SIMULATION = 2
+	};
+
+	enum CameraAction {
+		NO_CAMERA_ACTION = 0,
+		UPDATE_CAMERA = 1
+	};
+
+	enum KeyState {
+		UNPRESSED = 0,
+		PRESSED = 1
+	};
+
+	enum LogLevel {
+		LOG_DEBUG = 0,
+		LOG_INFO = 1,
+		LOG_WARNING = 2,
+		LOG_ERROR = 3
+	};
+
+	enum FlightRecorderTrigger {
+		DUMP_MANUALLY = 0,
+		DUMP_ON_RESET = 1,
+		DUMP_ON_TERMINATE = 2
+	};
+
+	enum TerminationReason {
+		NOT_TERMINATED = 0,
+		ANGLE_LIMIT = 1,
+		POSITION_LIMIT = 2,
+		TARGET_REACHED = 3,
+		TIME_LIMIT = 4,
+		RESET_REQUESTED = 5,
+		TERMINATE_REQUESTED = 6
+	};
+
+	enum DistributionType {
+		FIXED_VALUE = 0,
+		UNIFORM_DISTRIBUTION = 1,
+		NORMAL_DISTRIBUTION = 2
+	};
+
+	struct ObjectParameters {
+		double size;
+		double mass;
+		double damping;
+	};
+
+	struct CameraParameters {
+		double x;
+		double y;
+		double zoom;
+	};
+
+	struct Marker {
+		double x;
+		double width;
+		unsigned char red;
+		unsigned char green;
+		unsigned char blue;
+	};
+
+	struct Crater {
+		double x;
+		double width;
+		double depth;
+	};
+
+	/* Rules checked by the simulator after every tick. A limit of 0 disables
+	   the rule; the action is taken when any rule applies (NO_SIMULATION_ACTION
+	   disables them all). */
+	struct TerminationRules {
+		double angleLimit;
+		double positionLimit;
+		double maxEpisodeTime;
+		double targetX;
+		double targetWidth;
+		double stepReward;
+		double targetReward;
+		SimulationAction action;
+	};
+
+	/* Uniform in [a, b] or normal with the mean a and the standard deviation b.
+	   A fixed value keeps the value of the simulator parameters (or the one
+	   given by the engine in setInitialState). */
+	struct Distribution {
+		DistributionType type;
+		double a;
+		double b;
+	};
+
+	/* Distributions sampled on every reset. The seed and the stream select
+	   a reproducible sequence of episodes; environments of a batch use
+	   different streams. */
+	struct Randomization {
+		unsigned long long seed;
+		unsigned long long stream;
+		Distribution cartMass;
+		Distribution cartDamping;
+		Distribution poleMass;
+		Distribution poleSize;
+		Distribution poleDamping;
+		Distribution gravity;
+		Distribution x;
+		Distribution dx;
+		Distribution theta;
+		Distribution dtheta;
+	};
+
+	struct EpisodeStatistics {
+		int number;
+		int length;
+		double time;
+		double episodeReturn;
+		TerminationReason reason;
+	};
+
+	struct SimulationState;
+	struct MosaicTile;
+
+	typedef int (__cdecl* FunctionLogRecord)(LogLevel, const char*, const void*, int);
+
+	/* Simulates the cart from a state under k forces, one per action period,
+	   without calling back the engine; the simulation itself is not affected.
+	   Writes the k states to the trajectory and returns k (0 if not available). */
+	typedef int (__cdecl* FunctionRunSequence)(const SimulationState*, const double*, int, SimulationState*);
+
+	/* Cost of a sequence of forces: the sum over the ticks of e'Q e + R F^2,
+	   plus e'Qf e after the last tick, where e is the state (x, dx, theta,
+	   dtheta) less the target, with the angle wrapped to [-pi, pi). The
+	   matrices are 4x4, row by row. */
+	struct QuadraticCost {
+		double target[4];
+		double Q[16];
+		double R;
+		double Qf[16];
+	};
+
+	/* Simulates m sequences of k forces (one sequence after the other) from
+	   the same state, like FunctionRunSequence, and writes the cost of every
+	   sequence. Returns m (0 if not available). */
+	typedef int (__cdecl* FunctionEvaluateSequences)(const SimulationState*, const double*, int, int, const QuadraticCost*, double*);
+
+	/* Settings of the trajectory optimiser: the maximum number of iterations,
+	   the bound on the magnitude of the forces (0 for none) and the relative
+	   improvement of the cost below which the optimiser stops. */
+	struct OptimizerSettings {
+		int iterations;
+		double forceLimit;
+		double tolerance;
+	};
+
+	/* Optimises k forces, one per action period, from a state for the cost
+	   with iLQR on the dynamics of the simulation. The forces hold the initial
+	   guess on entry (e.g. the previous plan shifted by one period) and the
+	   optimised forces on return; the cost of the result is written to the last
+	   argument (may be null). Returns the number of iterations (0 if not
+	   available). */
+	typedef int (__cdecl* FunctionOptimizeSequence)(const SimulationState*, double*, int, const QuadraticCost*, const OptimizerSettings*, double*);
+
+	struct SimulatorParameters {
+		char** argv;
+		int argc;
+		UIType applicationType;
+		const char* engineName;
+		int windowWidth;
+		int windowHeight;
+		int actionFrequency;
+		int simulationSpeed;
+		double gravity;
+		double manualForce;
+		ObjectParameters cart;
+		ObjectParameters pole;
+		CameraParameters camera;
+		const Crater* craters;
+		const Marker* markers;
+		char* pLogBuffer;
+		const char* logFilename;
+		double flightRecorderDuration;
+		int flightRecorderTriggers;
+		FunctionLogRecord logRecord;
+		int renderFrequency;
+		const SimulationState* batchStates;
+		int batchSize;
+		const MosaicTile* mosaicTiles;
+		int mosaicSize;
+		int mosaicColumns;
+		TerminationRules termination;
+		Randomization randomization;
+		const char* checkpointFilename;
+		double checkpointInterval;
+		FunctionRunSequence runSequence;
+		FunctionEvaluateSequences evaluateSequences;
+		FunctionOptimizeSequence optimizeSequence;
+		const char* policyFilename;
+	};
+
+	struct SimulationParameters {
+		CameraParameters cameraParameters;
+		CameraAction cameraAction;
+		SimulationAction simulationAction;
+	};
+
+	struct InitialState {
+		double x;
+		double dx;
+		double ddx;
+		double theta;
+		double dtheta;
+		double ddtheta;
+	};
+
+	struct SimulationState {
+		double x;
+		double y;
+		double phi;
+		double dx;
+		double ddx;
+		double theta;
+		double dtheta;
+		double ddtheta;
+	};
+
+	struct MosaicTile {
+		SimulationState state;
+		CameraParameters camera;
+		const Crater* craters;
+		unsigned int cratersVersion;
+	};
+
+	struct CartAction {
+		double force;
+		Engine::ActionOptions options;
+	};
+
+	struct KeyInfo {
+		unsigned int code;
+		char character;
+		Engine::KeyState state;
+	};
+
+	typedef void (__cdecl* FunctionSimulatorInitialize)(SimulatorParameters&);
+	typedef void (__cdecl* FunctionSimulatorShutdown)();
+	typedef void (__cdecl* FunctionSetInitialState)(InitialState&);
+	typedef void (__cdecl* FunctionStateUpdated)(double, SimulationState, SimulationParameters&);
+	typedef void (__cdecl* FunctionApplyAction)(CartAction&);
+	typedef int (__cdecl* FunctionKeyPressed)(KeyInfo&);
+	typedef void (__cdecl* FunctionEpisodeEnded)(EpisodeStatistics);
+	typedef int (__cdecl* FunctionSaveState)(void*, int);
+	typedef int (__cdecl* FunctionLoadState)(const void*, int);
+
+	static bool Initialize(const char* dllfile);
+	static void Destroy();
+	static bool isLoaded() { return dll != nullptr; }
+	static void InitSimulatorParameters(SimulatorParameters* simulatorParameters = &Engine::simulatorParameters);
+	static void ClearLogBuffer();
+
+	static SimulatorParameters simulatorParameters;
+	static FunctionSimulatorInitialize simulatorInitialize;
+	static FunctionSimulatorShutdown simulatorShutdown;
+	static FunctionSetInitialState setInitialState;
+	static FunctionStateUpdated stateUpdated;
+	static FunctionApplyAction applyAction;
+	static FunctionKeyPressed keyPressed;
+	static FunctionEpisodeEnded episodeEnded;
+	static FunctionSaveState saveState;
+	static FunctionLoadState loadState;
+
+protected:
+	static void __cdecl defaultSimulatorInitialize(SimulatorParameters& simulatorParameters);
+	static void __cdecl defaultSimulatorShutdown();
+	static void __cdecl defaultSetInitialState(InitialState& initialState);
+	static void __cdecl defaultStateUpdated(double simulationTime, SimulationState simulationState, SimulationParameters& simulationParameters);
+	static void __cdecl defaultApplyAction(CartAction& cartAction);
+	static int __cdecl defaultKeyPressed(KeyInfo& keyInfo);
+	static void __cdecl defaultEpisodeEnded(EpisodeStatistics episodeStatistics);
+	static int __cdecl defaultSaveState(void* buffer, int size);
+	static int __cdecl defaultLoadState(const void* buffer, int size);
+
+private:
+	static HMODULE dll;
 };
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include "episodebatch.h"
+#include "randomizer.h"
+#include "termination.h"
+
+/* A lane whose episode has ended is not reset; it is stepped with the
+   others, and its results ignored, until the compaction drops it. */
+static const uint8_t LANE_ENDED = 0;
+static const uint8_t LANE_RUNNING = 1;
+
+/* Ended lanes tolerated before the compaction, by default. */
+static const double defaultCompaction = 0.125;
+
+EpisodeBatch::EpisodeBatch(int count, const Engine::SimulatorParameters& simulatorParameters) :
+	count(count > 0 ? count : 1),
+	lanes(0),
+	running(0),
+	compaction(defaultCompaction),
+	episode(0),
+	ticks(0),
+	time(0),
+	x(this->count),
+	y(this->count),
+	dx(this->count),
+	ddx(this->count),
+	theta(this->count),
+	dtheta(this->count),
+	ddtheta(this->count),
+	phi(this->count),
+	returns(this->count),
+	ids(this->count),
+	states(this->count),
+	active(this->count),
+	environmentPhysics(this->count),
+	initialPhysics(this->count),
+	initialStates(this->count),
+	results(this->count)
+{
+	dt = 1.0 / simulatorParameters.actionFrequency;
+	wheelDistance = 3 * simulatorParameters.cart.size / 5;
+	leftBound = -100 + simulatorParameters.cart.size / 2;
+	rightBound = 100 - simulatorParameters.cart.size / 2;
+	termination = simulatorParameters.termination;
+	randomization = simulatorParameters.randomization;
+	randomized = Randomizer::isEnabled(randomization);
+
+	simulatorPhysics.cartMass = simulatorParameters.cart.mass;
+	simulatorPhysics.cartDamping = simulatorParameters.cart.damping;
+	simulatorPhysics.poleMass = simulatorParameters.pole.mass;
+	simulatorPhysics.poleLength = simulatorParameters.pole.size;
+	simulatorPhysics.poleDamping = simulatorParameters.pole.damping;
+	simulatorPhysics.gravity = simulatorParameters.gravity;
+	uniform = !Randomizer::isPhysicsEnabled(randomization);
+	physics.resize(this->count);
+
+	/* The floor is computed here, so the craters need not outlive the batch. */
+	terrain.compute(simulatorParameters.craters);
+	flat = terrain.isFlat();
+
+	for (int id = 0; id < this->count; id++) {
+		environmentPhysics[id] = simulatorPhysics;
+		results[id] = {};
+	}
+}
+
+EpisodeBatch::~EpisodeBatch()
+{
+}
+
+void EpisodeBatch::setParameters(int id, const PhysicalParameters& parameters)
+{
+	environmentPhysics[id] = parameters;
+	uniform = false;
+}
+
+int EpisodeBatch::start(double* observations)
+{
+	/* The environment i samples its episodes from the stream
+	   randomization.stream + i, as the lane i of a BatchSimulator does. */
+	episode++;
+	for (int id = 0; id < count; id++) {
+		initialPhysics[id] = environmentPhysics[id];
+		initialStates[id] = {};
+	}
+	if (randomized)
+		Randomizer::sample(randomization, randomization.stream, count, episode, &initialPhysics[0], &initialStates[0]);
+
+	for (int id = 0; id < count; id++) {
+		const Engine::InitialState& state = initialStates[id];
+		physics.set(id, initialPhysics[id]);
+		x[id] = state.x;
+		dx[id] = state.dx;
+		ddx[id] = state.ddx;
+		theta[id] = state.theta;
+		dtheta[id] = state.dtheta;
+		ddtheta[id] = state.ddtheta;
+		terrain.align(x[id], wheelDistance, y[id], phi[id]);
+		returns[id] = 0;
+		ids[id] = id;
+		states[id] = LANE_RUNNING;
+
+		results[id] = {};
+		results[id].number = static_cast<int>(episode);
+	}
+
+	lanes = count;
+	running = count;
+	ticks = 0;
+	time = 0;
+
+	if (observations != nullptr)
+		observe(observations);
+
+	return lanes;
+}
+
+int EpisodeBatch::step(const double* forces, double* observations, double* rewards, uint8_t* dones)
+{
+	if (running == 0)
+		return 0;
+
+	/* Every lane in use is stepped, so that the passes have no branches; the
+	   ended ones are dropped by the compaction. */
+	if (uniform) {
+		CartPhysics::stepLanes(lanes, dt, simulatorPhysics, forces, &phi[0],
+			&x[0], &y[0], &dx[0], &ddx[0], &theta[0], &dtheta[0], &ddtheta[0]);
+	}
+	else {
+		CartPhysics::stepLanes(lanes, dt, physics, forces, &phi[0],
+			&x[0], &y[0], &dx[0], &ddx[0], &theta[0], &dtheta[0], &ddtheta[0]);
+	}
+
+	if (!flat)
+		terrain.alignLanes(lanes, &x[0], wheelDistance, &y[0], &phi[0]);
+
+	/* Prevent the cart from falling over the edge. */
+	for (int lane = 0; lane < lanes; lane++) {
+		if (x[lane] < leftBound || x[lane] > rightBound) {
+			x[lane] = (x[lane] < leftBound ? leftBound : rightBound);
+			dx[lane] = -dx[lane] * 0.5;
+			ddx[lane] = 0;
+		}
+	}
+
+	/* The episodes started together, so the running ones share their length. */
+	ticks++;
+	time += dt;
+	int ended = 0;
+	for (int lane = 0; lane < lanes; lane++) {
+		if (states[lane] == LANE_ENDED) {
+			ended++;
+			continue;
+		}
+
+		int id = ids[lane];
+		Engine::TerminationReason reason = Termination::check(termination, x[lane], theta[lane], time, dt);
+		double reward = termination.stepReward;
+		if (reason == Engine::TerminationReason::TARGET_REACHED)
+			reward += termination.targetReward;
+		returns[lane] += reward;
+
+		Engine::EpisodeStatistics& result = results[id];
+		result.length = ticks;
+		result.time = time;
+		result.episodeReturn = returns[lane];
+		result.reason = reason;
+
+		if (rewards != nullptr)
+			rewards[id] = reward;
+		if (dones != nullptr)
+			dones[id] = static_cast<uint8_t>(reason);
+
+		if (reason != Engine::TerminationReason::NOT_TERMINATED) {
+			states[lane] = LANE_ENDED;
+			running--;
+			ended++;
+		}
+	}
+
+	if (running == 0)
+		lanes = 0;
+	else if (ended > compaction * lanes)
+		compact();
+
+	if (observations != nullptr)
+		observe(observations);
+
+	return lanes;
+}
+
+template <typename T> void EpisodeBatch::gather(std::vector<T>& values, const std::vector<int>& active, int count)
+{
+	/* The lanes only move towards the front, so the gather works in place. */
+	for (int i = 0; i < count; i++)
+		values[i] = values[active[i]];
+}
+
+void EpisodeBatch::compact()
+{
+	/* The running lanes keep their order, so the ids of the lanes stay sorted. */
+	int kept = 0;
+	for (int lane = 0; lane < lanes; lane++) {
+		if (states[lane] == LANE_RUNNING)
+			active[kept++] = lane;
+	}
+
+	gather(x, active, kept);
+	gather(y, active, kept);
+	gather(dx, active, kept);
+	gather(ddx, active, kept);
+	gather(theta, active, kept);
+	gather(dtheta, active, kept);
+	gather(ddtheta, active, kept);
+	gather(phi, active, kept);
+	physics.gather(&active[0], kept);
+	gather(returns, active, kept);
+	gather(ids, active, kept);
+	for (int lane = 0; lane < kept; lane++)
+		states[lane] = LANE_RUNNING;
+
+	lanes = kept;
+}
+
+void EpisodeBatch::observe(double* observations) const
+{
+	for (int lane = 0; lane < lanes; lane++) {
+		double* observation = observations + lane * OBSERVATION_SIZE;
+		observation[OBSERVATION_X] = x[lane];
+		observation[OBSERVATION_DX] = dx[lane];
+		observation[OBSERVATION_THETA] = theta[lane];
+		observation[OBSERVATION_DTHETA] = dtheta[lane];
+		observation[OBSERVATION_PHI] = phi[lane];
+	}
+}
\ No newline at end of file
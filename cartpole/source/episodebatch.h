@@ -0,0 +1,110 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "engine.h"
+#include "physics.h"
+#include "terrain.h"
+
+/* Runs one episode in each of a batch of environments until the termination
+   rules end them all, e.g. to evaluate a policy. Unlike BatchSimulator, an
+   environment whose episode has ended is not reset: its lane is dropped. The
+   running lanes are kept at the front of the arrays (one array per
+   quantity) by compacting them from time to time, so the passes over the
+   lanes stay dense when most episodes end early. An environment keeps its
+   id (0..count-1) when its lane moves; the ids of the lanes tell which
+   environment an observation or a force belongs to. */
+class EpisodeBatch
+{
+public:
+	/* Layout of the observation of one lane, as in BatchSimulator. */
+	enum Observation {
+		OBSERVATION_X = 0,
+		OBSERVATION_DX,
+		OBSERVATION_THETA,
+		OBSERVATION_DTHETA,
+		OBSERVATION_PHI,
+		OBSERVATION_SIZE
+	};
+
+	EpisodeBatch() = delete;
+	EpisodeBatch(int count, const Engine::SimulatorParameters& simulatorParameters);
+	~EpisodeBatch();
+
+	int getCount() const { return count; }
+
+	/* The lanes in use, the ended ones that are not compacted yet included. */
+	int getLaneCount() const { return lanes; }
+	int getRunningCount() const { return running; }
+	const int* getIds() const { return &ids[0]; }
+	bool isRunning(int lane) const { return states[lane] != 0; }
+
+	/* The episode of an environment: the statistics so far while it runs. */
+	const Engine::EpisodeStatistics& getEpisode(int id) const { return results[id]; }
+
+	/* Gives an environment its own physical parameters instead of the
+	   simulator ones, from its next episode; the quantities that are
+	   randomised are still sampled. */
+	void setParameters(int id, const PhysicalParameters& parameters);
+
+	/* The lanes are compacted after a tick that leaves more than the given
+	   fraction of them ended (0 after every tick that ends an episode; 1
+	   only once all have ended). */
+	void setCompaction(double fraction) { compaction = fraction; }
+
+	/* Starts a new episode in every environment, with the lane i holding the
+	   environment i, and returns the number of lanes. The observations hold
+	   OBSERVATION_SIZE values per environment and may be nullptr. */
+	int start(double* observations);
+
+	/* Applies one force per lane for one tick and returns the number of
+	   lanes after it, 0 once every episode has ended. The rewards and the
+	   dones are indexed by the environment id and written only for the
+	   episodes that were running; a done is the Engine::TerminationReason of
+	   the episode. The observations are written per lane, after the
+	   compaction, so that they go with the ids and the next forces. Any
+	   output may be nullptr. */
+	int step(const double* forces, double* observations, double* rewards, uint8_t* dones);
+
+protected:
+	int count;
+	int lanes;
+	int running;
+	double compaction;
+	uint32_t episode;
+	int ticks;
+	double time;
+	double dt;
+	double wheelDistance;
+	double leftBound;
+	double rightBound;
+	bool flat;
+	Engine::TerminationRules termination;
+	Engine::Randomization randomization;
+	bool randomized;
+	PhysicalParameters simulatorPhysics;
+	bool uniform;
+	Terrain terrain;
+
+	std::vector<double> x;
+	std::vector<double> y;
+	std::vector<double> dx;
+	std::vector<double> ddx;
+	std::vector<double> theta;
+	std::vector<double> dtheta;
+	std::vector<double> ddtheta;
+	std::vector<double> phi;
+	PhysicsColumns physics;
+	std::vector<double> returns;
+	std::vector<int> ids;
+	std::vector<uint8_t> states;
+	std::vector<int> active;
+	std::vector<PhysicalParameters> environmentPhysics;
+	std::vector<PhysicalParameters> initialPhysics;
+	std::vector<Engine::InitialState> initialStates;
+	std::vector<Engine::EpisodeStatistics> results;
+
+	void compact();
+	void observe(double* observations) const;
+
+	template <typename T> static void gather(std::vector<T>& values, const std::vector<int>& active, int count);
+};
\ No newline at end of file
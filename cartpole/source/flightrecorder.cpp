@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include "flightrecorder.h"
+
+/* The header of a dump, and the room of a row in the reserved text; longer
+   rows only make the text grow. */
+static const char header[] = "frame;time;F;x;y;theta;phi;x';x'';theta';theta''\n";
+static const size_t rowSize = 128;
+
+FlightRecorder::FlightRecorder(double seconds, double fps) :
+	head(0),
+	count(0),
+	nextFile(1)
+{
+	int size = static_cast<int>(seconds * fps);
+	frames.resize(size > 0 ? size : 1);
+	text.reserve(sizeof(header) + frames.size() * rowSize);
+}
+
+FlightRecorder::~FlightRecorder()
+{
+}
+
+void FlightRecorder::snap(
+	double time,
+	double F,
+	double x,
+	double y,
+	double theta,
+	double phi,
+	double dx,
+	double ddx,
+	double dtheta,
+	double ddtheta
+) {
+	CompactFrame& frame = frames[head];
+	frame.time = time;
+	frame.F = static_cast<float>(F);
+	frame.x = static_cast<float>(x);
+	frame.y = static_cast<float>(y);
+	frame.theta = static_cast<float>(theta);
+	frame.phi = static_cast<float>(phi);
+	frame.dx = static_cast<float>(dx);
+	frame.ddx = static_cast<float>(ddx);
+	frame.dtheta = static_cast<float>(dtheta);
+	frame.ddtheta = static_cast<float>(ddtheta);
+
+	head++;
+	if (head >= static_cast<int>(frames.size()))
+		head = 0;
+	if (count < static_cast<int>(frames.size()))
+		count++;
+}
+
+void FlightRecorder::clear()
+{
+	head = 0;
+	count = 0;
+}
+
+bool FlightRecorder::save(std::string& fileName)
+{
+	/* Find the first free file name after the last one saved. */
+	int i = nextFile;
+	fileName = "flightrecorder" + std::to_string(i) + ".csv";
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+	while (file == INVALID_HANDLE_VALUE) {
+		if (GetLastError() != ERROR_FILE_EXISTS)
+			return false;
+		i++;
+		fileName = "flightrecorder" + std::to_string(i) + ".csv";
+		file = CreateFileA(fileName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+	}
+	nextFile = i + 1;
+
+	text.assign(header, header + sizeof(header) - 1);
+
+	/* The oldest frame is at the head, if the buffer has already wrapped around. */
+	int size = static_cast<int>(frames.size());
+	int index = (count < size ? 0 : head);
+	for (int n = 0; n < count; n++) {
+		const CompactFrame& frame = frames[index];
+		char row[1024];
+		int length = snprintf(row, sizeof(row), "%d;%f;%f;%f;%f;%f;%f;%f;%f;%f;%f\n",
+			n + 1, frame.time, frame.F, frame.x, frame.y, frame.theta, frame.phi,
+			frame.dx, frame.ddx, frame.dtheta, frame.ddtheta);
+		if (length > 0)
+			text.insert(text.end(), row, row + (length < static_cast<int>(sizeof(row)) ? length : sizeof(row) - 1));
+		index++;
+		if (index >= size)
+			index = 0;
+	}
+
+	DWORD bytesWritten = 0;
+	bool written = WriteFile(file, text.data(), static_cast<DWORD>(text.size()), &bytesWritten, nullptr) &&
+		bytesWritten == text.size();
+	CloseHandle(file);
+
+	return written;
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+#include <Windows.h>
+#include <string>
+#include <vector>
+
+/* Keeps the last few seconds of the simulation at all times, so that the
+   frames preceding an unexpected event can be saved after the fact. The
+   buffer is allocated once and then overwritten in a circular manner. */
+class FlightRecorder
+{
+public:
+	FlightRecorder() = delete;
+	FlightRecorder(double seconds, double fps);
+	~FlightRecorder();
+
+	int capacity() const { return static_cast<int>(frames.size()); }
+	int frameCount() const { return count; }
+	void snap(
+		double time,
+		double F,
+		double x,
+		double y,
+		double theta,
+		double phi,
+		double dx,
+		double ddx,
+		double dtheta,
+		double ddtheta
+	);
+	void clear();
+
+	/* Writes the frames to the next free flightrecorder<n>.csv with one
+	   write; the search for a free name starts after the last file saved. */
+	bool save(std::string& fileName);
+
+protected:
+	/* Compact frame: only the time needs the double precision. */
+	struct CompactFrame {
+		double time;
+		float F;
+		float x;
+		float y;
+		float theta;
+		float phi;
+		float dx;
+		float ddx;
+		float dtheta;
+		float ddtheta;
+	};
+
+	std::vector<CompactFrame> frames;
+	int head;
+	int count;
+	int nextFile;
+
+	/* The text of a dump, reserved for the whole buffer up front. */
+	std::vector<char> text;
+};
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "framestream.h"
+
+static const ArrowStream::Column columns[FrameStream::COLUMN_COUNT] = {
+	{ "episode", ArrowStream::INT32 },
+	{ "environment", ArrowStream::INT32 },
+	{ "frame", ArrowStream::INT32 },
+	{ "time", ArrowStream::FLOAT64 },
+	{ "F", ArrowStream::FLOAT64 },
+	{ "x", ArrowStream::FLOAT64 },
+	{ "y", ArrowStream::FLOAT64 },
+	{ "theta", ArrowStream::FLOAT64 },
+	{ "phi", ArrowStream::FLOAT64 },
+	{ "dx", ArrowStream::FLOAT64 },
+	{ "ddx", ArrowStream::FLOAT64 },
+	{ "dtheta", ArrowStream::FLOAT64 },
+	{ "ddtheta", ArrowStream::FLOAT64 },
+	{ "camerax", ArrowStream::FLOAT64 },
+	{ "cameray", ArrowStream::FLOAT64 },
+	{ "zoom", ArrowStream::FLOAT64 }
+};
+
+FrameStream::FrameStream(int batchRows) :
+	batchRows(batchRows > 0 ? batchRows : 1),
+	rows(0),
+	failed(false)
+{
+	for (std::vector<int32_t>& column : numbers)
+		column.resize(this->batchRows);
+	for (std::vector<double>& column : values)
+		column.resize(this->batchRows);
+}
+
+FrameStream::~FrameStream()
+{
+	close();
+}
+
+bool FrameStream::open(const char* fileName)
+{
+	rows = 0;
+	error.clear();
+	failed = !stream.open(fileName, columns, COLUMN_COUNT, error);
+	return !failed;
+}
+
+bool FrameStream::close()
+{
+	if (!stream.isOpen())
+		return !failed;
+
+	flush();
+	if (!stream.close(error))
+		failed = true;
+	return !failed;
+}
+
+bool FrameStream::add(
+	int episode,
+	int environment,
+	int frame,
+	double time,
+	double F,
+	double x,
+	double y,
+	double theta,
+	double phi,
+	double dx,
+	double ddx,
+	double dtheta,
+	double ddtheta,
+	double camerax,
+	double cameray,
+	double zoom
+) {
+	if (rows == batchRows && !flush())
+		return false;
+
+	numbers[COLUMN_EPISODE][rows] = episode;
+	numbers[COLUMN_ENVIRONMENT][rows] = environment;
+	numbers[COLUMN_FRAME][rows] = frame;
+	values[COLUMN_TIME - COLUMN_TIME][rows] = time;
+	values[COLUMN_F - COLUMN_TIME][rows] = F;
+	values[COLUMN_X - COLUMN_TIME][rows] = x;
+	values[COLUMN_Y - COLUMN_TIME][rows] = y;
+	values[COLUMN_THETA - COLUMN_TIME][rows] = theta;
+	values[COLUMN_PHI - COLUMN_TIME][rows] = phi;
+	values[COLUMN_DX - COLUMN_TIME][rows] = dx;
+	values[COLUMN_DDX - COLUMN_TIME][rows] = ddx;
+	values[COLUMN_DTHETA - COLUMN_TIME][rows] = dtheta;
+	values[COLUMN_DDTHETA - COLUMN_TIME][rows] = ddtheta;
+	values[COLUMN_CAMERAX - COLUMN_TIME][rows] = camerax;
+	values[COLUMN_CAMERAY - COLUMN_TIME][rows] = cameray;
+	values[COLUMN_ZOOM - COLUMN_TIME][rows] = zoom;
+	rows++;
+	return !failed;
+}
+
+bool FrameStream::add(const BatchSimulator& batch, const double* forces)
+{
+	for (int lane = 0; lane < batch.getCount(); lane++) {
+		const Engine::EpisodeStatistics& episode = batch.getEpisode(lane);
+		Engine::SimulationState state = batch.getState(lane);
+		bool added = add(episode.number, lane, episode.length + 1, episode.time, forces[lane],
+			state.x, state.y, state.theta, state.phi, state.dx, state.ddx, state.dtheta, state.ddtheta, 0, 0, 1);
+		if (!added)
+			return false;
+	}
+	return true;
+}
+
+bool FrameStream::flush()
+{
+	if (failed || !stream.isOpen())
+		return false;
+	if (rows == 0)
+		return true;
+
+	const void* columnValues[COLUMN_COUNT];
+	for (int column = 0; column < COLUMN_COUNT; column++)
+		columnValues[column] = (column < COLUMN_TIME ? static_cast<const void*>(&numbers[column][0]) : &values[column - COLUMN_TIME][0]);
+	failed = !stream.write(rows, columnValues, error);
+	rows = 0;
+	return !failed;
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "arrowstream.h"
+#include "batchsimulator.h"
+
+/* Frames of the cart written to an Arrow stream, with the fields of the
+   frames of a recording plus the episode and the environment they belong
+   to. The frames are collected as columns and written as a record batch
+   whenever a batch is full, so that a long run needs no more memory than
+   one batch. A recording writes the frames of environment 0; a batch of
+   environments writes one frame per lane and step. The frames of an episode
+   are numbered from 1, as in the frames.csv of a recording, and frame n is
+   the state at the time (n - 1) * dt, before the nth step. */
+class FrameStream
+{
+public:
+	enum Column {
+		COLUMN_EPISODE = 0,
+		COLUMN_ENVIRONMENT,
+		COLUMN_FRAME,
+		COLUMN_TIME,
+		COLUMN_F,
+		COLUMN_X,
+		COLUMN_Y,
+		COLUMN_THETA,
+		COLUMN_PHI,
+		COLUMN_DX,
+		COLUMN_DDX,
+		COLUMN_DTHETA,
+		COLUMN_DDTHETA,
+		COLUMN_CAMERAX,
+		COLUMN_CAMERAY,
+		COLUMN_ZOOM,
+		COLUMN_COUNT
+	};
+
+	FrameStream() = delete;
+	FrameStream(int batchRows);
+	~FrameStream();
+
+	bool open(const char* fileName);
+
+	/* Writes the frames collected so far and the end of the stream. */
+	bool close();
+	const std::string& getError() const { return error; }
+
+	/* Each call returns false once a write has failed. */
+	bool add(
+		int episode,
+		int environment,
+		int frame,
+		double time,
+		double F,
+		double x,
+		double y,
+		double theta,
+		double phi,
+		double dx,
+		double ddx,
+		double dtheta,
+		double ddtheta,
+		double camerax,
+		double cameray,
+		double zoom
+	);
+
+	/* One frame per lane: the state of the lane before a step, the force
+	   of the step, and the episode, the frame (the ticks of the episode so
+	   far plus 1) and the time within it. The camera of the frames is that
+	   of a new recording. */
+	bool add(const BatchSimulator& batch, const double* forces);
+
+	/* Writes the frames collected so far as a record batch. */
+	bool flush();
+
+protected:
+	ArrowStream stream;
+	int batchRows;
+	int rows;
+	bool failed;
+	std::string error;
+
+	/* The episode, the environment and the frame; then the other columns. */
+	std::vector<int32_t> numbers[COLUMN_TIME];
+	std::vector<double> values[COLUMN_COUNT - COLUMN_TIME];
+};
\ No newline at end of file
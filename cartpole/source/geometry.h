@@ -0,0 +1,23 @@
+#pragma once
+
+/* Points and quadratic Bezier segments in world coordinates, shared by the
+   terrain and the drawing device. */
+class Point {
+public:
+	Point() : x(0), y(0) {}
+	Point(double x, double y) : x(x), y(y) {}
+	~Point() {}
+	double x, y;
+};
+
+class Bezier {
+public:
+	Bezier(
+		Point control,
+		Point end
+	) : control(control),
+		end(end) {}
+	~Bezier() {}
+	Point control;
+	Point end;
+};
\ No newline at end of file
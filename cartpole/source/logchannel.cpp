@@ -0,0 +1,128 @@
+#include <string.h>
+#include <stdio.h>
+#include "logchannel.h"
+
+LogChannel::Slot LogChannel::slots[LogChannel::capacity];
+std::atomic<size_t> LogChannel::writePosition(0);
+size_t LogChannel::readPosition = 0;
+std::atomic<unsigned int> LogChannel::dropped(0);
+std::atomic<double> LogChannel::time(0);
+const bool LogChannel::initialized = LogChannel::initialize();
+
+bool LogChannel::initialize()
+{
+	/* The slot sequence tells the position for which the slot is free to be written. */
+	for (int i = 0; i < capacity; i++)
+		slots[i].sequence.store(i, std::memory_order_relaxed);
+
+	return true;
+}
+
+void LogChannel::setTime(double time)
+{
+	LogChannel::time.store(time, std::memory_order_relaxed);
+}
+
+int LogChannel::write(Engine::LogLevel level, const char* text, const void* payload, int payloadSize)
+{
+	/* Claim a position. The slot at the position is free, if its sequence equals
+	   the position. If the sequence is behind, the reader has not yet consumed
+	   the slot and the queue is full. */
+	size_t position = writePosition.load(std::memory_order_relaxed);
+	Slot* slot = nullptr;
+	while (true) {
+		slot = &slots[position % capacity];
+		size_t sequence = slot->sequence.load(std::memory_order_acquire);
+		if (sequence == position) {
+			if (writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (sequence < position) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return 0;
+		}
+		else {
+			position = writePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	/* Fill the record. The text and the payload share the data; both are truncated if too long. */
+	Record& record = slot->record;
+	record.time = time.load(std::memory_order_relaxed);
+	record.level = level;
+	int textLength = (text != nullptr ? static_cast<int>(strnlen(text, dataSize)) : 0);
+	if (textLength > 0)
+		memcpy(record.data, text, textLength);
+	record.textLength = textLength;
+	if (payload == nullptr || payloadSize < 0)
+		payloadSize = 0;
+	if (payloadSize > dataSize - textLength)
+		payloadSize = dataSize - textLength;
+	if (payloadSize > 0)
+		memcpy(record.data + textLength, payload, payloadSize);
+	record.payloadSize = payloadSize;
+
+	/* Publish the record to the reader. */
+	slot->sequence.store(position + 1, std::memory_order_release);
+	return 1;
+}
+
+bool LogChannel::read(Record& record)
+{
+	Slot& slot = slots[readPosition % capacity];
+	if (slot.sequence.load(std::memory_order_acquire) != readPosition + 1)
+		return false;
+
+	record = slot.record;
+
+	/* Free the slot for the position one lap ahead. */
+	slot.sequence.store(readPosition + capacity, std::memory_order_release);
+	readPosition++;
+	return true;
+}
+
+unsigned int LogChannel::takeDropped()
+{
+	return dropped.exchange(0, std::memory_order_relaxed);
+}
+
+int LogChannel::format(const Record& record, char* line, int size)
+{
+	static const char* levels[] = { "DEBUG: ", "", "WARNING: ", "ERROR: " };
+	static const char digits[] = "0123456789abcdef";
+
+	/* The line is written into the given buffer; lineSize is always enough. */
+	if (line == nullptr || size < 2)
+		return 0;
+
+	char prefix[64];
+	const char* level = (record.level >= 0 && record.level <= 3 ? levels[record.level] : "");
+	snprintf(prefix, sizeof(prefix), "[%.3f] %s", record.time, level);
+
+	int length = 0;
+	int last = size - 2;
+	for (const char* pc = prefix; *pc != 0 && length < last; pc++)
+		line[length++] = *pc;
+
+	int textLength = record.textLength;
+	if (textLength > 0 && record.data[textLength - 1] == '\n')
+		textLength--;
+	for (int i = 0; i < textLength && length < last; i++)
+		line[length++] = record.data[i];
+
+	/* The binary payload is written in hexadecimal form. */
+	if (record.payloadSize > 0 && length + 2 * record.payloadSize + 3 <= last) {
+		line[length++] = ' ';
+		line[length++] = '[';
+		const unsigned char* payload = reinterpret_cast<const unsigned char*>(record.data + record.textLength);
+		for (int i = 0; i < record.payloadSize; i++) {
+			line[length++] = digits[payload[i] >> 4];
+			line[length++] = digits[payload[i] & 15];
+		}
+		line[length++] = ']';
+	}
+
+	line[length++] = '\n';
+	line[length] = 0;
+	return length;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include "engine.h"
+
+/* A bounded multi-producer queue of log records. Records are written into
+   preallocated slots without locks or allocations, so engines (from any
+   thread) and the simulator may log at the tick rate. The simulator reads
+   the records once per frame. If the queue is full, records are dropped
+   and counted. */
+class LogChannel
+{
+public:
+	static const int capacity = 4096;
+	static const int dataSize = 232;
+	static const int lineSize = 64 + 3 * dataSize + 8;
+
+	struct Record {
+		double time;
+		Engine::LogLevel level;
+		int textLength;
+		int payloadSize;
+		char data[dataSize];
+	};
+
+	static void setTime(double time);
+	static int __cdecl write(Engine::LogLevel level, const char* text, const void* payload, int payloadSize);
+	static bool read(Record& record);
+	static unsigned int takeDropped();
+	static int format(const Record& record, char* line, int size);
+
+protected:
+	struct Slot {
+		std::atomic<size_t> sequence;
+		Record record;
+	};
+
+	static Slot slots[capacity];
+	static std::atomic<size_t> writePosition;
+	static size_t readPosition;
+	static std::atomic<unsigned int> dropped;
+	static std::atomic<double> time;
+
+private:
+	static const bool initialized;
+	static bool initialize();
+};
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include <string.h>
+#include "logstore.h"
+
+LogStore::LogStore(int capacity) :
+	capacity(capacity > 0 ? capacity : 1)
+{
+	/* Room for the lines kept before they are discarded in bulk. */
+	lines.reserve(2 * this->capacity + 1);
+	buffer.reserve(2 * this->capacity * 80);
+}
+
+LogStore::~LogStore()
+{
+	close();
+}
+
+bool LogStore::open(const char* filename)
+{
+	if (filename == nullptr)
+		return false;
+
+	close();
+	file.open(filename, std::ios_base::out | std::ios_base::app);
+	return file.is_open();
+}
+
+void LogStore::close()
+{
+	if (file.is_open())
+		file.close();
+}
+
+void LogStore::append(const char* text)
+{
+	if (text == nullptr || *text == 0)
+		return;
+
+	/* Stream the text to the file immediately. */
+	if (file.is_open()) {
+		file << text;
+		file.flush();
+	}
+
+	/* Split the text into lines. A new line starts with the first character
+	   after a line break, so that the trailing line break is not a line. The
+	   line breaks are stored as zeros. */
+	const char* pc = text;
+	while (*pc != 0) {
+		if (buffer.empty() || buffer.back() == 0)
+			lines.push_back(buffer.size());
+
+		const char* end = strchr(pc, '\n');
+		size_t length = (end != nullptr ? end - pc + 1 : strlen(pc));
+		buffer.append(pc, length);
+		if (end != nullptr)
+			buffer.back() = 0;
+		pc += length;
+	}
+
+	/* Lines are discarded in bulk, so that the cost is amortized. */
+	if (static_cast<int>(lines.size()) > 2 * capacity)
+		discardOldLines();
+}
+
+const char* LogStore::getLine(int i) const
+{
+	if (i < 0 || i >= static_cast<int>(lines.size()))
+		return "";
+
+	return buffer.c_str() + lines[i];
+}
+
+/* The lines in memory; the file already has all the text. */
+void LogStore::writeCheckpoint(CheckpointWriter& writer) const
+{
+	writer.write(buffer);
+	writer.write(static_cast<uint64_t>(lines.size()));
+	for (size_t offset : lines)
+		writer.write(static_cast<uint64_t>(offset));
+}
+
+bool LogStore::readCheckpoint(CheckpointReader& reader)
+{
+	uint64_t count;
+	if (!reader.read(buffer) || !reader.read(count))
+		return false;
+
+	lines.clear();
+	for (uint64_t i = 0; i < count; i++) {
+		uint64_t offset;
+		if (!reader.read(offset) || offset > buffer.size())
+			return false;
+		lines.push_back(static_cast<size_t>(offset));
+	}
+	return true;
+}
+
+void LogStore::discardOldLines()
+{
+	size_t count = lines.size() - capacity;
+	size_t offset = lines[count];
+
+	buffer.erase(0, offset);
+	lines.erase(lines.begin(), lines.begin() + count);
+	for (size_t& line : lines)
+		line -= offset;
+}
\ No newline at end of file
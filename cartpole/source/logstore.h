@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include "checkpoint.h"
+
+/* Keeps the most recent lines of a log in memory together with an index of
+   line offsets, so that the last lines can be accessed without parsing the
+   whole text. The lines are kept terminated by zeros, so that they can be
+   handed out without copying. If a file is opened, all the text is also
+   written to it as it arrives. */
+class LogStore
+{
+public:
+	LogStore() = delete;
+	LogStore(int capacity);
+	~LogStore();
+
+	bool open(const char* filename);
+	void close();
+	void append(const char* text);
+	void append(const std::string& text) { append(text.c_str()); }
+	int lineCount() const { return static_cast<int>(lines.size()); }
+	const char* getLine(int i) const;
+	void writeCheckpoint(CheckpointWriter& writer) const;
+	bool readCheckpoint(CheckpointReader& reader);
+
+protected:
+	int capacity;
+	std::string buffer;
+	std::vector<size_t> lines;
+	std::ofstream file;
+
+private:
+	void discardOldLines();
+};
\ No newline at end of file
@@ -1,157 +1,253 @@
-#include <windows.h>
-#include <shellapi.h>
-#include <iostream>
-#include <string>
-#include "application.h"
-#include "simulator.h"
-#include "engine.h"
-
-char** getCommandLineArguments(int* argc)
-{
-	/* Get command line arguments in the wide character format. */
-	LPWSTR* wargv = CommandLineToArgvW(GetCommandLineW(), argc);
-
-	/* Convert the arguments from the wide character to the multibyte format. */
-	char** argv = new char*[*argc];
-	for (int i = 0; i < *argc; i++) {
-		int argSize = WideCharToMultiByte(CP_ACP, 0, wargv[i], -1, nullptr, 0, nullptr, nullptr);
-		argv[i] = new char[argSize];
-		WideCharToMultiByte(CP_ACP, 0, wargv[i], -1, argv[i], argSize, nullptr, nullptr);
-	}
-	
-	/* Free the memory that was allocated by CommandLineToArgvW. */
-	LocalFree(wargv);
-
-	return argv;
-}
-
-void freeCommandLineArguments(char** argv, int argc)
-{
-	for (int i = 0; i < argc; i++)
-		delete argv[i];
-	delete argv;
-}
-
-int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine, int nCmdShow)
-{
-	/* Default engine initialization values. */
-	char* dllfile = nullptr;
-	char** engineArgv = nullptr;
-	int engineArgc = 0;
-
-	/* Get command line arguments. */
-	int argc = 0;
-	char** argv = getCommandLineArguments(&argc);
-
-	/* Try to find the -engine switch. */
-	int engineIdx = 1;
-	while (argv != nullptr && engineIdx < argc && (strcmp(argv[engineIdx], "-engine") != 0))
-		engineIdx++;
-
-	/* If the -engine switch was found. */
-	if (engineIdx < argc) {
-		/* And the -engine switch was not the last one. */
-		if (argc - engineIdx >= 2) {
-			/* The argument that follows is the DLL file path. */
-			dllfile = argv[engineIdx + 1];
-		}
-
-		/* If at least two arguments follow the -engine switch. */
-		if (argc - engineIdx >= 3) {
-			/* Arguments were given for the engine. */
-			engineArgv = &argv[engineIdx + 2];
-			engineArgc = argc - engineIdx - 2;
-		}
-	}
-
-	/* Load the engine. */
-	bool engineLoaded = Engine::Initialize(dllfile);
-	if (dllfile != nullptr && !engineLoaded) {
-		std::string msg = std::string("Error loading engine ") + std::string(dllfile) + std::string("!");
-		MessageBox(nullptr, msg.c_str(), "Engine error", MB_OK);
-		return -1;
-	}
-	
-	/* Determine the simulation parameters. */
-	Engine::InitSimulatorParameters();
-	Engine::simulatorParameters.argv = engineArgv;
-	Engine::simulatorParameters.argc = engineArgc;
-	Engine::simulatorInitialize(Engine::simulatorParameters);
-
-	/* Construct the application. */
-	Simulator* simulator = nullptr;
-
-	switch (Engine::simulatorParameters.applicationType) {
-	case Engine::UIType::GUI:
-		{
-			/* The GUI type of application. */
-			if (!Application::InitializeGui(hInstance))
-				return -1;
-
-			Window* window = Application::createWindow(
-				"Cart-pole simulator",
-				Engine::simulatorParameters.windowWidth,
-				Engine::simulatorParameters.windowHeight
-			);
-
-			if (!window->hasDrawingDevice()) {
-				MessageBox(nullptr, "Cannot initialize DirectX!", "Direct2D error", MB_OK);
-				return -1;
-			}
-
-			window->getDrawingDevice()->resetCamera();
-
-			simulator = new Simulator();
-			Application::assignSimulator(simulator);
-			break;
-		}
-
-		case Engine::UIType::CONSOLE:
-		{
-			/* The CONSOLE type of application. */
-			if (!Application::InitializeConsole(hInstance))
-				return -1;
-
-			simulator = new Simulator();
-			Application::assignSimulator(simulator);
-
-			std::cout << "Cart-pole simulator" << std::endl;
-			std::cout << "Action frequency: " << Engine::simulatorParameters.actionFrequency << " Hz" << std::endl;
-			std::cout << "Simulation speed: " << Engine::simulatorParameters.simulationSpeed << "x" << std::endl;
-			std::cout << "Manual force: " << Engine::simulatorParameters.manualForce << " N" << std::endl;
-			std::cout << "Mass: " << Engine::simulatorParameters.cart.mass << " Kg / ";
-			std::cout << Engine::simulatorParameters.pole.mass << " Kg" << std::endl;
-			std::cout << "Damping: " << Engine::simulatorParameters.cart.damping << std::endl;
-			if (Engine::isLoaded()) {
-				if (Engine::simulatorParameters.engineName != nullptr)
-					std::cout << "Engine: " << Engine::simulatorParameters.engineName << std::endl;
-				else
-					std::cout << "Engine loaded" << std::endl;
-			}
-			else {
-				std::cout << "No engine" << std::endl;
-			}
-			std::cout << std::endl;
-
-			break;
-		}
-	}
-
-	/* Run the application. */
-	Application::setTimer(1.0 / (double)Engine::simulatorParameters.actionFrequency);
-	Application::Run();
-
-	/* Shutdown the application. */
-	Engine::simulatorShutdown();	
-	Application::saveLog();
-	Engine::Destroy();
-
-	if (simulator != nullptr)
-		delete simulator;
-
-	Application::Close();
-
-	freeCommandLineArguments(argv, argc);
-
-	return 0;
+#include <windows.h>
+#include <shellapi.h>
+#include <iostream>
+#include <string>
+#include "application.h"
+#include "simulator.h"
+#include "engine.h"
+#include "sweep.h"
+#include "transitiontable.h"
+
+char** getCommandLineArguments(int* argc)
+{
+	/* Get command line arguments in the wide character format. */
+	LPWSTR* wargv = CommandLineToArgvW(GetCommandLineW(), argc);
+
+	/* Convert the arguments from the wide character to the multibyte format. */
+	char** argv = new char*[*argc];
+	for (int i = 0; i < *argc; i++) {
+		int argSize = WideCharToMultiByte(CP_ACP, 0, wargv[i], -1, nullptr, 0, nullptr, nullptr);
+		argv[i] = new char[argSize];
+		WideCharToMultiByte(CP_ACP, 0, wargv[i], -1, argv[i], argSize, nullptr, nullptr);
+	}
+	
+	/* Free the memory that was allocated by CommandLineToArgvW. */
+	LocalFree(wargv);
+
+	return argv;
+}
+
+void freeCommandLineArguments(char** argv, int argc)
+{
+	for (int i = 0; i < argc; i++)
+		delete argv[i];
+	delete argv;
+}
+
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine, int nCmdShow)
+{
+	/* Default engine initialization values. */
+	char* dllfile = nullptr;
+	char** engineArgv = nullptr;
+	int engineArgc = 0;
+
+	/* Get command line arguments. */
+	int argc = 0;
+	char** argv = getCommandLineArguments(&argc);
+
+	/* Try to find the -engine switch. */
+	int engineIdx = 1;
+	while (argv != nullptr && engineIdx < argc && (strcmp(argv[engineIdx], "-engine") != 0))
+		engineIdx++;
+
+	/* If the -engine switch was found. */
+	if (engineIdx < argc) {
+		/* And the -engine switch was not the last one. */
+		if (argc - engineIdx >= 2) {
+			/* The argument that follows is the DLL file path. */
+			dllfile = argv[engineIdx + 1];
+		}
+
+		/* If at least two arguments follow the -engine switch. */
+		if (argc - engineIdx >= 3) {
+			/* Arguments were given for the engine. */
+			engineArgv = &argv[engineIdx + 2];
+			engineArgc = argc - engineIdx - 2;
+		}
+	}
+
+	/* Switches before -engine: -resume <file> continues from a checkpoint;
+	   -sweep <file> runs a parameter sweep with the engine (-output <file.csv>,
+	   -workers <count>); -sweep-worker <index> <count> is given to the worker
+	   processes of the sweep; -policy <file> drives the cart with a policy
+	   instead of the engine's actions; -tabulate <file> writes the transition
+	   table of a grid with the engine's parameters (-output <file>, -workers
+	   <count> threads). */
+	const char* resumeFile = nullptr;
+	const char* policyFile = nullptr;
+	const char* sweepFile = nullptr;
+	const char* tabulateFile = nullptr;
+	const char* output = nullptr;
+	int sweepWorkers = 0;
+	int sweepWorker = -1;
+	int sweepWorkerCount = 0;
+	for (int i = 1; i < engineIdx; i++) {
+		if (strcmp(argv[i], "-resume") == 0 && i + 1 < engineIdx)
+			resumeFile = argv[++i];
+		else if (strcmp(argv[i], "-policy") == 0 && i + 1 < engineIdx)
+			policyFile = argv[++i];
+		else if (strcmp(argv[i], "-sweep") == 0 && i + 1 < engineIdx)
+			sweepFile = argv[++i];
+		else if (strcmp(argv[i], "-tabulate") == 0 && i + 1 < engineIdx)
+			tabulateFile = argv[++i];
+		else if (strcmp(argv[i], "-output") == 0 && i + 1 < engineIdx)
+			output = argv[++i];
+		else if (strcmp(argv[i], "-workers") == 0 && i + 1 < engineIdx)
+			sweepWorkers = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-sweep-worker") == 0 && i + 2 < engineIdx) {
+			/* Kept apart from -workers, which the workers get again with
+			   the arguments of the sweep. */
+			sweepWorker = atoi(argv[++i]);
+			sweepWorkerCount = atoi(argv[++i]);
+		}
+	}
+
+	/* The sweep itself only starts the workers, which load the engine. */
+	Sweep sweep;
+	if (sweepFile != nullptr) {
+		std::string error;
+		bool succeeded = sweep.load(sweepFile, error);
+		if (succeeded && sweepWorker < 0)
+			succeeded = sweep.runWorkers(sweepWorkers, output != nullptr ? output : "sweep.csv", argc, argv, error);
+		if (!succeeded) {
+			MessageBox(nullptr, error.c_str(), "Sweep error", MB_OK);
+			return -1;
+		}
+		if (sweepWorker < 0) {
+			freeCommandLineArguments(argv, argc);
+			return 0;
+		}
+	}
+
+	/* Load the engine. */
+	bool engineLoaded = Engine::Initialize(dllfile);
+	if (dllfile != nullptr && !engineLoaded) {
+		/* A worker of a sweep has no one to show the message to. */
+		if (sweepWorker < 0) {
+			std::string msg = std::string("Error loading engine ") + std::string(dllfile) + std::string("!");
+			MessageBox(nullptr, msg.c_str(), "Engine error", MB_OK);
+		}
+		return -1;
+	}
+	
+	/* Determine the simulation parameters. */
+	Engine::InitSimulatorParameters();
+	Engine::simulatorParameters.argv = engineArgv;
+	Engine::simulatorParameters.argc = engineArgc;
+	Engine::simulatorParameters.runSequence = Simulator::runSequence;
+	Engine::simulatorParameters.evaluateSequences = Simulator::evaluateSequences;
+	Engine::simulatorParameters.optimizeSequence = Simulator::optimizeSequence;
+	Engine::simulatorParameters.policyFilename = policyFile;
+	Engine::simulatorInitialize(Engine::simulatorParameters);
+
+	/* The table is computed without a window, with the terrain and the physics
+	   set by the engine. */
+	if (tabulateFile != nullptr) {
+		TransitionTable::Grid grid;
+		std::string error;
+		bool succeeded = TransitionTable::loadGrid(tabulateFile, grid, error);
+		if (succeeded)
+			succeeded = TransitionTable::build(Engine::simulatorParameters, grid, sweepWorkers, output != nullptr ? output : "transitions.bin", error);
+		Engine::simulatorShutdown();
+		Engine::Destroy();
+		freeCommandLineArguments(argv, argc);
+		if (!succeeded) {
+			MessageBox(nullptr, error.c_str(), "Transition table error", MB_OK);
+			return -1;
+		}
+		return 0;
+	}
+
+	/* A worker of a sweep runs its configurations without a window. */
+	if (sweepWorker >= 0) {
+		bool succeeded = sweep.runWorker(sweepWorker, sweepWorkerCount);
+		Engine::simulatorShutdown();
+		Engine::Destroy();
+		freeCommandLineArguments(argv, argc);
+		return succeeded ? 0 : -1;
+	}
+
+	/* Construct the application. */
+	Simulator* simulator = nullptr;
+
+	switch (Engine::simulatorParameters.applicationType) {
+	case Engine::UIType::GUI:
+		{
+			/* The GUI type of application. */
+			if (!Application::InitializeGui(hInstance))
+				return -1;
+
+			Window* window = Application::createWindow(
+				"Cart-pole simulator",
+				Engine::simulatorParameters.windowWidth,
+				Engine::simulatorParameters.windowHeight
+			);
+
+			if (!window->hasDrawingDevice()) {
+				MessageBox(nullptr, "Cannot initialize DirectX!", "Direct2D error", MB_OK);
+				return -1;
+			}
+
+			window->getDrawingDevice()->resetCamera();
+
+			simulator = new Simulator();
+			Application::assignSimulator(simulator);
+			break;
+		}
+
+		case Engine::UIType::CONSOLE:
+		{
+			/* The CONSOLE type of application. */
+			if (!Application::InitializeConsole(hInstance))
+				return -1;
+
+			simulator = new Simulator();
+			Application::assignSimulator(simulator);
+
+			std::cout << "Cart-pole simulator" << std::endl;
+			std::cout << "Action frequency: " << Engine::simulatorParameters.actionFrequency << " Hz" << std::endl;
+			std::cout << "Simulation speed: " << Engine::simulatorParameters.simulationSpeed << "x" << std::endl;
+			std::cout << "Manual force: " << Engine::simulatorParameters.manualForce << " N" << std::endl;
+			std::cout << "Mass: " << Engine::simulatorParameters.cart.mass << " Kg / ";
+			std::cout << Engine::simulatorParameters.pole.mass << " Kg" << std::endl;
+			std::cout << "Damping: " << Engine::simulatorParameters.cart.damping << std::endl;
+			if (Engine::isLoaded()) {
+				if (Engine::simulatorParameters.engineName != nullptr)
+					std::cout << "Engine: " << Engine::simulatorParameters.engineName << std::endl;
+				else
+					std::cout << "Engine loaded" << std::endl;
+			}
+			else {
+				std::cout << "No engine" << std::endl;
+			}
+			std::cout << std::endl;
+
+			break;
+		}
+	}
+
+	/* Continue from a checkpoint. */
+	if (resumeFile != nullptr && !simulator->loadCheckpoint(resumeFile)) {
+		std::string msg = std::string("Error loading checkpoint ") + std::string(resumeFile) + std::string("!");
+		MessageBox(nullptr, msg.c_str(), "Checkpoint error", MB_OK);
+		return -1;
+	}
+
+	/* Run the application. */
+	Application::setTimer(1.0 / (double)Engine::simulatorParameters.actionFrequency);
+	Application::Run();
+
+	/* Shutdown the application. */
+	Engine::simulatorShutdown();	
+	Application::saveLog();
+	Engine::Destroy();
+
+	if (simulator != nullptr)
+		delete simulator;
+
+	Application::Close();
+
+	freeCommandLineArguments(argv, argc);
+
+	return 0;
 }
\ No newline at end of file
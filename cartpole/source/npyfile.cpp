@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include "npyfile.h"
+
+/* The type of the elements as NumPy describes it, and their size. */
+static const char* typeNames[] = { "<f8", "<f4", "<i4", "|u1" };
+static const uint64_t typeSizes[] = { 8, 4, 4, 1 };
+
+/* Magic string, version 1.0 and the length of the text that follows. */
+static const size_t preambleSize = 10;
+
+/* Sizes of the zip records, without the names. */
+static const uint64_t localHeaderSize = 30;
+static const uint64_t centralHeaderSize = 46;
+static const uint64_t endRecordSize = 22;
+static const uint64_t zipLimit = 0xFFFFFFFF;
+
+/* The date of the entries, 1980-01-01 (a zip date may not be 0). */
+static const uint16_t zipDate = (1 << 5) | 1;
+
+static void put16(std::string& record, uint16_t value)
+{
+	record += static_cast<char>(value & 0xFF);
+	record += static_cast<char>(value >> 8);
+}
+
+static void put32(std::string& record, uint32_t value)
+{
+	put16(record, static_cast<uint16_t>(value & 0xFFFF));
+	put16(record, static_cast<uint16_t>(value >> 16));
+}
+
+/* A local header of the archive, or the central header that repeats it. */
+static std::string getEntryHeader(bool central, const std::string& name, uint32_t crc, uint32_t size, uint32_t offset)
+{
+	std::string record;
+	put32(record, central ? 0x02014B50 : 0x04034B50);
+	if (central)
+		put16(record, 20);   // made by: zip 2.0
+	put16(record, 10);       // needed: zip 1.0, stored entries
+	put16(record, 0);        // flags
+	put16(record, 0);        // method: stored
+	put16(record, 0);        // time
+	put16(record, zipDate);
+	put32(record, crc);
+	put32(record, size);     // compressed
+	put32(record, size);
+	put16(record, static_cast<uint16_t>(name.length()));
+	put16(record, 0);        // extra field
+	if (central) {
+		put16(record, 0);    // comment
+		put16(record, 0);    // disk
+		put16(record, 0);    // internal attributes
+		put32(record, 0);    // external attributes
+		put32(record, offset);
+	}
+	return record + name;
+}
+
+std::string NpyFile::getHeader(const Array& array, uint64_t offset)
+{
+	/* The shape as Python writes a tuple: (), (n,) or (n, m, ...). */
+	std::string shape;
+	for (size_t i = 0; i < array.shape.size(); i++)
+		shape += (i > 0 ? ", " : "") + std::to_string(array.shape[i]);
+	if (array.shape.size() == 1)
+		shape += ",";
+	shape = "(" + shape + ")";
+
+	std::string text = std::string("{'descr': '") + typeNames[array.type] + "', 'fortran_order': False, 'shape': " + shape + ", }";
+
+	/* The text ends with a newline, after the spaces that align the data. */
+	uint64_t end = offset + preambleSize + text.length() + 1;
+	text.append(static_cast<size_t>((alignment - end % alignment) % alignment), ' ');
+	text += '\n';
+
+	std::string header("\x93NUMPY\x01\x00", 8);
+	put16(header, static_cast<uint16_t>(text.length()));
+	return header + text;
+}
+
+uint64_t NpyFile::getDataSize(const Array& array)
+{
+	uint64_t size = typeSizes[array.type];
+	for (uint64_t extent : array.shape)
+		size *= extent;
+	return size;
+}
+
+/* The CRC by slices of 8 bytes: the tables give the CRC of a byte followed by
+   0 to 7 zero bytes, so that 8 lookups advance it by 8 bytes. */
+uint32_t NpyFile::crc32(uint32_t crc, const void* data, size_t size)
+{
+	struct Tables {
+		uint32_t values[8][256];
+
+		Tables() {
+			for (uint32_t i = 0; i < 256; i++) {
+				uint32_t value = i;
+				for (int bit = 0; bit < 8; bit++)
+					value = (value & 1) ? (value >> 1) ^ 0xEDB88320 : value >> 1;
+				values[0][i] = value;
+			}
+			for (int slice = 1; slice < 8; slice++) {
+				for (int i = 0; i < 256; i++)
+					values[slice][i] = (values[slice - 1][i] >> 8) ^ values[0][values[slice - 1][i] & 0xFF];
+			}
+		}
+	};
+	static const Tables tables;
+	const uint32_t (*t)[256] = tables.values;
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	crc = ~crc;
+	for (; size >= 8; size -= 8, bytes += 8) {
+		uint32_t low = crc ^ (bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<uint32_t>(bytes[3]) << 24);
+		crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+			t[3][bytes[4]] ^ t[2][bytes[5]] ^ t[1][bytes[6]] ^ t[0][bytes[7]];
+	}
+	for (; size > 0; size--, bytes++)
+		crc = t[0][(crc ^ *bytes) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+bool NpyFile::save(const char* fileName, const Array& array, std::string& error)
+{
+	std::string header = getHeader(array, 0);
+	size_t size = static_cast<size_t>(getDataSize(array));
+
+	FILE* file = fopen(fileName, "wb");
+	if (file == nullptr) {
+		error = std::string("Cannot write ") + fileName;
+		return false;
+	}
+	bool written = (fwrite(header.data(), 1, header.length(), file) == header.length());
+	written = written && (size == 0 || fwrite(array.data, 1, size, file) == size);
+	written = (fclose(file) == 0) && written;
+	if (!written)
+		error = std::string("Cannot write ") + fileName;
+	return written;
+}
+
+bool NpyFile::saveArchive(const char* fileName, const Array* arrays, int count, std::string& error)
+{
+	/* The headers are made first, as their sizes give the offsets. */
+	std::vector<std::string> names(count);
+	std::vector<std::string> headers(count);
+	std::vector<uint64_t> offsets(count);
+	uint64_t offset = 0;
+	uint64_t directorySize = 0;
+	for (int i = 0; i < count; i++) {
+		names[i] = std::string(arrays[i].name) + ".npy";
+		offsets[i] = offset;
+		headers[i] = getHeader(arrays[i], offset + localHeaderSize + names[i].length());
+		offset += localHeaderSize + names[i].length() + headers[i].length() + getDataSize(arrays[i]);
+		directorySize += centralHeaderSize + names[i].length();
+	}
+	if (offset + directorySize + endRecordSize > zipLimit) {
+		error = std::string(fileName) + ": the archive would exceed 4 GiB";
+		return false;
+	}
+
+	FILE* file = fopen(fileName, "wb");
+	if (file == nullptr) {
+		error = std::string("Cannot write ") + fileName;
+		return false;
+	}
+
+	std::string directory;
+	bool written = true;
+	for (int i = 0; i < count && written; i++) {
+		size_t size = static_cast<size_t>(getDataSize(arrays[i]));
+		uint32_t crc = crc32(0, headers[i].data(), headers[i].length());
+		crc = crc32(crc, arrays[i].data, size);
+		uint32_t entrySize = static_cast<uint32_t>(headers[i].length() + size);
+
+		std::string local = getEntryHeader(false, names[i], crc, entrySize, 0) + headers[i];
+		written = (fwrite(local.data(), 1, local.length(), file) == local.length());
+		written = written && (size == 0 || fwrite(arrays[i].data, 1, size, file) == size);
+		directory += getEntryHeader(true, names[i], crc, entrySize, static_cast<uint32_t>(offsets[i]));
+	}
+
+	put32(directory, 0x06054B50);
+	put16(directory, 0);   // disk
+	put16(directory, 0);   // disk of the directory
+	put16(directory, static_cast<uint16_t>(count));
+	put16(directory, static_cast<uint16_t>(count));
+	put32(directory, static_cast<uint32_t>(directorySize));
+	put32(directory, static_cast<uint32_t>(offset));
+	put16(directory, 0);   // comment
+	written = written && (fwrite(directory.data(), 1, directory.length(), file) == directory.length());
+	written = (fclose(file) == 0) && written;
+	if (!written)
+		error = std::string("Cannot write ") + fileName;
+	return written;
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/* Writes arrays in the file formats of NumPy: a .npy file holds one array, a
+   .npz archive holds one .npy file per array. The data is written as it is
+   in memory, after a header that describes it, and starts at a multiple of
+   64 bytes in both formats, so that np.load(mmap_mode='r') maps a .npy file
+   instead of reading it. The archive is an uncompressed zip; NumPy reads it
+   without mapping it. Only little-endian machines are supported, as the
+   types in the headers say. */
+class NpyFile
+{
+public:
+	enum Type {
+		FLOAT64 = 0,
+		FLOAT32,
+		INT32,
+		UINT8
+	};
+
+	/* An array in C order; the name is that of its file in an archive,
+	   without ".npy". */
+	struct Array {
+		const char* name;
+		Type type;
+		std::vector<uint64_t> shape;
+		const void* data;
+	};
+
+	static bool save(const char* fileName, const Array& array, std::string& error);
+
+	/* The archive is limited to 4 GiB, as zip64 is not written. */
+	static bool saveArchive(const char* fileName, const Array* arrays, int count, std::string& error);
+
+	/* The header of the array, padded so that the data that follows it is
+	   aligned when the header starts at the given file offset. */
+	static std::string getHeader(const Array& array, uint64_t offset);
+
+	static uint64_t getDataSize(const Array& array);
+
+	/* The CRC-32 of zip, continued from a previous crc (0 to start). */
+	static uint32_t crc32(uint32_t crc, const void* data, size_t size);
+
+	static const uint64_t alignment = 64;
+};
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+
+/* Philox4x32-10, a counter-based random number generator (Salmon et al.,
+   "Parallel random numbers: as easy as 1, 2, 3"). Every 128-bit counter is
+   mapped to four independent 32-bit random numbers under a 64-bit key, so
+   any element of any stream can be generated directly, without a state to
+   carry around. */
+class Philox
+{
+public:
+	struct Block {
+		uint32_t v[4];
+	};
+
+	static Block generate(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint64_t key) {
+		uint32_t k0 = static_cast<uint32_t>(key);
+		uint32_t k1 = static_cast<uint32_t>(key >> 32);
+		for (int round = 0; round < 10; round++) {
+			uint64_t p0 = static_cast<uint64_t>(0xD2511F53u) * c0;
+			uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u) * c2;
+			uint32_t hi0 = static_cast<uint32_t>(p0 >> 32);
+			uint32_t lo0 = static_cast<uint32_t>(p0);
+			uint32_t hi1 = static_cast<uint32_t>(p1 >> 32);
+			uint32_t lo1 = static_cast<uint32_t>(p1);
+			c0 = hi1 ^ c1 ^ k0;
+			c1 = lo1;
+			c2 = hi0 ^ c3 ^ k1;
+			c3 = lo0;
+			k0 += 0x9E3779B9u;
+			k1 += 0xBB67AE85u;
+		}
+		return Block{ { c0, c1, c2, c3 } };
+	}
+
+	/* A double in [0, 1) with 53 random bits. */
+	static double toUniform(uint32_t high, uint32_t low) {
+		return ((high >> 5) * 67108864.0 + (low >> 6)) * (1.0 / 9007199254740992.0);
+	}
+};
\ No newline at end of file
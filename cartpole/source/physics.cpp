@@ -0,0 +1,437 @@
+#include <math.h>
+#include "physics.h"
+#include "engine.h"
+
+const double CartPhysics::pi = acos(-1);
+const double CartPhysics::negPi = -1 * acos(-1);
+const double CartPhysics::doublePi = 2 * acos(-1);
+const double CartPhysics::roundingBias = 6755399441055744.0;
+const double CartPhysics::twoOverPi = 6.36619772367581382433e-01;
+const double CartPhysics::quarterTurn[3] = {
+	1.57079632673412561417e+00,
+	6.07710050630396597660e-11,
+	2.02226624871116645580e-21
+};
+const double CartPhysics::sinCoefficients[6] = {
+	1.58962301576546568060e-10,
+	-2.50507477628578072866e-08,
+	2.75573136213857245213e-06,
+	-1.98412698295895385996e-04,
+	8.33333333332211858878e-03,
+	-1.66666666666666307295e-01
+};
+const double CartPhysics::cosCoefficients[6] = {
+	-1.13585365213876817300e-11,
+	2.08757008419747316778e-09,
+	-2.75573141792967388112e-07,
+	2.48015872888517045348e-05,
+	-1.38888888888730564116e-03,
+	4.16666666666665929218e-02
+};
+
+CartPhysics::CartPhysics() :
+	x(0),
+	y(0),
+	dx(0),
+	ddx(0),
+	dtheta(0),
+	ddtheta(0),
+	phi(0),
+	theta(0),
+	frozen(false),
+	parameters(nullptr)
+{
+}
+
+CartPhysics::~CartPhysics()
+{
+}
+
+void CartPhysics::reset(
+	double x,
+	double dx,
+	double ddx,
+	double theta,
+	double dtheta,
+	double ddtheta
+)
+{
+	this->x = x;
+	y = 0;
+	phi = 0;
+	this->theta = theta;
+	frozen = false;
+	this->dx = dx;
+	this->ddx = ddx;
+	this->dtheta = dtheta;
+	this->ddtheta = ddtheta;
+}
+
+PhysicalParameters CartPhysics::getParameters() const
+{
+	if (parameters != nullptr)
+		return *parameters;
+	return getSimulatorParameters();
+}
+
+PhysicalParameters CartPhysics::getSimulatorParameters()
+{
+	PhysicalParameters simulatorParameters;
+	simulatorParameters.cartMass = Engine::simulatorParameters.cart.mass;
+	simulatorParameters.cartDamping = Engine::simulatorParameters.cart.damping;
+	simulatorParameters.poleMass = Engine::simulatorParameters.pole.mass;
+	simulatorParameters.poleLength = Engine::simulatorParameters.pole.size;
+	simulatorParameters.poleDamping = Engine::simulatorParameters.pole.damping;
+	simulatorParameters.gravity = Engine::simulatorParameters.gravity;
+	return simulatorParameters;
+}
+
+double CartPhysics::getWidth()
+{
+	return Engine::simulatorParameters.cart.size;
+}
+
+double CartPhysics::getWheelDistance()
+{
+	return 3 * Engine::simulatorParameters.cart.size / 5;
+}
+
+void CartPhysics::bounce()
+{
+	dx = -dx * 0.5;
+	ddx = 0;
+}
+
+void CartPhysics::dropMomentum()
+{
+	dx = 0;
+	ddx = 0;
+	dtheta = 0;
+	ddtheta = 0;
+}
+
+bool CartPhysics::isTouched(double x, double y)
+{
+	double width = Engine::simulatorParameters.cart.size;
+	double height = width / 6;
+	double wheel = width / 10;
+	double sinP = sin(phi);
+	double cosP = cos(phi);
+	
+	/* Compute the central point. */
+	double l = wheel + height / 2;
+	double cx = this->x - l * sinP;
+	double cy = this->y + l * cosP;
+
+	/* Move / rotate the point relative to the body. */
+	double vx = x - cx;
+	double vy = y - cy;
+	double rx = vx * cosP + vy * sinP;
+	double ry = vy * cosP - vx * sinP;
+
+	/* Check if within the body. */
+	if (rx < - width / 2 || rx > width / 2) return false;
+	if (ry < - height / 2 || ry > height / 2) return false;
+	return true;
+}
+
+void CartPhysics::tick(double F, double dt)
+{
+	if (frozen) return;
+
+	step(getParameters(), F, dt, phi, x, y, dx, ddx, theta, dtheta, ddtheta);
+}
+
+#ifdef PHYSICS_SSE
+inline void CartPhysics::sinCos(__m128d a, __m128d& s, __m128d& c)
+{
+	__m128d bias = _mm_set1_pd(roundingBias);
+	__m128d sum = _mm_add_pd(_mm_mul_pd(a, _mm_set1_pd(twoOverPi)), bias);
+	__m128d n = _mm_sub_pd(sum, bias);
+	__m128i quadrant = _mm_castpd_si128(sum);
+	__m128d r = _mm_sub_pd(a, _mm_mul_pd(n, _mm_set1_pd(quarterTurn[0])));
+	r = _mm_sub_pd(r, _mm_mul_pd(n, _mm_set1_pd(quarterTurn[1])));
+	r = _mm_sub_pd(r, _mm_mul_pd(n, _mm_set1_pd(quarterTurn[2])));
+
+	__m128d z = _mm_mul_pd(r, r);
+	__m128d p = _mm_set1_pd(sinCoefficients[0]);
+	__m128d q = _mm_set1_pd(cosCoefficients[0]);
+	p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(sinCoefficients[1]));
+	q = _mm_add_pd(_mm_mul_pd(q, z), _mm_set1_pd(cosCoefficients[1]));
+	p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(sinCoefficients[2]));
+	q = _mm_add_pd(_mm_mul_pd(q, z), _mm_set1_pd(cosCoefficients[2]));
+	p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(sinCoefficients[3]));
+	q = _mm_add_pd(_mm_mul_pd(q, z), _mm_set1_pd(cosCoefficients[3]));
+	p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(sinCoefficients[4]));
+	q = _mm_add_pd(_mm_mul_pd(q, z), _mm_set1_pd(cosCoefficients[4]));
+	p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(sinCoefficients[5]));
+	q = _mm_add_pd(_mm_mul_pd(q, z), _mm_set1_pd(cosCoefficients[5]));
+	__m128d sinR = _mm_add_pd(r, _mm_mul_pd(_mm_mul_pd(r, z), p));
+	__m128d cosR = _mm_add_pd(_mm_sub_pd(_mm_set1_pd(1.0), _mm_mul_pd(_mm_set1_pd(0.5), z)), _mm_mul_pd(_mm_mul_pd(z, z), q));
+
+	/* Bit 0 of the quadrant swaps sin and cos; bit 1 of the quadrant and of
+	   the next one is moved to the sign bit of sin and of cos. The compare
+	   is on 32 bits, and its result is spread from the low half of each
+	   lane. */
+	__m128i one = _mm_set1_epi64x(1);
+	__m128i two = _mm_set1_epi64x(2);
+	__m128i odd = _mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one);
+	__m128d swap = _mm_castsi128_pd(_mm_shuffle_epi32(odd, _MM_SHUFFLE(2, 2, 0, 0)));
+	__m128d sinA = _mm_or_pd(_mm_and_pd(swap, cosR), _mm_andnot_pd(swap, sinR));
+	__m128d cosA = _mm_or_pd(_mm_and_pd(swap, sinR), _mm_andnot_pd(swap, cosR));
+	__m128i sinSign = _mm_slli_epi64(_mm_and_si128(quadrant, two), 62);
+	__m128i cosSign = _mm_slli_epi64(_mm_and_si128(_mm_add_epi64(quadrant, one), two), 62);
+	s = _mm_xor_pd(sinA, _mm_castsi128_pd(sinSign));
+	c = _mm_xor_pd(cosA, _mm_castsi128_pd(cosSign));
+}
+
+inline __m128d CartPhysics::floorOf(__m128d a)
+{
+	__m128d bias = _mm_set1_pd(roundingBias);
+	__m128d rounded = _mm_sub_pd(_mm_add_pd(a, bias), bias);
+	return _mm_sub_pd(rounded, _mm_and_pd(_mm_cmpgt_pd(rounded, a), _mm_set1_pd(1.0)));
+}
+
+/* The operations of the scalar integrate, in the same order. */
+inline void CartPhysics::integrate(
+	__m128d mass,
+	__m128d ml,
+	__m128d massGravity,
+	__m128d massLength,
+	__m128d g,
+	__m128d cartDamping,
+	__m128d poleDamping,
+	__m128d dt,
+	int lane,
+	const double* __restrict forces,
+	const double* __restrict phi,
+	double* __restrict x,
+	double* __restrict y,
+	double* __restrict dx,
+	double* __restrict ddx,
+	double* __restrict theta,
+	double* __restrict dtheta,
+	double* __restrict ddtheta
+) {
+	__m128d F = _mm_loadu_pd(forces + lane);
+	__m128d velocity = _mm_loadu_pd(dx + lane);
+	__m128d angle = _mm_loadu_pd(theta + lane);
+	__m128d angularVelocity = _mm_loadu_pd(dtheta + lane);
+
+	__m128d sinT, cosT, sinP, cosP;
+	sinCos(angle, sinT, cosT);
+	sinCos(_mm_loadu_pd(phi + lane), sinP, cosP);
+	__m128d dtheta2 = _mm_mul_pd(angularVelocity, angularVelocity);
+
+	__m128d push = _mm_sub_pd(_mm_add_pd(F, _mm_mul_pd(_mm_mul_pd(ml, dtheta2), sinT)), _mm_mul_pd(massGravity, sinP));
+	__m128d sinTP = _mm_sub_pd(_mm_mul_pd(sinT, cosP), _mm_mul_pd(cosT, sinP));
+	__m128d angularAcceleration = _mm_sub_pd(_mm_mul_pd(massGravity, sinTP), _mm_mul_pd(cosT, push));
+	angularAcceleration = _mm_div_pd(angularAcceleration, _mm_sub_pd(massLength, _mm_mul_pd(_mm_mul_pd(ml, cosT), cosT)));
+	angularAcceleration = _mm_sub_pd(angularAcceleration, _mm_mul_pd(poleDamping, angularVelocity));
+
+	__m128d acceleration = _mm_sub_pd(_mm_mul_pd(dtheta2, sinT), _mm_mul_pd(angularAcceleration, cosT));
+	acceleration = _mm_add_pd(F, _mm_mul_pd(ml, acceleration));
+	acceleration = _mm_div_pd(acceleration, mass);
+	acceleration = _mm_sub_pd(acceleration, _mm_mul_pd(g, sinP));
+	acceleration = _mm_sub_pd(acceleration, _mm_mul_pd(cartDamping, velocity));
+
+	velocity = _mm_add_pd(velocity, _mm_mul_pd(acceleration, dt));
+	angularVelocity = _mm_add_pd(angularVelocity, _mm_mul_pd(angularAcceleration, dt));
+	__m128d dist = _mm_mul_pd(velocity, dt);
+	angle = _mm_add_pd(angle, _mm_mul_pd(angularVelocity, dt));
+
+	__m128d turn = _mm_set1_pd(doublePi);
+	__m128d turns = floorOf(_mm_div_pd(_mm_add_pd(angle, _mm_set1_pd(pi)), turn));
+	angle = _mm_sub_pd(angle, _mm_mul_pd(turn, turns));
+	angle = _mm_add_pd(angle, _mm_and_pd(_mm_cmplt_pd(angle, _mm_set1_pd(negPi)), turn));
+	angle = _mm_sub_pd(angle, _mm_and_pd(_mm_cmpge_pd(angle, _mm_set1_pd(pi)), turn));
+
+	_mm_storeu_pd(x + lane, _mm_add_pd(_mm_loadu_pd(x + lane), _mm_mul_pd(dist, cosP)));
+	_mm_storeu_pd(y + lane, _mm_add_pd(_mm_loadu_pd(y + lane), _mm_mul_pd(dist, sinP)));
+	_mm_storeu_pd(dx + lane, velocity);
+	_mm_storeu_pd(ddx + lane, acceleration);
+	_mm_storeu_pd(theta + lane, angle);
+	_mm_storeu_pd(dtheta + lane, angularVelocity);
+	_mm_storeu_pd(ddtheta + lane, angularAcceleration);
+}
+#endif
+
+void CartPhysics::stepLanes(
+	int count,
+	double dt,
+	const PhysicsColumns& parameters,
+	const double* __restrict forces,
+	const double* __restrict phi,
+	double* __restrict x,
+	double* __restrict y,
+	double* __restrict dx,
+	double* __restrict ddx,
+	double* __restrict theta,
+	double* __restrict dtheta,
+	double* __restrict ddtheta
+) {
+	/* The columns are read with unit stride, as the state. */
+	const double* __restrict mass = &parameters.mass[0];
+	const double* __restrict poleMoment = &parameters.poleMoment[0];
+	const double* __restrict massGravity = &parameters.massGravity[0];
+	const double* __restrict massLength = &parameters.massLength[0];
+	const double* __restrict gravity = &parameters.gravity[0];
+	const double* __restrict cartDamping = &parameters.cartDamping[0];
+	const double* __restrict poleDamping = &parameters.poleDamping[0];
+	int lane = 0;
+#ifdef PHYSICS_SSE
+	__m128d step = _mm_set1_pd(dt);
+	for (; lane + 2 <= count; lane += 2) {
+		integrate(_mm_loadu_pd(mass + lane), _mm_loadu_pd(poleMoment + lane), _mm_loadu_pd(massGravity + lane),
+			_mm_loadu_pd(massLength + lane), _mm_loadu_pd(gravity + lane), _mm_loadu_pd(cartDamping + lane),
+			_mm_loadu_pd(poleDamping + lane), step, lane, forces, phi, x, y, dx, ddx, theta, dtheta, ddtheta);
+	}
+#endif
+	for (; lane < count; lane++) {
+		integrate(mass[lane], poleMoment[lane], massGravity[lane], massLength[lane], gravity[lane],
+			cartDamping[lane], poleDamping[lane], forces[lane], dt, phi[lane],
+			x[lane], y[lane], dx[lane], ddx[lane], theta[lane], dtheta[lane], ddtheta[lane]);
+	}
+}
+
+void CartPhysics::stepLanes(
+	int count,
+	double dt,
+	const PhysicalParameters& parameters,
+	const double* __restrict forces,
+	const double* __restrict phi,
+	double* __restrict x,
+	double* __restrict y,
+	double* __restrict dx,
+	double* __restrict ddx,
+	double* __restrict theta,
+	double* __restrict dtheta,
+	double* __restrict ddtheta
+) {
+	/* The same terms for every cart, kept in registers. */
+	double mass = parameters.cartMass + parameters.poleMass;
+	double poleMoment = parameters.poleMass * parameters.poleLength;
+	double massGravity = mass * parameters.gravity;
+	double massLength = mass * parameters.poleLength;
+	int lane = 0;
+#ifdef PHYSICS_SSE
+	__m128d step = _mm_set1_pd(dt);
+	for (; lane + 2 <= count; lane += 2) {
+		integrate(_mm_set1_pd(mass), _mm_set1_pd(poleMoment), _mm_set1_pd(massGravity), _mm_set1_pd(massLength),
+			_mm_set1_pd(parameters.gravity), _mm_set1_pd(parameters.cartDamping), _mm_set1_pd(parameters.poleDamping),
+			step, lane, forces, phi, x, y, dx, ddx, theta, dtheta, ddtheta);
+	}
+#endif
+	for (; lane < count; lane++) {
+		integrate(mass, poleMoment, massGravity, massLength, parameters.gravity,
+			parameters.cartDamping, parameters.poleDamping, forces[lane], dt, phi[lane],
+			x[lane], y[lane], dx[lane], ddx[lane], theta[lane], dtheta[lane], ddtheta[lane]);
+	}
+}
+
+void CartPhysics::linearize(
+	const PhysicalParameters& p,
+	double F,
+	double dt,
+	double phi,
+	double theta,
+	double dtheta,
+	double* A,
+	double* B
+) {
+	double mass = p.cartMass + p.poleMass;
+	double g = p.gravity;
+	double sinT = sin(theta);
+	double cosT = cos(theta);
+	double sinP = sin(phi);
+	double cosP = cos(phi);
+	double ml = p.poleMass * p.poleLength;
+	double dtheta2 = dtheta * dtheta;
+
+	/* The angular acceleration num / den - poleDamping * dtheta and its
+	   derivatives in theta, dtheta and F. */
+	double push = F + ml * dtheta2 * sinT - mass * g * sinP;
+	double num = mass * g * sin(theta - phi) - cosT * push;
+	double den = mass * p.poleLength - ml * cosT * cosT;
+	double ddtheta = num / den - p.poleDamping * dtheta;
+	double numTheta = mass * g * cos(theta - phi) + sinT * push - ml * dtheta2 * cosT * cosT;
+	double denTheta = 2 * ml * cosT * sinT;
+	double ddthetaTheta = (numTheta * den - num * denTheta) / (den * den);
+	double ddthetaDtheta = -2 * ml * dtheta * sinT * cosT / den - p.poleDamping;
+	double ddthetaF = -cosT / den;
+
+	/* The acceleration of the cart and its derivatives in dx, theta, dtheta
+	   and F. */
+	double ddxDx = -p.cartDamping;
+	double ddxTheta = ml * (dtheta2 * cosT - ddthetaTheta * cosT + ddtheta * sinT) / mass;
+	double ddxDtheta = ml * (2 * dtheta * sinT - ddthetaDtheta * cosT) / mass;
+	double ddxF = (1 - ml * cosT * ddthetaF) / mass;
+
+	/* The integration: dx and dtheta first, then x and theta with the new
+	   velocities. */
+	double dxRow[5] = { 0, 1 + ddxDx * dt, ddxTheta * dt, ddxDtheta * dt, ddxF * dt };
+	double dthetaRow[5] = { 0, 0, ddthetaTheta * dt, 1 + ddthetaDtheta * dt, ddthetaF * dt };
+	for (int column = 0; column < 5; column++) {
+		double* row = (column < 4 ? A + column : B);
+		int stride = (column < 4 ? 4 : 1);
+		row[0 * stride] = (column == 0 ? 1 : 0) + dxRow[column] * dt * cosP;
+		row[1 * stride] = dxRow[column];
+		row[2 * stride] = (column == 2 ? 1 : 0) + dthetaRow[column] * dt;
+		row[3 * stride] = dthetaRow[column];
+	}
+}
+
+void PhysicsColumns::resize(int count)
+{
+	cartMass.resize(count);
+	cartDamping.resize(count);
+	poleMass.resize(count);
+	poleLength.resize(count);
+	poleDamping.resize(count);
+	gravity.resize(count);
+	mass.resize(count);
+	poleMoment.resize(count);
+	massGravity.resize(count);
+	massLength.resize(count);
+}
+
+void PhysicsColumns::set(int lane, const PhysicalParameters& parameters)
+{
+	/* The terms are computed as step computes them, so that a lane follows
+	   a cart with the same parameters bit for bit. */
+	cartMass[lane] = parameters.cartMass;
+	cartDamping[lane] = parameters.cartDamping;
+	poleMass[lane] = parameters.poleMass;
+	poleLength[lane] = parameters.poleLength;
+	poleDamping[lane] = parameters.poleDamping;
+	gravity[lane] = parameters.gravity;
+	mass[lane] = parameters.cartMass + parameters.poleMass;
+	poleMoment[lane] = parameters.poleMass * parameters.poleLength;
+	massGravity[lane] = mass[lane] * parameters.gravity;
+	massLength[lane] = mass[lane] * parameters.poleLength;
+}
+
+PhysicalParameters PhysicsColumns::get(int lane) const
+{
+	PhysicalParameters parameters;
+	parameters.cartMass = cartMass[lane];
+	parameters.cartDamping = cartDamping[lane];
+	parameters.poleMass = poleMass[lane];
+	parameters.poleLength = poleLength[lane];
+	parameters.poleDamping = poleDamping[lane];
+	parameters.gravity = gravity[lane];
+	return parameters;
+}
+
+void PhysicsColumns::gather(const int* lanes, int count)
+{
+	std::vector<double>* columns[] = {
+		&cartMass, &cartDamping, &poleMass, &poleLength, &poleDamping, &gravity,
+		&mass, &poleMoment, &massGravity, &massLength
+	};
+	for (std::vector<double>* column : columns) {
+		double* values = &(*column)[0];
+		for (int i = 0; i < count; i++)
+			values[i] = values[lanes[i]];
+	}
+}
\ No newline at end of file
@@ -0,0 +1,328 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+/* SSE2 is part of every x64 target; other targets step the lanes one by one. */
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PHYSICS_SSE
+#endif
+
+/* The physical parameters of one cart and its pole. */
+struct PhysicalParameters {
+	double cartMass;
+	double cartDamping;
+	double poleMass;
+	double poleLength;
+	double poleDamping;
+	double gravity;
+};
+
+/* The physical parameters of many carts as columns, one array per quantity,
+   with the terms of the equations of motion that depend on the parameters
+   alone computed when a cart is set. */
+struct PhysicsColumns {
+	std::vector<double> cartMass;
+	std::vector<double> cartDamping;
+	std::vector<double> poleMass;
+	std::vector<double> poleLength;
+	std::vector<double> poleDamping;
+	std::vector<double> gravity;
+	std::vector<double> mass;          // cart and pole
+	std::vector<double> poleMoment;    // pole mass * pole length
+	std::vector<double> massGravity;   // mass * gravity
+	std::vector<double> massLength;    // mass * pole length
+
+	void resize(int count);
+	void set(int lane, const PhysicalParameters& parameters);
+	PhysicalParameters get(int lane) const;
+
+	/* Moves the carts listed to the front, in their order; every cart moves
+	   towards the front, if at all. */
+	void gather(const int* lanes, int count);
+};
+
+/* The state and the equations of motion of the cart and its pole. The
+   physics does not depend on the drawing, so that it may also be stepped
+   without a window (e.g. by the benchmark). */
+class CartPhysics
+{
+public:
+	/* pi and the turn; a wrapped angle lies in [negPi, pi). */
+	static const double pi;
+	static const double negPi;
+	static const double doublePi;
+
+	CartPhysics();
+	~CartPhysics();
+
+	double x;
+	double y;
+	double dx;
+	double ddx;
+	double dtheta;
+	double ddtheta;
+	double phi;
+	double theta;
+	bool frozen;
+
+	/* Parameters of this cart if they differ from the simulator parameters
+	   (e.g. when randomised per episode); nullptr for the simulator parameters. */
+	const PhysicalParameters* parameters;
+
+	void reset(
+		double x,
+		double dx,
+		double ddx,
+		double theta,
+		double dtheta,
+		double ddtheta
+	);
+	PhysicalParameters getParameters() const;
+	static PhysicalParameters getSimulatorParameters();
+	double getWidth();
+	double getWheelDistance();
+	void bounce();
+	void dropMomentum();
+	bool isTouched(double x, double y);
+	void tick(double F, double dt);
+
+	/* One step of the equations of motion, shared by the cart and the lanes
+	   of a batch. */
+	static inline void step(
+		const PhysicalParameters& p,
+		double F,
+		double dt,
+		double phi,
+		double& x,
+		double& y,
+		double& dx,
+		double& ddx,
+		double& theta,
+		double& dtheta,
+		double& ddtheta
+	);
+
+	/* step for count carts, one value per cart in every array, with the
+	   parameters of every cart or with the same parameters for all of them.
+	   The arrays never overlap. Two carts at a time go through the SSE2
+	   kernel, which computes exactly what step computes, so that a lane
+	   follows a cart with the same parameters bit for bit. */
+	static void stepLanes(
+		int count,
+		double dt,
+		const PhysicsColumns& parameters,
+		const double* __restrict forces,
+		const double* __restrict phi,
+		double* __restrict x,
+		double* __restrict y,
+		double* __restrict dx,
+		double* __restrict ddx,
+		double* __restrict theta,
+		double* __restrict dtheta,
+		double* __restrict ddtheta
+	);
+	static void stepLanes(
+		int count,
+		double dt,
+		const PhysicalParameters& parameters,
+		const double* __restrict forces,
+		const double* __restrict phi,
+		double* __restrict x,
+		double* __restrict y,
+		double* __restrict dx,
+		double* __restrict ddx,
+		double* __restrict theta,
+		double* __restrict dtheta,
+		double* __restrict ddtheta
+	);
+
+	/* The derivatives of step with the slope phi held fixed: A (4x4, row by
+	   row) of the next (x, dx, theta, dtheta) in the current ones and B in
+	   the force. Must follow the equations of step. */
+	static void linearize(
+		const PhysicalParameters& p,
+		double F,
+		double dt,
+		double phi,
+		double theta,
+		double dtheta,
+		double* A,
+		double* B
+	);
+
+protected:
+	/* Adding it to a double below 2^51 in magnitude rounds it to an integer,
+	   which is left in the low bits of the sum. */
+	static const double roundingBias;
+	static const double twoOverPi;
+
+	/* pi / 2 in three parts, the first two short enough to be multiplied
+	   by a quarter turn count without rounding. */
+	static const double quarterTurn[3];
+
+	/* The polynomials of sin and cos on [-pi/4, pi/4] (Cephes). */
+	static const double sinCoefficients[6];
+	static const double cosCoefficients[6];
+
+	/* sin and cos of an angle of a cart (below 2^20 in magnitude), reduced
+	   by quarter turns to [-pi/4, pi/4]. The vector kernel computes them with
+	   the same operations; the math library may not. */
+	static inline void sinCos(double a, double& s, double& c);
+
+	/* floor without a call or a branch, exact below 2^51 in magnitude. */
+	static inline double floorOf(double a);
+
+	/* The equations of step with the terms that depend on the parameters
+	   alone given: the mass of the cart and the pole, the pole mass times its
+	   length, and the mass times the gravity and the pole length. */
+	static inline void integrate(
+		double mass,
+		double ml,
+		double massGravity,
+		double massLength,
+		double g,
+		double cartDamping,
+		double poleDamping,
+		double F,
+		double dt,
+		double phi,
+		double& x,
+		double& y,
+		double& dx,
+		double& ddx,
+		double& theta,
+		double& dtheta,
+		double& ddtheta
+	);
+
+#ifdef PHYSICS_SSE
+	static void sinCos(__m128d a, __m128d& s, __m128d& c);
+	static __m128d floorOf(__m128d a);
+
+	/* integrate for the two carts at lane in the arrays. */
+	static void integrate(
+		__m128d mass,
+		__m128d ml,
+		__m128d massGravity,
+		__m128d massLength,
+		__m128d g,
+		__m128d cartDamping,
+		__m128d poleDamping,
+		__m128d dt,
+		int lane,
+		const double* __restrict forces,
+		const double* __restrict phi,
+		double* __restrict x,
+		double* __restrict y,
+		double* __restrict dx,
+		double* __restrict ddx,
+		double* __restrict theta,
+		double* __restrict dtheta,
+		double* __restrict ddtheta
+	);
+#endif
+};
+
+inline void CartPhysics::step(
+	const PhysicalParameters& p,
+	double F,
+	double dt,
+	double phi,
+	double& x,
+	double& y,
+	double& dx,
+	double& ddx,
+	double& theta,
+	double& dtheta,
+	double& ddtheta
+) {
+	double mass = p.cartMass + p.poleMass;
+	integrate(mass, p.poleMass * p.poleLength, mass * p.gravity, mass * p.poleLength, p.gravity,
+		p.cartDamping, p.poleDamping, F, dt, phi, x, y, dx, ddx, theta, dtheta, ddtheta);
+}
+
+inline void CartPhysics::sinCos(double a, double& s, double& c)
+{
+	/* The quarter turns n and the remainder r, with a = n * pi / 2 + r. */
+	double sum = a * twoOverPi + roundingBias;
+	double n = sum - roundingBias;
+	uint64_t quadrant;
+	memcpy(&quadrant, &sum, sizeof(quadrant));
+	double r = ((a - n * quarterTurn[0]) - n * quarterTurn[1]) - n * quarterTurn[2];
+
+	double z = r * r;
+	const double* S = sinCoefficients;
+	const double* C = cosCoefficients;
+	double p = ((((S[0] * z + S[1]) * z + S[2]) * z + S[3]) * z + S[4]) * z + S[5];
+	double q = ((((C[0] * z + C[1]) * z + C[2]) * z + C[3]) * z + C[4]) * z + C[5];
+	double sinR = r + r * z * p;
+	double cosR = 1.0 - 0.5 * z + z * z * q;
+
+	/* sin and cos of r, swapped and negated for the quadrant. */
+	double sinA = ((quadrant & 1) != 0 ? cosR : sinR);
+	double cosA = ((quadrant & 1) != 0 ? sinR : cosR);
+	s = ((quadrant & 2) != 0 ? -sinA : sinA);
+	c = (((quadrant + 1) & 2) != 0 ? -cosA : cosA);
+}
+
+inline double CartPhysics::floorOf(double a)
+{
+	double rounded = (a + roundingBias) - roundingBias;
+	return rounded - (rounded > a ? 1.0 : 0.0);
+}
+
+inline void CartPhysics::integrate(
+	double mass,
+	double ml,
+	double massGravity,
+	double massLength,
+	double g,
+	double cartDamping,
+	double poleDamping,
+	double F,
+	double dt,
+	double phi,
+	double& x,
+	double& y,
+	double& dx,
+	double& ddx,
+	double& theta,
+	double& dtheta,
+	double& ddtheta
+) {
+	/* Compute accelerations */
+	double sinT, cosT, sinP, cosP;
+	sinCos(theta, sinT, cosT);
+	sinCos(phi, sinP, cosP);
+	double dtheta2 = dtheta * dtheta;
+
+	ddtheta = massGravity * (sinT * cosP - cosT * sinP) - cosT * (F + ml * dtheta2 * sinT - massGravity * sinP);
+	ddtheta /= massLength - ml * cosT * cosT;
+	ddtheta -= poleDamping * dtheta;
+
+	ddx = F + ml * (dtheta2 * sinT - ddtheta * cosT);
+	ddx /= mass;
+	ddx -= g * sinP;
+	ddx -= cartDamping * dx;
+
+	/* Integrate time */
+	dx += ddx * dt;
+	dtheta += ddtheta * dt;
+	double dist = dx * dt;
+	theta += dtheta * dt;
+
+	/* Wrap the angle by the whole turns it is past -pi, without a branch,
+	   as the vector kernel does. The quotient may round to the next whole
+	   turn (e.g. for pi less one ulp), so a result just outside [negPi, pi)
+	   is moved back by one turn. */
+	theta -= doublePi * floorOf((theta + pi) / doublePi);
+	theta += (theta < negPi ? doublePi : 0.0);
+	theta -= (theta >= pi ? doublePi : 0.0);
+
+	/* Compute cart position */
+	x += dist * cosP;
+	y += dist * sinP;
+}
\ No newline at end of file
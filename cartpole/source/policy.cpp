@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <string.h>
+#include "policy.h"
+
+/* SSE2 is part of every x64 target; other targets take the plain loops. */
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define POLICY_SSE
+#endif
+
+/* tanh by a rational approximation, accurate to a few float ulps, so that
+   four units are computed at once without calls. */
+static const float tanhClamp = 7.90531110763549805f;
+static const float tanhP[7] = {
+	-2.76076847742355e-16f, 2.00018790482477e-13f, -8.60467152213735e-11f, 5.12229709037114e-08f,
+	1.48572235717979e-05f, 6.37261928875436e-04f, 4.89352455891786e-03f
+};
+static const float tanhQ[4] = {
+	1.19825839466702e-06f, 1.18534705686654e-04f, 2.26843463243900e-03f, 4.89352518554385e-03f
+};
+
+#ifdef POLICY_SSE
+static inline __m128 activate(__m128 x, Policy::Activation activation)
+{
+	if (activation == Policy::ACTIVATION_RELU)
+		return _mm_max_ps(x, _mm_setzero_ps());
+	if (activation != Policy::ACTIVATION_TANH)
+		return x;
+
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-tanhClamp)), _mm_set1_ps(tanhClamp));
+	__m128 x2 = _mm_mul_ps(x, x);
+	__m128 p = _mm_set1_ps(tanhP[0]);
+	for (int i = 1; i < 7; i++)
+		p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(tanhP[i]));
+	__m128 q = _mm_set1_ps(tanhQ[0]);
+	for (int i = 1; i < 4; i++)
+		q = _mm_add_ps(_mm_mul_ps(q, x2), _mm_set1_ps(tanhQ[i]));
+	return _mm_div_ps(_mm_mul_ps(p, x), q);
+}
+#else
+static inline float activate(float x, Policy::Activation activation)
+{
+	if (activation == Policy::ACTIVATION_RELU)
+		return x > 0 ? x : 0.0f;
+	if (activation != Policy::ACTIVATION_TANH)
+		return x;
+
+	x = (x > tanhClamp ? tanhClamp : (x < -tanhClamp ? -tanhClamp : x));
+	float x2 = x * x;
+	float p = tanhP[0];
+	for (int i = 1; i < 7; i++)
+		p = p * x2 + tanhP[i];
+	float q = tanhQ[0];
+	for (int i = 1; i < 4; i++)
+		q = q * x2 + tanhQ[i];
+	return p * x / q;
+}
+#endif
+
+Policy::Policy()
+{
+}
+
+Policy::~Policy()
+{
+}
+
+bool Policy::load(const char* fileName, std::string& error)
+{
+	layers.clear();
+	parameters.clear();
+
+	FILE* file = fopen(fileName, "rb");
+	if (file == nullptr) {
+		error = std::string("Cannot open ") + fileName;
+		return false;
+	}
+
+	std::vector<char> buffer;
+	char chunk[65536];
+	size_t count;
+	while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0)
+		buffer.insert(buffer.end(), chunk, chunk + count);
+	fclose(file);
+
+	if (!load(buffer.data(), buffer.size(), error)) {
+		error = std::string(fileName) + ": " + error;
+		return false;
+	}
+	return true;
+}
+
+bool Policy::load(const void* data, size_t size, std::string& error)
+{
+	layers.clear();
+	parameters.clear();
+
+	const char* bytes = static_cast<const char*>(data);
+	size_t position = 0;
+	auto read = [&](void* value, size_t length) {
+		if (size - position < length)
+			return false;
+		memcpy(value, bytes + position, length);
+		position += length;
+		return true;
+	};
+
+	uint32_t header[3];
+	if (!read(header, sizeof(header)) || header[0] != magic || header[1] != version) {
+		error = "not a policy of version " + std::to_string(version);
+		return false;
+	}
+	if (header[2] == 0 || header[2] > static_cast<uint32_t>(maxLayers)) {
+		error = "invalid number of layers";
+		return false;
+	}
+
+	std::vector<Layer> loaded(header[2]);
+	std::vector<float> values;
+	int previous = 0;
+	for (size_t n = 0; n < loaded.size(); n++) {
+		Layer& layer = loaded[n];
+		uint32_t shape[3];
+		if (!read(shape, sizeof(shape))) {
+			error = "layer " + std::to_string(n + 1) + " is truncated";
+			return false;
+		}
+
+		bool valid = shape[0] > 0 && shape[0] <= maxUnits && shape[1] > 0 && shape[1] <= maxUnits;
+		valid = valid && shape[2] <= ACTIVATION_TANH;
+		valid = valid && (n == 0 ? (shape[0] == 4 || shape[0] == 5) : static_cast<int>(shape[0]) == previous);
+		valid = valid && (n + 1 < loaded.size() || shape[1] == 1);
+		if (!valid) {
+			error = "layer " + std::to_string(n + 1) + " has an invalid shape";
+			return false;
+		}
+
+		layer.inputs = shape[0];
+		layer.outputs = shape[1];
+		layer.width = (layer.outputs + unitBlock - 1) / unitBlock * unitBlock;
+		layer.activation = static_cast<Activation>(shape[2]);
+		previous = layer.outputs;
+
+		values.resize(static_cast<size_t>(layer.inputs + 1) * layer.outputs);
+		if (!read(&values[0], values.size() * sizeof(float))) {
+			error = "layer " + std::to_string(n + 1) + " is truncated";
+			return false;
+		}
+
+		/* Transpose the weights to input by input and pad the units. */
+		layer.weights = parameters.size();
+		parameters.resize(parameters.size() + static_cast<size_t>(layer.inputs + 1) * layer.width, 0.0f);
+		layer.biases = layer.weights + static_cast<size_t>(layer.inputs) * layer.width;
+		for (int output = 0; output < layer.outputs; output++) {
+			for (int input = 0; input < layer.inputs; input++)
+				parameters[layer.weights + static_cast<size_t>(input) * layer.width + output] = values[static_cast<size_t>(output) * layer.inputs + input];
+			parameters[layer.biases + output] = values[static_cast<size_t>(layer.inputs) * layer.outputs + output];
+		}
+	}
+
+	if (position != size) {
+		error = "unexpected data after the last layer";
+		parameters.clear();
+		return false;
+	}
+
+	layers.swap(loaded);
+	return true;
+}
+
+double Policy::evaluate(const double* observation) const
+{
+	double force = 0;
+	evaluate(observation, 1, getInputs(), &force);
+	return force;
+}
+
+void Policy::evaluate(const double* observations, int count, int stride, double* forces) const
+{
+	if (layers.empty()) {
+		for (int i = 0; i < count; i++)
+			forces[i] = 0;
+		return;
+	}
+
+	float buffers[2][laneBlock][maxUnits];
+	int inputs = layers[0].inputs;
+	for (int first = 0; first < count; first += laneBlock) {
+		int lanes = (count - first < laneBlock ? count - first : laneBlock);
+		float (*input)[maxUnits] = buffers[0];
+		float (*output)[maxUnits] = buffers[1];
+		for (int lane = 0; lane < lanes; lane++) {
+			const double* observation = observations + static_cast<size_t>(first + lane) * stride;
+			for (int i = 0; i < inputs; i++)
+				input[lane][i] = static_cast<float>(observation[i]);
+		}
+		for (int lane = lanes; lane < laneBlock; lane++)
+			memset(input[lane], 0, inputs * sizeof(float));
+
+		for (const Layer& layer : layers) {
+			forward(layer, input, output);
+			float (*swap)[maxUnits] = input;
+			input = output;
+			output = swap;
+		}
+
+		for (int lane = 0; lane < lanes; lane++)
+			forces[first + lane] = input[lane][0];
+	}
+}
+
+void Policy::forward(const Layer& layer, float (*input)[maxUnits], float (*output)[maxUnits]) const
+{
+	/* A block of units of all the lanes at a time (8 x 4, two registers per
+	   lane), with the sums kept over the inputs: every weight loaded is used
+	   for all the lanes, and the eight sums hide the latency of the adds. */
+	const float* weights = &parameters[layer.weights];
+	const float* biases = &parameters[layer.biases];
+	int width = layer.width;
+	for (int unit = 0; unit < width; unit += unitBlock) {
+#ifdef POLICY_SSE
+		__m128 low = _mm_loadu_ps(biases + unit);
+		__m128 high = _mm_loadu_ps(biases + unit + 4);
+		__m128 sum0 = low;
+		__m128 sum1 = low;
+		__m128 sum2 = low;
+		__m128 sum3 = low;
+		__m128 sum4 = high;
+		__m128 sum5 = high;
+		__m128 sum6 = high;
+		__m128 sum7 = high;
+		for (int i = 0; i < layer.inputs; i++) {
+			const float* row = weights + static_cast<size_t>(i) * width + unit;
+			__m128 w0 = _mm_loadu_ps(row);
+			__m128 w1 = _mm_loadu_ps(row + 4);
+			__m128 x = _mm_set1_ps(input[0][i]);
+			sum0 = _mm_add_ps(sum0, _mm_mul_ps(w0, x));
+			sum4 = _mm_add_ps(sum4, _mm_mul_ps(w1, x));
+			x = _mm_set1_ps(input[1][i]);
+			sum1 = _mm_add_ps(sum1, _mm_mul_ps(w0, x));
+			sum5 = _mm_add_ps(sum5, _mm_mul_ps(w1, x));
+			x = _mm_set1_ps(input[2][i]);
+			sum2 = _mm_add_ps(sum2, _mm_mul_ps(w0, x));
+			sum6 = _mm_add_ps(sum6, _mm_mul_ps(w1, x));
+			x = _mm_set1_ps(input[3][i]);
+			sum3 = _mm_add_ps(sum3, _mm_mul_ps(w0, x));
+			sum7 = _mm_add_ps(sum7, _mm_mul_ps(w1, x));
+		}
+		_mm_storeu_ps(output[0] + unit, activate(sum0, layer.activation));
+		_mm_storeu_ps(output[1] + unit, activate(sum1, layer.activation));
+		_mm_storeu_ps(output[2] + unit, activate(sum2, layer.activation));
+		_mm_storeu_ps(output[3] + unit, activate(sum3, layer.activation));
+		_mm_storeu_ps(output[0] + unit + 4, activate(sum4, layer.activation));
+		_mm_storeu_ps(output[1] + unit + 4, activate(sum5, layer.activation));
+		_mm_storeu_ps(output[2] + unit + 4, activate(sum6, layer.activation));
+		_mm_storeu_ps(output[3] + unit + 4, activate(sum7, layer.activation));
+#else
+		for (int lane = 0; lane < laneBlock; lane++) {
+			for (int j = 0; j < unitBlock; j++) {
+				float sum = biases[unit + j];
+				for (int i = 0; i < layer.inputs; i++)
+					sum += weights[static_cast<size_t>(i) * width + unit + j] * input[lane][i];
+				output[lane][unit + j] = activate(sum, layer.activation);
+			}
+		}
+#endif
+	}
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/* A small fixed network, a linear policy or an MLP, that maps the
+   observation of a cart to a force. A policy file holds the magic number,
+   the version and the number of layers (uint32_t each), then for every
+   layer the inputs, the outputs and the activation (uint32_t each), the
+   weights (float, outputs x inputs, row by row, as most frameworks keep
+   them) and the biases (float, outputs), all little endian. The first layer
+   takes (x, dx, theta, dtheta) or, with 5 inputs, (x, dx, theta, dtheta,
+   phi); the last layer has a single output, the force. */
+class Policy
+{
+public:
+	enum Activation {
+		ACTIVATION_LINEAR = 0,
+		ACTIVATION_RELU = 1,
+		ACTIVATION_TANH = 2
+	};
+
+	static const uint32_t magic = 0x4E4E5043;   // "CPNN"
+	static const uint32_t version = 1;
+	static const int maxLayers = 16;
+	static const int maxUnits = 256;
+
+	Policy();
+	~Policy();
+
+	bool load(const char* fileName, std::string& error);
+	bool load(const void* data, size_t size, std::string& error);
+	bool isLoaded() const { return !layers.empty(); }
+	int getInputs() const { return layers.empty() ? 0 : layers[0].inputs; }
+	double evaluate(const double* observation) const;
+
+	/* The forces of count observations, the observation i at observations +
+	   i * stride. */
+	void evaluate(const double* observations, int count, int stride, double* forces) const;
+
+protected:
+	/* The units of a layer are padded to a multiple of unitBlock with zero
+	   weights and the observations are taken laneBlock at a time, the missing
+	   ones as zeros. The weights are kept input by input. */
+	static const int unitBlock = 8;
+	static const int laneBlock = 4;
+
+	struct Layer {
+		int inputs;
+		int outputs;
+		int width;
+		Activation activation;
+		size_t weights;
+		size_t biases;
+	};
+
+	std::vector<Layer> layers;
+	std::vector<float> parameters;
+
+	void forward(const Layer& layer, float (*input)[maxUnits], float (*output)[maxUnits]) const;
+};
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include <math.h>
+#include "randomizer.h"
+
+/* The quantities in the order of their counters. The physical parameters
+   are kept above a minimum, so that a wide normal distribution does not
+   produce a negative mass. */
+struct PhysicalQuantity {
+	Engine::Distribution Engine::Randomization::* distribution;
+	double PhysicalParameters::* value;
+	double minimum;
+};
+
+struct StateQuantity {
+	Engine::Distribution Engine::Randomization::* distribution;
+	double Engine::InitialState::* value;
+};
+
+static const PhysicalQuantity physicalQuantities[] = {
+	{ &Engine::Randomization::cartMass, &PhysicalParameters::cartMass, 0.001 },
+	{ &Engine::Randomization::cartDamping, &PhysicalParameters::cartDamping, 0 },
+	{ &Engine::Randomization::poleMass, &PhysicalParameters::poleMass, 0.001 },
+	{ &Engine::Randomization::poleSize, &PhysicalParameters::poleLength, 0.001 },
+	{ &Engine::Randomization::poleDamping, &PhysicalParameters::poleDamping, 0 },
+	{ &Engine::Randomization::gravity, &PhysicalParameters::gravity, 0 }
+};
+
+static const StateQuantity stateQuantities[] = {
+	{ &Engine::Randomization::x, &Engine::InitialState::x },
+	{ &Engine::Randomization::dx, &Engine::InitialState::dx },
+	{ &Engine::Randomization::theta, &Engine::InitialState::theta },
+	{ &Engine::Randomization::dtheta, &Engine::InitialState::dtheta }
+};
+
+static const int physicalCount = sizeof(physicalQuantities) / sizeof(physicalQuantities[0]);
+static const int stateCount = sizeof(stateQuantities) / sizeof(stateQuantities[0]);
+
+bool Randomizer::isEnabled(const Engine::Randomization& randomization)
+{
+	if (isPhysicsEnabled(randomization))
+		return true;
+	for (int k = 0; k < stateCount; k++) {
+		if ((randomization.*stateQuantities[k].distribution).type != Engine::DistributionType::FIXED_VALUE)
+			return true;
+	}
+	return false;
+}
+
+bool Randomizer::isPhysicsEnabled(const Engine::Randomization& randomization)
+{
+	for (int k = 0; k < physicalCount; k++) {
+		if ((randomization.*physicalQuantities[k].distribution).type != Engine::DistributionType::FIXED_VALUE)
+			return true;
+	}
+	return false;
+}
+
+double Randomizer::draw(const Engine::Distribution& distribution, const Philox::Block& block)
+{
+	switch (distribution.type) {
+	case Engine::DistributionType::UNIFORM_DISTRIBUTION:
+		return distribution.a + (distribution.b - distribution.a) * Philox::toUniform(block.v[0], block.v[1]);
+	case Engine::DistributionType::NORMAL_DISTRIBUTION:
+	{
+		/* Box-Muller; u1 is in (0, 1], so that the logarithm is finite. */
+		double u1 = 1 - Philox::toUniform(block.v[0], block.v[1]);
+		double u2 = Philox::toUniform(block.v[2], block.v[3]);
+		return distribution.a + distribution.b * sqrt(-2 * log(u1)) * cos(CartPhysics::doublePi * u2);
+	}
+	default:
+		return distribution.a;
+	}
+}
+
+void Randomizer::sample(
+	const Engine::Randomization& randomization,
+	uint64_t firstStream,
+	int count,
+	uint32_t episode,
+	PhysicalParameters* parameters,
+	Engine::InitialState* states
+) {
+	/* One quantity at a time over all the streams, so that the inner loop
+	   runs the same generator over independent counters. */
+	for (int k = 0; k < physicalCount; k++) {
+		const Engine::Distribution& distribution = randomization.*physicalQuantities[k].distribution;
+		if (distribution.type == Engine::DistributionType::FIXED_VALUE || parameters == nullptr)
+			continue;
+		double PhysicalParameters::* value = physicalQuantities[k].value;
+		double minimum = physicalQuantities[k].minimum;
+		for (int i = 0; i < count; i++) {
+			uint64_t stream = firstStream + i;
+			Philox::Block block = Philox::generate(k, episode,
+				static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32), randomization.seed);
+			double sample = draw(distribution, block);
+			parameters[i].*value = (sample > minimum ? sample : minimum);
+		}
+	}
+
+	for (int k = 0; k < stateCount; k++) {
+		const Engine::Distribution& distribution = randomization.*stateQuantities[k].distribution;
+		if (distribution.type == Engine::DistributionType::FIXED_VALUE || states == nullptr)
+			continue;
+		double Engine::InitialState::* value = stateQuantities[k].value;
+		for (int i = 0; i < count; i++) {
+			uint64_t stream = firstStream + i;
+			Philox::Block block = Philox::generate(physicalCount + k, episode,
+				static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32), randomization.seed);
+			states[i].*value = draw(distribution, block);
+		}
+	}
+}
+
+void Randomizer::applyPhysics(
+	const Engine::Randomization& randomization,
+	const PhysicalParameters& sample,
+	PhysicalParameters& parameters
+) {
+	for (int k = 0; k < physicalCount; k++) {
+		if ((randomization.*physicalQuantities[k].distribution).type != Engine::DistributionType::FIXED_VALUE)
+			parameters.*physicalQuantities[k].value = sample.*physicalQuantities[k].value;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+#include "engine.h"
+#include "physics.h"
+#include "philox.h"
+
+/* Samples the physical parameters and the initial state of an episode from
+   the distributions in Engine::Randomization. The samples are taken from a
+   counter-based generator keyed by the seed: the stream (one per environment),
+   the episode and the sampled quantity form the counter, so every value can
+   be reproduced on its own and does not depend on the other distributions. */
+class Randomizer
+{
+public:
+	static bool isEnabled(const Engine::Randomization& randomization);
+
+	/* Whether any physical parameter is sampled. */
+	static bool isPhysicsEnabled(const Engine::Randomization& randomization);
+
+	/* Samples the given episode for the streams firstStream..firstStream+count-1.
+	   The parameters and states are expected to hold the values to keep for
+	   the quantities with a fixed distribution. */
+	static void sample(
+		const Engine::Randomization& randomization,
+		uint64_t firstStream,
+		int count,
+		uint32_t episode,
+		PhysicalParameters* parameters,
+		Engine::InitialState* states
+	);
+
+	/* Copies the physical parameters that the randomization samples from
+	   the sample of an episode into the given parameters, e.g. the current
+	   simulator parameters; the others are left as they are. */
+	static void applyPhysics(
+		const Engine::Randomization& randomization,
+		const PhysicalParameters& sample,
+		PhysicalParameters& parameters
+	);
+
+private:
+	static double draw(const Engine::Distribution& distribution, const Philox::Block& block);
+};
\ No newline at end of file
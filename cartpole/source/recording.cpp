@@ -1,156 +1,270 @@
-#include <Windows.h>
-#include "recording.h"
-#include "drawingdevice.h"
-
-Frame::Frame() :
-	F(0),
-	x(0),
-	y(0),
-	theta(0),
-	phi(0),
-	dx(0),
-	ddx(0),
-	dtheta(0),
-	ddtheta(0),
-	camerax(0),
-	cameray(0),
-	zoom(1)
-{
-}
-
-Frame::Frame(
-	double F,
-	double x,
-	double y,
-	double theta,
-	double phi,
-	double dx,
-	double ddx,
-	double dtheta,
-	double ddtheta,
-	double camerax,
-	double cameray,
-	double zoom
-) :
-	F(F),
-	x(x),
-	y(y),
-	theta(theta),
-	phi(phi),
-	dx(dx),
-	ddx(ddx),
-	dtheta(dtheta),
-	ddtheta(ddtheta),
-	camerax(camerax),
-	cameray(cameray),
-	zoom(zoom)
-{
-}
-
-Frame::~Frame()
-{
-}
-
-void Frame::saveData(HANDLE file, int i, double time)
-{
-	std::string data = std::to_string(i) + ";";
-	data += std::to_string(time) + ";";
-	data += std::to_string(F) + ";";
-	data += std::to_string(x) + ";";
-	data += std::to_string(y) + ";";
-	data += std::to_string(theta) + ";";
-	data += std::to_string(phi) + ";";
-	data += std::to_string(dx) + ";";
-	data += std::to_string(ddx) + ";";
-	data += std::to_string(dtheta) + ";";
-	data += std::to_string(ddtheta) + "\n";
-	DWORD bytesWritten;
-	WriteFile(file, data.c_str(), static_cast<DWORD>(data.length()), &bytesWritten, nullptr);
-}
-
-Recording::Recording(double fps) :
-	state(State::RECORDING),
-	time(0),
-	savedFrames(0),
-	fps(fps),
-	folderName(""),
-	recordingName("")
-{
-}
-
-Recording::~Recording()
-{
-}
-
-Frame Recording::getFrame(int i)
-{
-	if (i >= static_cast<int>(frames.size()))
-		return Frame();
-	return frames[i];
-}
-
-void Recording::snap(
-	double F,
-	double x,
-	double y,
-	double theta,
-	double phi,
-	double dx,
-	double ddx,
-	double dtheta,
-	double ddtheta,
-	double camerax,
-	double cameray,
-	double zoom
-) {
-	frames.push_back(
-		Frame(
-			F,
-			x,
-			y,
-			theta,
-			phi,
-			dx,
-			ddx,
-			dtheta,
-			ddtheta,
-			camerax,
-			cameray,
-			zoom
-		)
-	);
-}
-
-bool Recording::createFolder()
-{
-	int i = 1;
-	bool error = false;
-	recordingName = "recording 1";
-	folderName = "recording1";
-	while (!CreateDirectoryA(folderName.c_str(), nullptr) && !error) {
-		i++;
-		recordingName = "recording " + std::to_string(i);
-		folderName = "recording" + std::to_string(i);
-		if (GetLastError() != ERROR_ALREADY_EXISTS)
-			error = true;
-	}
-
-	return !error;
-}
-
-void Recording::saveFramesData()
-{
-	if (folderName.empty()) return;
-	std::string fileName = folderName + "\\" + "frames.csv";
-	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
-	static char header[] = "frame;time;F;x;y;theta;phi;x';x'';theta';theta''\n";
-	DWORD bytesWritten;
-	WriteFile(file, header, sizeof(header) - 1, &bytesWritten, nullptr);
-	double time = 0;
-	double dt = 1.0 / fps;
-	for (int i = 0; i < static_cast<int>(frames.size()); i++) {
-		frames[i].saveData(file, i + 1, time);
-		time += dt;
-	}
-	CloseHandle(file);
+#include <Windows.h>
+#include "recording.h"
+#include "drawingdevice.h"
+#include "framestream.h"
+
+Frame::Frame() :
+	F(0),
+	x(0),
+	y(0),
+	theta(0),
+	phi(0),
+	dx(0),
+	ddx(0),
+	dtheta(0),
+	ddtheta(0),
+	camerax(0),
+	cameray(0),
+	zoom(1)
+{
+}
+
+Frame::Frame(
+	double F,
+	double x,
+	double y,
+	double theta,
+	double phi,
+	double dx,
+	double ddx,
+	double dtheta,
+	double ddtheta,
+	double camerax,
+	double cameray,
+	double zoom
+) :
+	F(F),
+	x(x),
+	y(y),
+	theta(theta),
+	phi(phi),
+	dx(dx),
+	ddx(ddx),
+	dtheta(dtheta),
+	ddtheta(ddtheta),
+	camerax(camerax),
+	cameray(cameray),
+	zoom(zoom)
+{
+}
+
+Frame::~Frame()
+{
+}
+
+void Frame::saveData(HANDLE file, int i, double time)
+{
+	std::string data = std::to_string(i) + ";";
+	data += std::to_string(time) + ";";
+	data += std::to_string(F) + ";";
+	data += std::to_string(x) + ";";
+	data += std::to_string(y) + ";";
+	data += std::to_string(theta) + ";";
+	data += std::to_string(phi) + ";";
+	data += std::to_string(dx) + ";";
+	data += std::to_string(ddx) + ";";
+	data += std::to_string(dtheta) + ";";
+	data += std::to_string(ddtheta) + "\n";
+	DWORD bytesWritten;
+	WriteFile(file, data.c_str(), static_cast<DWORD>(data.length()), &bytesWritten, nullptr);
+}
+
+Recording::Recording(double fps, Arena* arena) :
+	state(State::RECORDING),
+	time(0),
+	savedFrames(0),
+	fps(fps),
+	frames(ArenaAllocator<Frame>(arena)),
+	episodeStarts(ArenaAllocator<EpisodeStart>(arena)),
+	folderName(""),
+	recordingName("")
+{
+	/* Room for ten minutes, so that snapping a frame does not allocate. The
+	   frames are taken from the arena and returned with it as a whole. */
+	frames.reserve(static_cast<size_t>(fps * 600));
+	episodeStarts.reserve(256);
+}
+
+Recording::~Recording()
+{
+}
+
+Frame Recording::getFrame(int i)
+{
+	if (i >= static_cast<int>(frames.size()))
+		return Frame();
+	return frames[i];
+}
+
+void Recording::snap(
+	double F,
+	double x,
+	double y,
+	double theta,
+	double phi,
+	double dx,
+	double ddx,
+	double dtheta,
+	double ddtheta,
+	double camerax,
+	double cameray,
+	double zoom
+) {
+	frames.push_back(
+		Frame(
+			F,
+			x,
+			y,
+			theta,
+			phi,
+			dx,
+			ddx,
+			dtheta,
+			ddtheta,
+			camerax,
+			cameray,
+			zoom
+		)
+	);
+}
+
+void Recording::setEpisode(int number)
+{
+	if (episodeStarts.empty() || episodeStarts.back().number != number)
+		episodeStarts.push_back({ frameCount(), number });
+}
+
+bool Recording::createFolder()
+{
+	int i = 1;
+	bool error = false;
+	recordingName = "recording 1";
+	folderName = "recording1";
+	while (!CreateDirectoryA(folderName.c_str(), nullptr) && !error) {
+		i++;
+		recordingName = "recording " + std::to_string(i);
+		folderName = "recording" + std::to_string(i);
+		if (GetLastError() != ERROR_ALREADY_EXISTS)
+			error = true;
+	}
+
+	return !error;
+}
+
+void Recording::saveFramesData()
+{
+	if (folderName.empty()) return;
+	std::string fileName = folderName + "\\" + "frames.csv";
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	static char header[] = "frame;time;F;x;y;theta;phi;x';x'';theta';theta''\n";
+	DWORD bytesWritten;
+	WriteFile(file, header, sizeof(header) - 1, &bytesWritten, nullptr);
+	double time = 0;
+	double dt = 1.0 / fps;
+	for (int i = 0; i < static_cast<int>(frames.size()); i++) {
+		frames[i].saveData(file, i + 1, time);
+		time += dt;
+	}
+	CloseHandle(file);
+}
+
+/* The frames as an Arrow stream, next to frames.csv, with the same frame
+   numbers and times. The episodes are walked along with the frames. */
+bool Recording::saveFramesArrow()
+{
+	if (folderName.empty())
+		return false;
+
+	FrameStream stream(65536);
+	if (!stream.open((folderName + "\\" + "frames.arrows").c_str()))
+		return false;
+	double dt = 1.0 / fps;
+	size_t next = 0;
+	int episode = 0;
+	for (int i = 0; i < static_cast<int>(frames.size()); i++) {
+		while (next < episodeStarts.size() && episodeStarts[next].frame <= i)
+			episode = episodeStarts[next++].number;
+		const Frame& frame = frames[i];
+		stream.add(episode, 0, i + 1, i * dt, frame.F, frame.x, frame.y, frame.theta, frame.phi,
+			frame.dx, frame.ddx, frame.dtheta, frame.ddtheta, frame.camerax, frame.cameray, frame.zoom);
+	}
+	return stream.close();
+}
+
+/* The frames are kept in a file of their own, so that a checkpoint only
+   appends the frames recorded since the previous one. */
+void Recording::writeCheckpoint(CheckpointWriter& writer) const
+{
+	writer.write(fps);
+	writer.write(state);
+	writer.write(time);
+	writer.write(savedFrames);
+	writer.write(folderName);
+	writer.write(recordingName);
+	writer.write(frameCount());
+	writer.write(static_cast<int>(episodeStarts.size()));
+	if (!episodeStarts.empty())
+		writer.write(&episodeStarts[0], episodeStarts.size() * sizeof(EpisodeStart));
+}
+
+bool Recording::saveFrames(const std::string& fileName, int first) const
+{
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER offset;
+	offset.QuadPart = static_cast<long long>(first) * sizeof(Frame);
+	bool saved = SetFilePointerEx(file, offset, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+	if (saved && first < frameCount()) {
+		DWORD size = static_cast<DWORD>((frameCount() - first) * sizeof(Frame));
+		DWORD bytesWritten;
+		saved = WriteFile(file, &frames[first], size, &bytesWritten, nullptr) && bytesWritten == size;
+	}
+	CloseHandle(file);
+	return saved;
+}
+
+Recording* Recording::readCheckpoint(CheckpointReader& reader, Arena* arena, const std::string& framesFileName)
+{
+	double fps;
+	if (!reader.read(fps))
+		return nullptr;
+
+	Recording* recording = new Recording(fps, arena);
+	int count = 0;
+	int episodeCount = 0;
+	bool loaded =
+		reader.read(recording->state) &&
+		reader.read(recording->time) &&
+		reader.read(recording->savedFrames) &&
+		reader.read(recording->folderName) &&
+		reader.read(recording->recordingName) &&
+		reader.read(count) &&
+		count >= 0 &&
+		reader.read(episodeCount) &&
+		episodeCount >= 0;
+
+	if (loaded && episodeCount > 0) {
+		recording->episodeStarts.resize(episodeCount);
+		loaded = reader.read(&recording->episodeStarts[0], episodeCount * sizeof(EpisodeStart));
+	}
+
+	if (loaded && count > 0) {
+		HANDLE file = CreateFileA(framesFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		loaded = (file != INVALID_HANDLE_VALUE);
+		if (loaded) {
+			recording->frames.resize(count);
+			DWORD size = static_cast<DWORD>(count * sizeof(Frame));
+			DWORD bytesRead;
+			loaded = ReadFile(file, &recording->frames[0], size, &bytesRead, nullptr) && bytesRead == size;
+			CloseHandle(file);
+		}
+	}
+
+	if (!loaded) {
+		delete recording;
+		return nullptr;
+	}
+	return recording;
 }
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include <math.h>
+#include "rollout.h"
+
+Rollout::Rollout(const Terrain& terrain, double cartSize, double dt) :
+	terrain(terrain),
+	wheelDistance(3 * cartSize / 5),
+	leftBound(-100 + cartSize / 2),
+	rightBound(100 - cartSize / 2),
+	dt(dt)
+{
+}
+
+Rollout::~Rollout()
+{
+}
+
+void Rollout::run(
+	const PhysicalParameters& parameters,
+	Engine::SimulationState& state,
+	const double* forces,
+	int k,
+	Engine::SimulationState* trajectory
+) const {
+	/* The state is kept in locals for the whole sequence. On a flat floor the
+	   alignment always gives y = 0 and phi = 0, so it is skipped. */
+	double x = state.x;
+	double y = state.y;
+	double phi = state.phi;
+	double dx = state.dx;
+	double ddx = state.ddx;
+	double theta = state.theta;
+	double dtheta = state.dtheta;
+	double ddtheta = state.ddtheta;
+	bool flat = terrain.isFlat();
+
+	for (int i = 0; i < k; i++) {
+		CartPhysics::step(parameters, forces[i], dt, phi, x, y, dx, ddx, theta, dtheta, ddtheta);
+		if (flat) {
+			y = 0;
+			phi = 0;
+		}
+		else {
+			terrain.align(x, wheelDistance, y, phi);
+		}
+
+		/* Prevent the cart from falling over the edge. */
+		if (x < leftBound || x > rightBound) {
+			x = (x < leftBound ? leftBound : rightBound);
+			dx = -dx * 0.5;
+			ddx = 0;
+		}
+
+		if (trajectory != nullptr) {
+			Engine::SimulationState& out = trajectory[i];
+			out.x = x;
+			out.y = y;
+			out.phi = phi;
+			out.dx = dx;
+			out.ddx = ddx;
+			out.theta = theta;
+			out.dtheta = dtheta;
+			out.ddtheta = ddtheta;
+		}
+	}
+
+	state.x = x;
+	state.y = y;
+	state.phi = phi;
+	state.dx = dx;
+	state.ddx = ddx;
+	state.theta = theta;
+	state.dtheta = dtheta;
+	state.ddtheta = ddtheta;
+}
+
+void Rollout::evaluate(
+	const PhysicalParameters& parameters,
+	const Engine::SimulationState& state,
+	const double* forces,
+	int m,
+	int k,
+	const Engine::QuadraticCost& cost,
+	double* costs
+) const {
+	double x[blockSize];
+	double y[blockSize];
+	double phi[blockSize];
+	double dx[blockSize];
+	double ddx[blockSize];
+	double theta[blockSize];
+	double dtheta[blockSize];
+	double ddtheta[blockSize];
+	double F[blockSize];
+	double sum[blockSize];
+
+	for (int first = 0; first < m; first += blockSize) {
+		int count = (m - first < blockSize ? m - first : blockSize);
+		const double* blockForces = forces + static_cast<size_t>(first) * k;
+
+		for (int lane = 0; lane < count; lane++) {
+			x[lane] = state.x;
+			y[lane] = state.y;
+			phi[lane] = state.phi;
+			dx[lane] = state.dx;
+			ddx[lane] = state.ddx;
+			theta[lane] = state.theta;
+			dtheta[lane] = state.dtheta;
+			ddtheta[lane] = state.ddtheta;
+			sum[lane] = 0;
+		}
+
+		for (int i = 0; i < k; i++) {
+			for (int lane = 0; lane < count; lane++)
+				F[lane] = blockForces[static_cast<size_t>(lane) * k + i];
+
+			CartPhysics::stepLanes(count, dt, parameters, F, phi, x, y, dx, ddx, theta, dtheta, ddtheta);
+			if (!terrain.isFlat())
+				terrain.alignLanes(count, x, wheelDistance, y, phi);
+
+			/* Prevent the cart from falling over the edge. */
+			for (int lane = 0; lane < count; lane++) {
+				if (x[lane] < leftBound || x[lane] > rightBound) {
+					x[lane] = (x[lane] < leftBound ? leftBound : rightBound);
+					dx[lane] = -dx[lane] * 0.5;
+					ddx[lane] = 0;
+				}
+			}
+
+			for (int lane = 0; lane < count; lane++) {
+				sum[lane] += evaluateCost(cost.Q, cost.target, x[lane], dx[lane], theta[lane], dtheta[lane]);
+				sum[lane] += cost.R * F[lane] * F[lane];
+			}
+		}
+
+		for (int lane = 0; lane < count; lane++)
+			costs[first + lane] = sum[lane] + evaluateCost(cost.Qf, cost.target, x[lane], dx[lane], theta[lane], dtheta[lane]);
+	}
+}
+
+double Rollout::evaluateCost(const double* matrix, const double* target, double x, double dx, double theta, double dtheta)
+{
+	/* The angle error is wrapped, so that both ways round to the target count. */
+	double e[4];
+	e[0] = x - target[0];
+	e[1] = dx - target[1];
+	e[2] = theta - target[2];
+	e[2] -= CartPhysics::doublePi * floor(e[2] / CartPhysics::doublePi + 0.5);
+	e[3] = dtheta - target[3];
+
+	double result = 0;
+	for (int row = 0; row < 4; row++) {
+		double Qe = matrix[row * 4] * e[0] + matrix[row * 4 + 1] * e[1] + matrix[row * 4 + 2] * e[2] + matrix[row * 4 + 3] * e[3];
+		result += e[row] * Qe;
+	}
+	return result;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "engine.h"
+#include "physics.h"
+#include "terrain.h"
+
+/* Simulates one cart under a sequence of forces known in advance: the
+   physics, the terrain and the bounds of a simulator tick, without the engine
+   callbacks, the termination rules and the drawing. The cart being simulated
+   is not affected, so planners may try many sequences from the same state. */
+class Rollout
+{
+public:
+	Rollout() = delete;
+	Rollout(const Terrain& terrain, double cartSize, double dt);
+	~Rollout();
+
+	/* Applies the k forces, one per tick, to the state and writes the state
+	   after every tick to the trajectory (k states; may be nullptr). */
+	void run(
+		const PhysicalParameters& parameters,
+		Engine::SimulationState& state,
+		const double* forces,
+		int k,
+		Engine::SimulationState* trajectory
+	) const;
+
+	/* Applies m sequences of k forces (one sequence after the other) to
+	   copies of the state and writes the cost of every sequence (m values). */
+	void evaluate(
+		const PhysicalParameters& parameters,
+		const Engine::SimulationState& state,
+		const double* forces,
+		int m,
+		int k,
+		const Engine::QuadraticCost& cost,
+		double* costs
+	) const;
+
+	/* e'Me for the state (x, dx, theta, dtheta) less the target, with the
+	   angle error wrapped to [-pi, pi). */
+	static double evaluateCost(const double* matrix, const double* target, double x, double dx, double theta, double dtheta);
+
+protected:
+	/* Sequences simulated side by side, with the sequences in the inner loops. */
+	static const int blockSize = 64;
+
+	const Terrain& terrain;
+	double wheelDistance;
+	double leftBound;
+	double rightBound;
+	double dt;
+};
\ No newline at end of file
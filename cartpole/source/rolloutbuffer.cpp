@@ -0,0 +1,85 @@
+#include <string.h>
+#include "rolloutbuffer.h"
+
+/* The arrays start at cache line boundaries. */
+static const size_t arrayAlignment = 64;
+
+RolloutBuffer::RolloutBuffer(int capacity, int count) :
+	capacity(capacity > 0 ? capacity : 1),
+	count(count > 0 ? count : 1),
+	size(0),
+	arena(getArenaSize(this->capacity, this->count))
+{
+	size_t steps = static_cast<size_t>(this->capacity);
+	size_t values = steps * this->count;
+	observations = static_cast<double*>(arena.allocate((values + this->count) * observationSize * sizeof(double), arrayAlignment));
+	actions = static_cast<double*>(arena.allocate(values * sizeof(double), arrayAlignment));
+	rewards = static_cast<double*>(arena.allocate(values * sizeof(double), arrayAlignment));
+	dones = static_cast<uint8_t*>(arena.allocate(values, arrayAlignment));
+
+	/* The pages are touched here rather than during the rollouts. */
+	memset(observations, 0, (values + this->count) * observationSize * sizeof(double));
+	memset(actions, 0, values * sizeof(double));
+	memset(rewards, 0, values * sizeof(double));
+	memset(dones, 0, values);
+}
+
+RolloutBuffer::~RolloutBuffer()
+{
+}
+
+size_t RolloutBuffer::getArenaSize(int capacity, int count)
+{
+	size_t values = static_cast<size_t>(capacity) * count;
+	return (values + count) * observationSize * sizeof(double) + 2 * values * sizeof(double) + values + 4 * arrayAlignment;
+}
+
+void RolloutBuffer::clear()
+{
+	if (size > 0)
+		memcpy(observations, getObservations(size), static_cast<size_t>(count) * observationSize * sizeof(double));
+	size = 0;
+}
+
+void RolloutBuffer::reset(BatchSimulator& batch)
+{
+	size = 0;
+	batch.reset(observations);
+}
+
+bool RolloutBuffer::step(BatchSimulator& batch)
+{
+	if (size == capacity || batch.getCount() != count)
+		return false;
+
+	batch.step(getActions(size), getObservations(size + 1), getRewards(size), getDones(size));
+	size++;
+	return true;
+}
+
+void RolloutBuffer::getArrays(NpyFile::Array* arrays) const
+{
+	uint64_t steps = static_cast<uint64_t>(size);
+	arrays[0] = { "observations", NpyFile::FLOAT64, { steps + 1, static_cast<uint64_t>(count), observationSize }, observations };
+	arrays[1] = { "actions", NpyFile::FLOAT64, { steps, static_cast<uint64_t>(count) }, actions };
+	arrays[2] = { "rewards", NpyFile::FLOAT64, { steps, static_cast<uint64_t>(count) }, rewards };
+	arrays[3] = { "dones", NpyFile::UINT8, { steps, static_cast<uint64_t>(count) }, dones };
+}
+
+bool RolloutBuffer::saveArrays(const std::string& prefix, std::string& error) const
+{
+	NpyFile::Array arrays[4];
+	getArrays(arrays);
+	for (const NpyFile::Array& array : arrays) {
+		if (!NpyFile::save((prefix + array.name + ".npy").c_str(), array, error))
+			return false;
+	}
+	return true;
+}
+
+bool RolloutBuffer::saveArchive(const char* fileName, std::string& error) const
+{
+	NpyFile::Array arrays[4];
+	getArrays(arrays);
+	return NpyFile::saveArchive(fileName, arrays, 4, error);
+}
\ No newline at end of file
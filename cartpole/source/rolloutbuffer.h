@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include "arena.h"
+#include "batchsimulator.h"
+#include "npyfile.h"
+
+/* The observations, the actions, the rewards and the dones of a batch of
+   environments over a number of steps, e.g. to hand the rollouts of a policy
+   to the training code. Each quantity is one array, step after step and
+   environment after environment within a step, in the layout that
+   BatchSimulator::step reads and writes, so that a step is filled in place
+   and the arrays are written to .npy files as they are. The arrays are
+   allocated once, aligned for the vector units and the files. */
+class RolloutBuffer
+{
+public:
+	static const int observationSize = BatchSimulator::OBSERVATION_SIZE;
+
+	RolloutBuffer() = delete;
+	RolloutBuffer(const RolloutBuffer&) = delete;
+	RolloutBuffer& operator=(const RolloutBuffer&) = delete;
+	RolloutBuffer(int capacity, int count);
+	~RolloutBuffer();
+
+	int getCapacity() const { return capacity; }
+	int getCount() const { return count; }
+
+	/* The steps filled since the buffer was cleared. */
+	int getSize() const { return size; }
+	bool isFull() const { return size == capacity; }
+
+	/* Empties the buffer; the last observations become the first ones, so
+	   that the rollouts go on where they stopped. */
+	void clear();
+
+	/* The observations before the step (step = size for those of the next
+	   step), and the actions, the rewards and the dones of the step. A done
+	   is the Engine::TerminationReason of the episode, 0 while it runs; the
+	   observations after a done are those of the next episode. */
+	double* getObservations(int step) { return observations + static_cast<size_t>(step) * count * observationSize; }
+	double* getActions(int step) { return actions + static_cast<size_t>(step) * count; }
+	double* getRewards(int step) { return rewards + static_cast<size_t>(step) * count; }
+	uint8_t* getDones(int step) { return dones + static_cast<size_t>(step) * count; }
+	const double* getObservations(int step) const { return observations + static_cast<size_t>(step) * count * observationSize; }
+
+	/* Counts the next step as filled. */
+	void advance() { size++; }
+
+	/* Empties the buffer and resets the batch into the first observations. */
+	void reset(BatchSimulator& batch);
+
+	/* Steps the batch with the actions of the next step, which the caller
+	   has written, and fills the rest of the step. Returns false, without
+	   stepping, if the buffer is full or the batch is not of its size. */
+	bool step(BatchSimulator& batch);
+
+	/* Writes the filled steps to prefix + "observations.npy", "actions.npy",
+	   "rewards.npy" and "dones.npy", with the shapes (size + 1, count, 5),
+	   (size, count), (size, count) and (size, count). */
+	bool saveArrays(const std::string& prefix, std::string& error) const;
+
+	/* Writes the same arrays into one .npz archive. */
+	bool saveArchive(const char* fileName, std::string& error) const;
+
+protected:
+	int capacity;
+	int count;
+	int size;
+	Arena arena;
+	double* observations;
+	double* actions;
+	double* rewards;
+	uint8_t* dones;
+
+	static size_t getArenaSize(int capacity, int count);
+	void getArrays(NpyFile::Array* arrays) const;
+};
\ No newline at end of file
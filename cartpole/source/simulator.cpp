@@ -1,716 +1,1180 @@
-#include <math.h>
-#include <string>
-#include <sstream>
-#include <iomanip>
-#include <fstream>
-#include "simulator.h"
-#include "cpuusage.h"
-
-const char Simulator::helpText[] = "\
-\n  F1     - show/hide help\
-\n  F2     - show/hide information\
-\n  F3     - show/hide engine log\
-\n  F4     - show/hide camera frame\
-\n  F5     - reset view\
-\n  F6     - start/stop recording\
-\n  Arrows - apply/change force\
-\n  Enter  - reset simulation\
-\n  Mouse  - move objects, change view\
-";
-
-Simulator::Simulator()
-{
-	priorityUpdate = false;
-	terminate = false;
-	frozen = false;
-	engineActionsSuppressed = false;
-	simulationTime = 0;
-	manualAction = 0;
-	lastAction = 0;
-	showInfo = true;
-	showLog = true;
-	showHelp = false;
-	showCameraFrame = false;
-	cameraX = 0;
-	cameraY = 0;
-	cameraZoom = 1;
-	updateCamera = false;
-	recording = nullptr;
-	frameDrawingDevice = nullptr;
-	frameCart = nullptr;
-	computeFloor();
-	alignCartWithFloor();
-	log = "";
-
-	reset();
-}
-
-Simulator::~Simulator()
-{
-	if (recording != nullptr)
-		delete recording;
-
-	if (frameDrawingDevice != nullptr)
-		delete frameDrawingDevice;
-
-	if (frameCart != nullptr)
-		delete frameCart;
-}
-
-bool Simulator::isMouseOverLog(int x, int y, DrawingDevice* drawingDevice)
-{
-	if (!showLog)
-		return false;
-
-	double width = drawingDevice->getWidth();
-	double height = drawingDevice->getHeight();
-
-	if (x < 2 * width / 3 || x > width)
-		return false;
-	if (y < 0 || y > height)
-		return false;
-	
-	return true;
-}
-
-int Simulator::getObjectAt(double x, double y)
-{
-	return (!cart.frozen && cart.isTouched(x, y) ? 1 : 0);
-}
-
-void Simulator::moveObjectBy(int object, double dx, double dy)
-{
-	switch (object) {
-	case 1:
-		cart.x += dx;
-		cart.y += dy;
-		alignCartWithFloor();
-		break;
-	}
-}
-
-void Simulator::freezeObject(int object, bool freeze)
-{
-	switch (object) {
-	case 1:
-		cart.dropMomentum();
-		cart.frozen = freeze;
-		break;
-	}
-}
-
-void Simulator::toggleInfo()
-{
-	showInfo = !showInfo;
-}
-
-void Simulator::toggleLog()
-{
-	showLog = !showLog;
-}
-
-void Simulator::togglehelp()
-{
-	showHelp = !showHelp;
-}
-
-void Simulator::toggleCameraFrame()
-{
-	showCameraFrame = !showCameraFrame;
-}
-
-void Simulator::getState(Engine::SimulationState& state)
-{
-	state.x = cart.x;
-	state.y = cart.y;
-	state.dx = cart.dx;
-	state.ddx = cart.ddx;
-	state.theta = cart.theta;
-	state.dtheta = cart.dtheta;
-	state.ddtheta = cart.ddtheta;
-	state.phi = cart.phi;
-}
-
-void Simulator::startStopRecording()
-{
-	if (recording == nullptr)
-		recording = new Recording(Engine::simulatorParameters.actionFrequency);
-	else if (recording->state == Recording::State::RECORDING)
-		recording->state = Recording::State::STOPPED;
-}
-
-void Simulator::cancel()
-{
-	if (recording != nullptr) {
-		recording->state = Recording::State::FINISHED;
-	}
-}
-
-void Simulator::reset()
-{
-	Engine::InitialState initialState;
-	initialState.x = 0;
-	initialState.dx = 0;
-	initialState.ddx = 0;
-	initialState.theta = 0;
-	initialState.dtheta = 0;
-	initialState.ddtheta = 0;
-
-	Engine::setInitialState(initialState);
-
-	simulationTime = 0;
-	manualAction = 0;
-	lastAction = 0;
-
-	cart.reset(initialState.x, initialState.dx, initialState.ddx,
-		initialState.theta, initialState.dtheta, initialState.ddtheta);
-	alignCartWithFloor();
-	
-	Engine::SimulationState simulationState;
-	getState(simulationState);
-	
-	Engine::SimulationParameters simulationParameters;
-	simulationParameters.cameraParameters.x = cameraX;
-	simulationParameters.cameraParameters.y = cameraY;
-	simulationParameters.cameraParameters.zoom = cameraZoom;
-	simulationParameters.cameraAction = Engine::CameraAction::NO_CAMERA_ACTION;
-	simulationParameters.simulationAction = Engine::SimulationAction::NO_SIMULATION_ACTION;
-
-	Engine::stateUpdated(simulationTime, simulationState, simulationParameters);
-
-	switch (simulationParameters.cameraAction) {
-	case Engine::CameraAction::UPDATE_CAMERA:
-		cameraX = simulationParameters.cameraParameters.x;
-		cameraY = simulationParameters.cameraParameters.y;
-		cameraZoom = simulationParameters.cameraParameters.zoom;
-		updateCamera = true;
-		break;
-	default:
-		updateCamera = false;
-	}
-
-	switch (simulationParameters.simulationAction) {
-	case Engine::SimulationAction::RESET_SIMULATION:
-		/* The reset action is ignored, because the simulation has just been reset. */
-		break;
-	case Engine::SimulationAction::TERMINATE_SIMULATION:
-		terminate = true;
-		break;
-	default:
-		break;
-	}
-}
-
-void Simulator::setManualAction(double direction)
-{
-	manualAction = direction * Engine::simulatorParameters.manualForce;
-}
-
-void Simulator::tick(double dt)
-{
-	/* If simulation is frozen, only process the recording. */
-	if (frozen) {
-		if (recording != nullptr)
-			processRecording();
-		return;
-	}
-
-	/* Ask the engine what action to execute. */
-	Engine::CartAction cartAction;
-	cartAction.force = 0;
-	cartAction.options = Engine::ActionOptions::APPLY_FORCE;
-	Engine::applyAction(cartAction);
-
-	double action = 0;
-	switch (cartAction.options) {
-	case Engine::ActionOptions::APPLY_FORCE:
-		action = cartAction.force;
-		break;
-	case Engine::ActionOptions::APPLY_MANUAL_ACTION:
-		action = manualAction;
-		break;
-	case Engine::ActionOptions::APPLY_FORCE_IF_NO_MANUAL_ACTION:
-		if (manualAction != 0)
-			action = manualAction;
-		else
-			action = cartAction.force;
-		break;
-	default:
-		break;
-	}
-
-	/* Update the simulation time. */
-	simulationTime += dt;
-	if (recording != nullptr)
-		recording->time += dt;
-
-	/* Simulate the cart. */
-	cart.tick(action, dt);
-	alignCartWithFloor();
-
-	/* Prevent the cart from falling over the edge. */
-	double leftBound = -100 + cart.getWidth() / 2;
-	double rightBound = 100 - cart.getWidth() / 2;
-	if (cart.x < leftBound || cart.x > rightBound) {
-		if (cart.x < leftBound) cart.x = leftBound;
-		if (cart.x > rightBound) cart.x = rightBound;
-		cart.bounce();
-	}
-
-	/* Notify the engine that the state has been updated. */
-	Engine::SimulationState simulationState;
-	getState(simulationState);
-
-	Engine::SimulationParameters simulationParameters;
-	simulationParameters.cameraParameters.x = cameraX;
-	simulationParameters.cameraParameters.y = cameraY;
-	simulationParameters.cameraParameters.zoom = cameraZoom;
-	simulationParameters.cameraAction = Engine::CameraAction::NO_CAMERA_ACTION;
-	simulationParameters.simulationAction = Engine::SimulationAction::NO_SIMULATION_ACTION;
-
-	Engine::stateUpdated(simulationTime, simulationState, simulationParameters);
-
-	switch (simulationParameters.cameraAction) {
-	case Engine::CameraAction::UPDATE_CAMERA:
-		cameraX = simulationParameters.cameraParameters.x;
-		cameraY = simulationParameters.cameraParameters.y;
-		cameraZoom = simulationParameters.cameraParameters.zoom;
-		updateCamera = true;
-		break;
-	default:
-		updateCamera = false;
-	}
-
-	/* Does the engine want to change the simulation flow? */
-	switch (simulationParameters.simulationAction) {
-	case Engine::SimulationAction::RESET_SIMULATION:
-		reset();
-		break;
-	case Engine::SimulationAction::TERMINATE_SIMULATION:
-		terminate = true;
-		break;
-	default:
-		break;
-	}
-
-	/* If recording, record the current state. */
-	if (recording != nullptr) {
-		processRecording();
-	}
-}
-
-void Simulator::processRecording()
-{
-	switch (recording->state) {
-	case Recording::State::RECORDING:
-	{
-		recording->snap(
-			lastAction,
-			cart.x,
-			cart.y,
-			cart.theta,
-			cart.phi,
-			cart.dx,
-			cart.ddx,
-			cart.dtheta,
-			cart.ddtheta,
-			cameraX,
-			cameraY,
-			cameraZoom
-		);
-		break;
-	}
-	case Recording::State::STOPPED:
-	{
-		frozen = true;
-		recording->createFolder();
-		recording->saveFramesData();
-		recording->savedFrames = 0;
-		frameDrawingDevice = new DrawingDevice(1280, 720);
-		frameCart = new Cart();
-		recording->state = Recording::State::PROCESSING;
-		priorityUpdate = true;
-		break;
-	}
-	case Recording::State::PROCESSING:
-	{
-		if (recording->savedFrames >= recording->frameCount()) {
-			recording->state = Recording::State::FINISHED;
-			break;
-		}
-
-		Frame frame = recording->getFrame(recording->savedFrames);
-		frameCart->x = frame.x;
-		frameCart->y = frame.y;
-		frameCart->theta = frame.theta;
-		frameCart->phi = frame.phi;
-		frameDrawingDevice->setCamera(frame.camerax, frame.cameray, frame.zoom);
-		frameDrawingDevice->beginDraw();
-		paintScenery(frameDrawingDevice);
-		frameCart->paint(frameDrawingDevice);
-		frameDrawingDevice->endDraw();
-		recording->savedFrames++;
-		frameDrawingDevice->saveToFile(
-			recording->getFolderName() + "\\frame" +
-			std::to_string(recording->savedFrames) + ".png");
-		break;
-	}
-	case Recording::State::FINISHED:
-		frozen = false;
-		priorityUpdate = false;
-		delete frameCart;
-		frameCart = nullptr;
-		delete frameDrawingDevice;
-		frameDrawingDevice = nullptr;
-		delete recording;
-		recording = nullptr;
-		break;
-	default:
-		break;
-	}
-}
-
-void Simulator::paint(DrawingDevice* drawingDevice)
-{
-	if (drawingDevice == nullptr)
-		return;
-
-	/* Drawing device width and height. */
-	double width = drawingDevice->getWidth();
-	double height = drawingDevice->getHeight();
-	
-	if (updateCamera) {
-		drawingDevice->setCamera(cameraX, cameraY, cameraZoom);
-		updateCamera = false;
-	}
-
-	/* Remember the last camera settings. */
-	cameraX = drawingDevice->getCameraX();
-	cameraY = drawingDevice->getCameraY();
-	cameraZoom = drawingDevice->getCameraZoom();
-
-	/* Draw background and floor. */
-	paintScenery(drawingDevice);
-
-	/* Draw cart */
-	cart.paint(drawingDevice);
-
-	/* Draw text */
-	if (showInfo) {
-		std::stringstream stream;
-		stream << std::fixed;
-		stream << std::setprecision(1);
-		stream << "CPU: " << CPUUsage::getUsage() << "%";
-		drawingDevice->screenText(stream.str(), 10, 10);
-		stream.str(std::string());
-		stream << "Action frequency: " << Engine::simulatorParameters.actionFrequency << " Hz";
-		drawingDevice->screenText(stream.str(), 10, 30);
-		stream.str(std::string());
-		stream << "Simulation speed: " << Engine::simulatorParameters.simulationSpeed << "x";
-		drawingDevice->screenText(stream.str(), 10, 50);
-		stream.str(std::string());
-		stream << "Manual force: " << Engine::simulatorParameters.manualForce << " N";
-		drawingDevice->screenText(stream.str(), 10, 70);
-		stream.str(std::string());
-		stream << "Mass: " << Engine::simulatorParameters.cart.mass << " Kg / ";
-		stream << Engine::simulatorParameters.pole.mass << " Kg";
-		drawingDevice->screenText(stream.str(), 10, 90);
-		stream.str(std::string());
-		stream << "Damping: " << Engine::simulatorParameters.cart.damping;
-		stream << " / " << Engine::simulatorParameters.pole.damping;
-		drawingDevice->screenText(stream.str(), 10, 110);
-		stream.str(std::string());
-		if (Engine::isLoaded()) {
-			if (Engine::simulatorParameters.engineName == nullptr || *Engine::simulatorParameters.engineName == 0)
-				stream << "Engine loaded";
-			else
-				stream << "Engine: " << Engine::simulatorParameters.engineName;
-		}
-		else
-			stream << "No engine";
-		drawingDevice->screenText(stream.str(), 10, 130);
-		drawingDevice->screenText("Press F1 for help", 10, height - 25);
-	}
-
-	/* Draw recorder rectangle. */
-	if (showCameraFrame || recording != nullptr) {
-		drawingDevice->animateObjects(Engine::simulatorParameters.actionFrequency);
-		double hbar = (drawingDevice->getWidth() / 2) - 640;
-		double vbar = (drawingDevice->getHeight() / 2) - 360;
-		drawingDevice->screenRectangleEmpty(hbar, vbar, hbar + 1280, vbar + 720, 2.0,
-			drawingDevice->brushText, drawingDevice->cameraStrokeStyle);
-	}
-
-	/* Draw log or help. */
-	const char* logText = nullptr;
-	if (showHelp)
-		logText = Simulator::helpText;
-	else if (showLog) {
-		logText = log.c_str();
-	}
-
-	if (logText != nullptr) {
-		/* Draw the log rectangle. */
-		drawingDevice->screenRectangle(2 * width / 3, 0, width, height, drawingDevice->brushLog);
-
-		/* Count the lines. */
-		const char* pc = logText;
-		int lines = (*pc != 0 ? 1 : 0);
-		bool lastIsNewLine = false;
-		while (*pc != 0) {
-			if (*pc == '\n') {
-				lines++;
-				lastIsNewLine = true;
-			}
-			else {
-				lastIsNewLine = false;
-			}
-			pc++;
-		}
-		if (lastIsNewLine) lines--;
-
-		/* How many lines are visible? */
-		double logWidth = width / 3;
-		double logHeight = height;
-		int visibleLines = static_cast<int>(std::floor(logHeight / 18));
-		if (visibleLines > lines) visibleLines = lines;
-
-		/* Skip invisible lines. */
-		std::stringstream stream(logText);
-		std::string line;
-		for (int i = 0; i < lines - visibleLines; i++)
-			std::getline(stream, line, '\n');
-
-		/* Draw visible text. */
-		double y = 0;
-		while (std::getline(stream, line)) {
-			drawingDevice->screenText(line, 2 * width / 3 + 2, y, logWidth - 4);
-			y += 18;
-		}
-	}
-
-	/* Display recording information. */
-	if (recording != nullptr) {
-		switch (recording->state) {
-		case Recording::State::RECORDING:
-		{
-			int tempo = static_cast<int>(recording->time * 2);
-			if (tempo % 2 == 0) {
-				drawingDevice->screenTextMsg(
-					"Recording",
-					drawingDevice->getHeight() / 2 - 15,
-					drawingDevice->brushTextRed
-				);
-			}
-			break;
-		}
-		case Recording::State::PROCESSING:
-		{
-			std::string msg = "Processing frames [" + recording->getRecordingName() + "] ... " +
-				std::to_string(recording->savedFrames + 1) + "/" +
-				std::to_string(recording->frameCount());
-			drawingDevice->screenTextMsg(msg, drawingDevice->getHeight() / 2 - 15);
-			break;
-		}
-		default:
-			break;
-		}
-	}
-}
-
-void Simulator::paintScenery(DrawingDevice* drawingDevice)
-{
-	/* Draw background. */
-	drawingDevice->fillBackground();
-
-	/* Draw markers. */
-	if (Engine::simulatorParameters.markers != nullptr) {
-		const Engine::Marker* pMarker = Engine::simulatorParameters.markers;
-		while (pMarker->width > 0) {
-			drawingDevice->stripe(
-				pMarker->x,
-				pMarker->width,
-				pMarker->red,
-				pMarker->green,
-				pMarker->blue
-			);
-			pMarker++;
-		}
-	}
-
-	/* Draw floor. */
-	drawingDevice->polygonBezier(
-		&floor[0],
-		static_cast<int>(floor.size()),
-		drawingDevice->brushFloor
-	);
-	drawingDevice->ground(-100, 100, -10, drawingDevice->brushFloor);
-}
-
-void Simulator::computeFloor()
-{
-	floor.clear();
-	floor.push_back(DrawingDevice::Bezier(DrawingDevice::Point(), DrawingDevice::Point(-100, -11)));
-	floor.push_back(DrawingDevice::Bezier(DrawingDevice::Point(-100, 0), DrawingDevice::Point(-100, 0)));
-	
-	double min = -100, max = 100;
-	if (Engine::simulatorParameters.craters != nullptr) {
-		const Engine::Crater* pCrater = Engine::simulatorParameters.craters;
-		while (pCrater->width > 0) {
-			double left = pCrater->x - pCrater->width / 2;
-			double right = pCrater->x + pCrater->width / 2;
-			bool valid =
-				left >= min &&
-				right <= max &&
-				pCrater->width >= 6 * std::abs(pCrater->depth) &&
-				std::abs(pCrater->depth) < 10;
-			if (valid) {
-				floor.push_back(
-					DrawingDevice::Bezier(
-						DrawingDevice::Point(left, 0),
-						DrawingDevice::Point(left, 0)
-					)
-				);
-				floor.push_back(
-					DrawingDevice::Bezier(
-						DrawingDevice::Point(left + 0.1 * pCrater->width, 0),
-						DrawingDevice::Point(left + 0.25 * pCrater->width, -pCrater->depth / 2)
-					)
-				);
-				floor.push_back(
-					DrawingDevice::Bezier(
-						DrawingDevice::Point(left + 0.4 * pCrater->width, -pCrater->depth),
-						DrawingDevice::Point(left + 0.5 * pCrater->width, -pCrater->depth)
-					)
-				);
-				floor.push_back(
-					DrawingDevice::Bezier(
-						DrawingDevice::Point(right - 0.4 * pCrater->width, -pCrater->depth),
-						DrawingDevice::Point(right - 0.25 * pCrater->width, -pCrater->depth / 2)
-					)
-				);
-				floor.push_back(
-					DrawingDevice::Bezier(
-						DrawingDevice::Point(right - 0.1 * pCrater->width, 0),
-						DrawingDevice::Point(right, 0)
-					)
-				);
-				min = right;
-			}
-			pCrater++;
-		}
-	}
-	
-	floor.push_back(DrawingDevice::Bezier(DrawingDevice::Point(100, 0), DrawingDevice::Point(100, 0)));
-	floor.push_back(DrawingDevice::Bezier(DrawingDevice::Point(100, -11), DrawingDevice::Point(100, -11)));
-}
-
-void Simulator::alignCartWithFloor()
-{
-	double ycorrection = 0;
-	cart.phi = computeCartAngle(cart.x, cart.getWheelDistance() / 2, 0.01, ycorrection);
-	cart.y = getFloorHeight(cart.x) + ycorrection;
-}
-
-double Simulator::computeCartAngle(double x, double r, double epsilon, double& ycorrection)
-{
-	/* Central point on the floor. */
-	double x0 = x;
-	double y0 = getFloorHeight(x0);
-
-	/* Find front point. */
-	double x1 = 0;
-	double y1 = 0;
-	double min = x0;
-	double max = x0 + r;
-	double error = epsilon + 1;
-	while (error > epsilon) {
-		x1 = (min + max) / 2;
-		y1 = getFloorHeight(x1);
-		double xr = x1 - x0;
-		double yr = y1 - y0;
-		double dist = sqrt(xr * xr + yr * yr);
-		error = fabs(dist - r);
-		if (dist < r) min = x1;
-		else if (dist > r) max = x1;
-	}
-
-	/* Find rear point. */
-	double x2 = 0;
-	double y2 = 0;
-	min = x0;
-	max = x0 - r;
-	error = epsilon + 1;
-	while (error > epsilon) {
-		x2 = (min + max) / 2;
-		y2 = getFloorHeight(x2);
-		double xr = x2 - x0;
-		double yr = y2 - y0;
-		double dist = sqrt(xr * xr + yr * yr);
-		error = fabs(dist - r);
-		if (dist < r) min = x2;
-		else if (dist > r) max = x2;
-	}
-
-	/* Compute the angle. */
-	double angle = atan2(y1 - y2, x1 - x2);
-
-	/* Compute correction of y, so the wheels touch the floor. */
-	ycorrection = (y1 + y2) / 2 - y0;
-
-	/* Return the angle. */
-	return angle;
-}
-
-double Simulator::getFloorHeight(double x)
-{
-	double y = 0;
-	for (size_t i = 1; i < floor.size() - 1; i++) {
-		int result = computeBezierY(floor[i - 1].end, floor[i], x, y);
-		if (result == 0) return y;
-	}
-	return 0;
-}
-
-int Simulator::computeBezierY(DrawingDevice::Point& point, DrawingDevice::Bezier& bezier, double x, double&y)
-{
-	double a = point.x - 2 * bezier.control.x + bezier.end.x;
-	double b = 2 * bezier.control.x - 2 * point.x;
-	double c = point.x - x;
-
-	double d = b * b - 4 * a * c;
-	if (d < 0) return -1;
-	d = sqrt(d);
-
-	double t1 = (-1 * b + d) / (2 * a);
-	double t2 = (-1 * b - d) / (2 * a);
-
-	int valid1 = (t1 >= 0 && t1 <= 1);
-	int valid2 = (t2 >= 0 && t2 <= 1);
-
-	if (!valid1 && !valid2) return -1;
-	double t = (valid1 ? t1 : t2);
-
-	double u = 1 - t;
-	y = u * u * point.y + 2 * u * t * bezier.control.y + t * t * bezier.end.y;
-
-	return 0;
-}
-
-void Simulator::updateLog()
-{
-	if (Engine::simulatorParameters.pLogBuffer != nullptr && *Engine::simulatorParameters.pLogBuffer != 0)
-		log.append(Engine::simulatorParameters.pLogBuffer);
-}
-
-void Simulator::saveLog(const char* filename)
-{
-	if (filename == nullptr)
-		return;
-
-	std::ofstream file(filename, std::ios_base::out | std::ios_base::app);
-	if (file.is_open()) {
-		file << log.c_str();
-		file.close();
-	}
+#include <math.h>
+#include <string>
+#include <stdio.h>
+#include <iostream>
+#include <thread>
+#include "simulator.h"
+#include "cpuusage.h"
+#include "logchannel.h"
+#include "randomizer.h"
+#include "termination.h"
+#include "rollout.h"
+#include "trajectoryoptimizer.h"
+
+const char Simulator::helpText[] = "\
+\n  F1     - show/hide help\
+\n  F2     - show/hide information\
+\n  F3     - show/hide engine log\
+\n  F4     - show/hide camera frame\
+\n  F5     - reset view\
+\n  F6     - start/stop recording\
+\n  F7     - save flight recorder\
+\n  F8     - show/hide batch\
+\n  F9     - show/hide mosaic\
+\n  F11    - save checkpoint\
+\n  Arrows - apply/change force\
+\n  Enter  - reset simulation\
+\n  Mouse  - move objects, change view\
+";
+
+Simulator* Simulator::active = nullptr;
+
+Simulator::Simulator() :
+	recordingArena(1024 * 1024),
+	log(1000),
+	help(100)
+{
+	priorityUpdate = false;
+	terminate = false;
+	frozen = false;
+	engineActionsSuppressed = false;
+	simulationTime = 0;
+	manualAction = 0;
+	lastAction = 0;
+	episode = { 1, 0, 0.0, 0.0, Engine::TerminationReason::NOT_TERMINATED };
+	lastEpisode = { 0, 0, 0.0, 0.0, Engine::TerminationReason::NOT_TERMINATED };
+	episodeParameters = CartPhysics::getSimulatorParameters();
+	cartParameters = episodeParameters;
+	showInfo = true;
+	showLog = true;
+	showHelp = false;
+	showCameraFrame = false;
+	showBatch = true;
+	showMosaic = false;
+	cameraX = 0;
+	cameraY = 0;
+	cameraZoom = 1;
+	previousCameraX = 0;
+	previousCameraY = 0;
+	previousCameraZoom = 1;
+	updateCamera = false;
+	interpolation = 1;
+	recording = nullptr;
+	flightRecorder = nullptr;
+	policy = nullptr;
+	frameDrawingDevice = nullptr;
+	frameCart = nullptr;
+	checkpointTime = 0;
+	recordingNumber = 0;
+	checkpointRecording = 0;
+	checkpointFrames = 0;
+	if (Engine::simulatorParameters.flightRecorderDuration > 0) {
+		flightRecorder = new FlightRecorder(
+			Engine::simulatorParameters.flightRecorderDuration,
+			Engine::simulatorParameters.actionFrequency
+		);
+	}
+	terrain.compute(Engine::simulatorParameters.craters);
+	recordScenery(scenery, terrain);
+	terrain.align(cart);
+	log.open(Engine::simulatorParameters.logFilename);
+	help.append(Simulator::helpText);
+	if (Engine::simulatorParameters.policyFilename != nullptr) {
+		std::string error;
+		policy = new Policy();
+		if (!policy->load(Engine::simulatorParameters.policyFilename, error)) {
+			LogChannel::write(Engine::LogLevel::LOG_ERROR, ("Policy not loaded: " + error).c_str(), nullptr, 0);
+			delete policy;
+			policy = nullptr;
+		}
+	}
+	active = this;
+
+	reset();
+}
+
+Simulator::~Simulator()
+{
+	if (active == this)
+		active = nullptr;
+
+	if (recording != nullptr)
+		delete recording;
+
+	if (flightRecorder != nullptr)
+		delete flightRecorder;
+
+	if (policy != nullptr)
+		delete policy;
+
+	if (frameDrawingDevice != nullptr)
+		delete frameDrawingDevice;
+
+	if (frameCart != nullptr)
+		delete frameCart;
+}
+
+bool Simulator::isMouseOverLog(int x, int y, DrawingDevice* drawingDevice)
+{
+	if (!showLog)
+		return false;
+
+	double width = drawingDevice->getWidth();
+	double height = drawingDevice->getHeight();
+
+	if (x < 2 * width / 3 || x > width)
+		return false;
+	if (y < 0 || y > height)
+		return false;
+	
+	return true;
+}
+
+int Simulator::getObjectAt(double x, double y)
+{
+	return (!cart.frozen && cart.isTouched(x, y) ? 1 : 0);
+}
+
+void Simulator::moveObjectBy(int object, double dx, double dy)
+{
+	switch (object) {
+	case 1:
+		cart.x += dx;
+		cart.y += dy;
+		terrain.align(cart);
+		cart.storePose();
+		break;
+	}
+}
+
+void Simulator::freezeObject(int object, bool freeze)
+{
+	switch (object) {
+	case 1:
+		cart.dropMomentum();
+		cart.frozen = freeze;
+		break;
+	}
+}
+
+void Simulator::toggleInfo()
+{
+	showInfo = !showInfo;
+}
+
+void Simulator::toggleLog()
+{
+	showLog = !showLog;
+}
+
+void Simulator::togglehelp()
+{
+	showHelp = !showHelp;
+}
+
+void Simulator::toggleCameraFrame()
+{
+	showCameraFrame = !showCameraFrame;
+}
+
+void Simulator::toggleBatch()
+{
+	showBatch = !showBatch;
+}
+
+void Simulator::toggleMosaic()
+{
+	showMosaic = !showMosaic;
+}
+
+void Simulator::getState(Engine::SimulationState& state)
+{
+	state.x = cart.x;
+	state.y = cart.y;
+	state.dx = cart.dx;
+	state.ddx = cart.ddx;
+	state.theta = cart.theta;
+	state.dtheta = cart.dtheta;
+	state.ddtheta = cart.ddtheta;
+	state.phi = cart.phi;
+}
+
+void Simulator::startStopRecording()
+{
+	if (recording == nullptr) {
+		recording = new Recording(Engine::simulatorParameters.actionFrequency, &recordingArena);
+		recordingNumber++;
+	}
+	else if (recording->state == Recording::State::RECORDING)
+		recording->state = Recording::State::STOPPED;
+}
+
+void Simulator::saveFlightRecorder()
+{
+	if (flightRecorder == nullptr || flightRecorder->frameCount() == 0)
+		return;
+
+	std::string fileName;
+	if (flightRecorder->save(fileName))
+		LogChannel::write(Engine::LogLevel::LOG_INFO, ("Flight recorder saved to " + fileName).c_str(), nullptr, 0);
+	else
+		LogChannel::write(Engine::LogLevel::LOG_ERROR, "Flight recorder could not be saved.", nullptr, 0);
+
+	/* Start over, so that the next save contains only the new frames. */
+	flightRecorder->clear();
+}
+
+void Simulator::cancel()
+{
+	if (recording != nullptr) {
+		recording->state = Recording::State::FINISHED;
+	}
+}
+
+void Simulator::reset()
+{
+	/* A reset by the user or by the engine ends the current episode, unless
+	   a termination rule has ended it already. */
+	endEpisode(Engine::TerminationReason::RESET_REQUESTED);
+
+	Engine::InitialState initialState;
+	initialState.x = 0;
+	initialState.dx = 0;
+	initialState.ddx = 0;
+	initialState.theta = 0;
+	initialState.dtheta = 0;
+	initialState.ddtheta = 0;
+
+	Engine::setInitialState(initialState);
+
+	/* Sample the physics and the initial state of the new episode; the cart
+	   takes the sampled physics on top of the simulator parameters. */
+	const Engine::Randomization& randomization = Engine::simulatorParameters.randomization;
+	if (Randomizer::isEnabled(randomization)) {
+		episodeParameters = CartPhysics::getSimulatorParameters();
+		Randomizer::sample(randomization, randomization.stream, 1,
+			static_cast<uint32_t>(episode.number), &episodeParameters, &initialState);
+		cart.parameters = &cartParameters;
+		cartParameters = getCartParameters();
+	}
+	else {
+		cart.parameters = nullptr;
+	}
+
+	simulationTime = 0;
+	manualAction = 0;
+	lastAction = 0;
+	LogChannel::setTime(simulationTime);
+
+	cart.reset(initialState.x, initialState.dx, initialState.ddx,
+		initialState.theta, initialState.dtheta, initialState.ddtheta);
+	terrain.align(cart);
+	cart.storePose();
+	
+	Engine::SimulationState simulationState;
+	getState(simulationState);
+	
+	Engine::SimulationParameters simulationParameters;
+	simulationParameters.cameraParameters.x = cameraX;
+	simulationParameters.cameraParameters.y = cameraY;
+	simulationParameters.cameraParameters.zoom = cameraZoom;
+	simulationParameters.cameraAction = Engine::CameraAction::NO_CAMERA_ACTION;
+	simulationParameters.simulationAction = Engine::SimulationAction::NO_SIMULATION_ACTION;
+
+	Engine::stateUpdated(simulationTime, simulationState, simulationParameters);
+
+	/* After the reset, the camera jumps to the new position without interpolation. */
+	switch (simulationParameters.cameraAction) {
+	case Engine::CameraAction::UPDATE_CAMERA:
+		cameraX = simulationParameters.cameraParameters.x;
+		cameraY = simulationParameters.cameraParameters.y;
+		cameraZoom = simulationParameters.cameraParameters.zoom;
+		updateCamera = true;
+		break;
+	default:
+		break;
+	}
+	previousCameraX = cameraX;
+	previousCameraY = cameraY;
+	previousCameraZoom = cameraZoom;
+
+	switch (simulationParameters.simulationAction) {
+	case Engine::SimulationAction::RESET_SIMULATION:
+		/* The reset action is ignored, because the simulation has just been reset. */
+		break;
+	case Engine::SimulationAction::TERMINATE_SIMULATION:
+		terminate = true;
+		break;
+	default:
+		break;
+	}
+}
+
+void Simulator::setManualAction(double direction)
+{
+	manualAction = direction * Engine::simulatorParameters.manualForce;
+}
+
+void Simulator::setInterpolation(double interpolation)
+{
+	if (interpolation < 0) interpolation = 0;
+	if (interpolation > 1) interpolation = 1;
+	this->interpolation = interpolation;
+}
+
+void Simulator::tick(double dt)
+{
+	/* The pose before the tick, for the interpolation between the ticks. */
+	cart.storePose();
+
+	/* If simulation is frozen, only process the recording. */
+	if (frozen) {
+		if (recording != nullptr)
+			processRecording();
+		return;
+	}
+
+	/* Ask the policy, if one was given, or else the engine what action to
+	   execute. The manual action overrides the policy. */
+	Engine::CartAction cartAction;
+	cartAction.force = 0;
+	cartAction.options = Engine::ActionOptions::APPLY_FORCE;
+	if (policy != nullptr) {
+		double observation[5] = { cart.x, cart.dx, cart.theta, cart.dtheta, cart.phi };
+		cartAction.force = policy->evaluate(observation);
+		cartAction.options = Engine::ActionOptions::APPLY_FORCE_IF_NO_MANUAL_ACTION;
+	}
+	else {
+		Engine::applyAction(cartAction);
+	}
+
+	double action = 0;
+	switch (cartAction.options) {
+	case Engine::ActionOptions::APPLY_FORCE:
+		action = cartAction.force;
+		break;
+	case Engine::ActionOptions::APPLY_MANUAL_ACTION:
+		action = manualAction;
+		break;
+	case Engine::ActionOptions::APPLY_FORCE_IF_NO_MANUAL_ACTION:
+		if (manualAction != 0)
+			action = manualAction;
+		else
+			action = cartAction.force;
+		break;
+	default:
+		break;
+	}
+
+	/* Update the simulation time. */
+	simulationTime += dt;
+	LogChannel::setTime(simulationTime);
+	if (recording != nullptr)
+		recording->time += dt;
+
+	/* Simulate the cart, with the simulator parameters as they are now. */
+	if (cart.parameters != nullptr)
+		cartParameters = getCartParameters();
+	cart.tick(action, dt);
+	terrain.align(cart);
+
+	/* Prevent the cart from falling over the edge. */
+	double leftBound = -100 + cart.getWidth() / 2;
+	double rightBound = 100 - cart.getWidth() / 2;
+	if (cart.x < leftBound || cart.x > rightBound) {
+		if (cart.x < leftBound) cart.x = leftBound;
+		if (cart.x > rightBound) cart.x = rightBound;
+		cart.bounce();
+	}
+
+	/* Keep the state in the flight recorder. */
+	if (flightRecorder != nullptr) {
+		flightRecorder->snap(
+			simulationTime,
+			action,
+			cart.x,
+			cart.y,
+			cart.theta,
+			cart.phi,
+			cart.dx,
+			cart.ddx,
+			cart.dtheta,
+			cart.ddtheta
+		);
+	}
+
+	/* Count the tick in the episode and check the termination rules. */
+	Engine::TerminationReason terminationReason = checkTermination(dt);
+	episode.length++;
+	episode.time = simulationTime;
+	episode.episodeReturn += Engine::simulatorParameters.termination.stepReward;
+	if (terminationReason == Engine::TerminationReason::TARGET_REACHED)
+		episode.episodeReturn += Engine::simulatorParameters.termination.targetReward;
+
+	/* Notify the engine that the state has been updated. */
+	Engine::SimulationState simulationState;
+	getState(simulationState);
+
+	Engine::SimulationParameters simulationParameters;
+	simulationParameters.cameraParameters.x = cameraX;
+	simulationParameters.cameraParameters.y = cameraY;
+	simulationParameters.cameraParameters.zoom = cameraZoom;
+	simulationParameters.cameraAction = Engine::CameraAction::NO_CAMERA_ACTION;
+	simulationParameters.simulationAction = Engine::SimulationAction::NO_SIMULATION_ACTION;
+
+	Engine::stateUpdated(simulationTime, simulationState, simulationParameters);
+
+	/* The camera is interpolated between the previous and the new position. If
+	   not updated, a pending update settles at the last position. */
+	previousCameraX = cameraX;
+	previousCameraY = cameraY;
+	previousCameraZoom = cameraZoom;
+	switch (simulationParameters.cameraAction) {
+	case Engine::CameraAction::UPDATE_CAMERA:
+		cameraX = simulationParameters.cameraParameters.x;
+		cameraY = simulationParameters.cameraParameters.y;
+		cameraZoom = simulationParameters.cameraParameters.zoom;
+		updateCamera = true;
+		break;
+	default:
+		break;
+	}
+
+	/* Does the engine want to change the simulation flow? If not, a termination
+	   rule may. */
+	Engine::SimulationAction simulationAction = simulationParameters.simulationAction;
+	if (simulationAction == Engine::SimulationAction::NO_SIMULATION_ACTION &&
+		terminationReason != Engine::TerminationReason::NOT_TERMINATED)
+		simulationAction = Engine::simulatorParameters.termination.action;
+	else if (simulationAction == Engine::SimulationAction::RESET_SIMULATION)
+		terminationReason = Engine::TerminationReason::RESET_REQUESTED;
+	else if (simulationAction == Engine::SimulationAction::TERMINATE_SIMULATION)
+		terminationReason = Engine::TerminationReason::TERMINATE_REQUESTED;
+
+	switch (simulationAction) {
+	case Engine::SimulationAction::RESET_SIMULATION:
+		if (Engine::simulatorParameters.flightRecorderTriggers & Engine::FlightRecorderTrigger::DUMP_ON_RESET)
+			saveFlightRecorder();
+		endEpisode(terminationReason);
+		reset();
+		break;
+	case Engine::SimulationAction::TERMINATE_SIMULATION:
+		if (Engine::simulatorParameters.flightRecorderTriggers & Engine::FlightRecorderTrigger::DUMP_ON_TERMINATE)
+			saveFlightRecorder();
+		endEpisode(terminationReason);
+		terminate = true;
+		break;
+	default:
+		break;
+	}
+
+	/* If recording, record the current state. */
+	if (recording != nullptr) {
+		processRecording();
+	}
+
+	/* Take a checkpoint every few seconds of the simulation. */
+	if (Engine::simulatorParameters.checkpointFilename != nullptr && Engine::simulatorParameters.checkpointInterval > 0) {
+		checkpointTime += dt;
+		if (checkpointTime >= Engine::simulatorParameters.checkpointInterval) {
+			checkpointTime = 0;
+			if (!saveCheckpoint(Engine::simulatorParameters.checkpointFilename))
+				LogChannel::write(Engine::LogLevel::LOG_ERROR, "Checkpoint could not be saved.", nullptr, 0);
+		}
+	}
+}
+
+int Simulator::runSequence(
+	const Engine::SimulationState* state,
+	const double* forces,
+	int k,
+	Engine::SimulationState* trajectory
+) {
+	if (active == nullptr || state == nullptr || forces == nullptr || k <= 0)
+		return 0;
+
+	/* The sequence starts from a copy, with the physics of the current episode. */
+	Rollout rollout(active->terrain, active->cart.getWidth(), 1.0 / Engine::simulatorParameters.actionFrequency);
+	Engine::SimulationState start = *state;
+	rollout.run(active->getCartParameters(), start, forces, k, trajectory);
+
+	return k;
+}
+
+int Simulator::evaluateSequences(
+	const Engine::SimulationState* state,
+	const double* forces,
+	int m,
+	int k,
+	const Engine::QuadraticCost* cost,
+	double* costs
+) {
+	if (active == nullptr || state == nullptr || forces == nullptr || cost == nullptr || costs == nullptr || m <= 0 || k <= 0)
+		return 0;
+
+	Rollout rollout(active->terrain, active->cart.getWidth(), 1.0 / Engine::simulatorParameters.actionFrequency);
+	rollout.evaluate(active->getCartParameters(), *state, forces, m, k, *cost, costs);
+
+	return m;
+}
+
+int Simulator::optimizeSequence(
+	const Engine::SimulationState* state,
+	double* forces,
+	int k,
+	const Engine::QuadraticCost* cost,
+	const Engine::OptimizerSettings* settings,
+	double* result
+) {
+	if (active == nullptr || state == nullptr || forces == nullptr || cost == nullptr || settings == nullptr || k <= 0)
+		return 0;
+
+	TrajectoryOptimizer optimizer(active->terrain, active->cart.getWidth(), 1.0 / Engine::simulatorParameters.actionFrequency);
+	return optimizer.optimize(active->getCartParameters(), *state, forces, k, *cost, *settings, result);
+}
+
+void Simulator::takeCheckpoint()
+{
+	const char* fileName = Engine::simulatorParameters.checkpointFilename;
+	if (fileName == nullptr)
+		fileName = "checkpoint.cpk";
+
+	if (saveCheckpoint(fileName))
+		LogChannel::write(Engine::LogLevel::LOG_INFO, (std::string("Checkpoint saved to ") + fileName).c_str(), nullptr, 0);
+	else
+		LogChannel::write(Engine::LogLevel::LOG_ERROR, "Checkpoint could not be saved.", nullptr, 0);
+}
+
+bool Simulator::saveCheckpoint(const char* fileName)
+{
+	checkpoint.clear();
+
+	checkpoint.beginSection(Checkpoint::Section::SIMULATOR);
+	checkpoint.write(simulationTime);
+	checkpoint.write(manualAction);
+	checkpoint.write(lastAction);
+	checkpoint.write(frozen);
+	checkpoint.write(episode);
+	checkpoint.write(lastEpisode);
+	checkpoint.write(episodeParameters);
+	checkpoint.write(cart.parameters != nullptr);
+	const double camera[] = { cameraX, cameraY, cameraZoom, previousCameraX, previousCameraY, previousCameraZoom };
+	checkpoint.write(camera);
+	checkpoint.write(updateCamera);
+	checkpoint.write(checkpointTime);
+	checkpoint.endSection();
+
+	checkpoint.beginSection(Checkpoint::Section::CART);
+	cart.writeCheckpoint(checkpoint);
+	checkpoint.endSection();
+
+	/* Only the frames recorded since the previous checkpoint are appended,
+	   after those of the previous checkpoint, which stays valid until this
+	   one replaces it. Any other recording or checkpoint file starts the
+	   other one of the two frames files of the checkpoint, and the file of
+	   the checkpoint replaced is removed once this one is saved. */
+	std::string framesFile;
+	std::string replacedFramesFile;
+	if (recording != nullptr) {
+		int slot = (checkpointFramesFile == getFramesFile(fileName, 1) ? 1 : 0);
+		int first = checkpointFrames;
+		if (checkpointRecording != recordingNumber || checkpointFramesFile != getFramesFile(fileName, slot) ||
+			checkpointFrames > recording->frameCount()) {
+			int replacedSlot = readFramesSlot(fileName);
+			if (replacedSlot >= 0)
+				replacedFramesFile = getFramesFile(fileName, replacedSlot);
+			slot = (replacedSlot == 0 ? 1 : 0);
+			first = 0;
+		}
+		framesFile = getFramesFile(fileName, slot);
+		if (!recording->saveFrames(framesFile, first))
+			return false;
+
+		checkpoint.beginSection(Checkpoint::Section::RECORDING);
+		checkpoint.write(slot);
+		recording->writeCheckpoint(checkpoint);
+		checkpoint.endSection();
+	}
+	else if (checkpointFramesFile == getFramesFile(fileName, 0) || checkpointFramesFile == getFramesFile(fileName, 1))
+		replacedFramesFile = checkpointFramesFile;
+
+	checkpoint.beginSection(Checkpoint::Section::LOG);
+	log.writeCheckpoint(checkpoint);
+	checkpoint.endSection();
+
+	/* The engine tells the size of its state first. */
+	int size = Engine::saveState(nullptr, 0);
+	if (size > 0) {
+		engineState.resize(size);
+		if (Engine::saveState(&engineState[0], size) != size)
+			return false;
+		checkpoint.beginSection(Checkpoint::Section::ENGINE);
+		checkpoint.write(&engineState[0], size);
+		checkpoint.endSection();
+	}
+
+	if (!checkpoint.save(fileName))
+		return false;
+
+	if (!replacedFramesFile.empty() && replacedFramesFile != framesFile)
+		remove(replacedFramesFile.c_str());
+	checkpointRecording = recordingNumber;
+	checkpointFrames = (recording != nullptr ? recording->frameCount() : 0);
+	checkpointFramesFile = framesFile;
+	return true;
+}
+
+std::string Simulator::getFramesFile(const char* fileName, int slot)
+{
+	return std::string(fileName) + ".frames." + std::to_string(slot);
+}
+
+/* The frames file of the checkpoint in the file, -1 if it has none. */
+int Simulator::readFramesSlot(const char* fileName)
+{
+	CheckpointReader reader;
+	int slot = -1;
+	if (!reader.load(fileName) || !reader.findSection(Checkpoint::Section::RECORDING) || !reader.read(slot))
+		return -1;
+	return slot;
+}
+
+bool Simulator::loadCheckpoint(const char* fileName)
+{
+	CheckpointReader reader;
+	if (!reader.load(fileName) || !reader.findSection(Checkpoint::Section::SIMULATOR))
+		return false;
+
+	bool randomized = false;
+	double camera[6];
+	bool loaded =
+		reader.read(simulationTime) &&
+		reader.read(manualAction) &&
+		reader.read(lastAction) &&
+		reader.read(frozen) &&
+		reader.read(episode) &&
+		reader.read(lastEpisode) &&
+		reader.read(episodeParameters) &&
+		reader.read(randomized) &&
+		reader.read(camera) &&
+		reader.read(updateCamera) &&
+		reader.read(checkpointTime);
+	if (!loaded)
+		return false;
+
+	cart.parameters = (randomized ? &cartParameters : nullptr);
+	cartParameters = getCartParameters();
+	cameraX = camera[0];
+	cameraY = camera[1];
+	cameraZoom = camera[2];
+	previousCameraX = camera[3];
+	previousCameraY = camera[4];
+	previousCameraZoom = camera[5];
+	LogChannel::setTime(simulationTime);
+
+	if (!reader.findSection(Checkpoint::Section::CART) || !cart.readCheckpoint(reader))
+		return false;
+
+	/* A recording continues where it was; frames being saved are saved again
+	   from the one that was next. */
+	if (recording != nullptr) {
+		delete recording;
+		recording = nullptr;
+		recordingArena.release();
+	}
+	if (reader.findSection(Checkpoint::Section::RECORDING)) {
+		int slot = 0;
+		if (!reader.read(slot))
+			return false;
+		std::string framesFile = getFramesFile(fileName, slot);
+		recording = Recording::readCheckpoint(reader, &recordingArena, framesFile);
+		if (recording == nullptr)
+			return false;
+		recordingNumber++;
+		checkpointRecording = recordingNumber;
+		checkpointFrames = recording->frameCount();
+		checkpointFramesFile = framesFile;
+		if (recording->state == Recording::State::PROCESSING) {
+			if (frameDrawingDevice == nullptr)
+				frameDrawingDevice = new DrawingDevice(1280, 720);
+			if (frameCart == nullptr)
+				frameCart = new Cart();
+			priorityUpdate = true;
+		}
+	}
+
+	if (reader.findSection(Checkpoint::Section::LOG) && !log.readCheckpoint(reader))
+		return false;
+
+	if (reader.findSection(Checkpoint::Section::ENGINE))
+		return Engine::loadState(reader.getData(), static_cast<int>(reader.getRemaining())) != 0;
+	return true;
+}
+
+PhysicalParameters Simulator::getCartParameters() const
+{
+	PhysicalParameters parameters = CartPhysics::getSimulatorParameters();
+	if (cart.parameters != nullptr)
+		Randomizer::applyPhysics(Engine::simulatorParameters.randomization, episodeParameters, parameters);
+	return parameters;
+}
+
+Engine::TerminationReason Simulator::checkTermination(double dt) const
+{
+	return Termination::check(Engine::simulatorParameters.termination, cart.x, cart.theta, simulationTime, dt);
+}
+
+void Simulator::endEpisode(Engine::TerminationReason reason)
+{
+	if (episode.length == 0)
+		return;
+
+	episode.reason = reason;
+	lastEpisode = episode;
+	Engine::episodeEnded(episode);
+
+	episode.number++;
+	episode.length = 0;
+	episode.time = 0;
+	episode.episodeReturn = 0;
+	episode.reason = Engine::TerminationReason::NOT_TERMINATED;
+}
+
+void Simulator::processRecording()
+{
+	switch (recording->state) {
+	case Recording::State::RECORDING:
+	{
+		recording->setEpisode(episode.number);
+		recording->snap(
+			lastAction,
+			cart.x,
+			cart.y,
+			cart.theta,
+			cart.phi,
+			cart.dx,
+			cart.ddx,
+			cart.dtheta,
+			cart.ddtheta,
+			cameraX,
+			cameraY,
+			cameraZoom
+		);
+		break;
+	}
+	case Recording::State::STOPPED:
+	{
+		frozen = true;
+		recording->createFolder();
+		recording->saveFramesData();
+		recording->saveFramesArrow();
+		recording->savedFrames = 0;
+		frameDrawingDevice = new DrawingDevice(1280, 720);
+		frameCart = new Cart();
+		recording->state = Recording::State::PROCESSING;
+		priorityUpdate = true;
+		break;
+	}
+	case Recording::State::PROCESSING:
+	{
+		if (recording->savedFrames >= recording->frameCount()) {
+			recording->state = Recording::State::FINISHED;
+			break;
+		}
+
+		Frame frame = recording->getFrame(recording->savedFrames);
+		frameCart->x = frame.x;
+		frameCart->y = frame.y;
+		frameCart->theta = frame.theta;
+		frameCart->phi = frame.phi;
+		frameDrawingDevice->setCamera(frame.camerax, frame.cameray, frame.zoom);
+		frameDrawingDevice->beginDraw();
+		paintScenery(frameDrawingDevice);
+		frameCart->paint(frameDrawingDevice);
+		frameDrawingDevice->endDraw();
+		recording->savedFrames++;
+		frameDrawingDevice->saveToFile(
+			recording->getFolderName() + "\\frame" +
+			std::to_string(recording->savedFrames) + ".png");
+		break;
+	}
+	case Recording::State::FINISHED:
+		frozen = false;
+		priorityUpdate = false;
+		delete frameCart;
+		frameCart = nullptr;
+		delete frameDrawingDevice;
+		frameDrawingDevice = nullptr;
+		delete recording;
+		recording = nullptr;
+		recordingArena.release();
+		break;
+	default:
+		break;
+	}
+}
+
+void Simulator::paint(DrawingDevice* drawingDevice)
+{
+	if (drawingDevice == nullptr)
+		return;
+
+	/* Drawing device width and height. */
+	double width = drawingDevice->getWidth();
+	double height = drawingDevice->getHeight();
+	
+	if (updateCamera) {
+		drawingDevice->setCamera(
+			previousCameraX + (cameraX - previousCameraX) * interpolation,
+			previousCameraY + (cameraY - previousCameraY) * interpolation,
+			previousCameraZoom + (cameraZoom - previousCameraZoom) * interpolation
+		);
+		if (cameraX == previousCameraX && cameraY == previousCameraY && cameraZoom == previousCameraZoom)
+			updateCamera = false;
+	}
+	else {
+		/* Remember the last camera settings. */
+		cameraX = drawingDevice->getCameraX();
+		cameraY = drawingDevice->getCameraY();
+		cameraZoom = drawingDevice->getCameraZoom();
+		previousCameraX = cameraX;
+		previousCameraY = cameraY;
+		previousCameraZoom = cameraZoom;
+	}
+
+	if (showMosaic && Engine::simulatorParameters.mosaicSize > 0) {
+		/* Draw the environments of the mosaic instead of the simulation. */
+		paintMosaic(drawingDevice);
+	}
+	else {
+		/* Draw background and floor. */
+		paintScenery(drawingDevice);
+
+		/* Draw the batch of environments behind the cart. */
+		if (showBatch)
+			paintBatch(drawingDevice);
+
+		/* Draw cart between the last two states. */
+		cart.paint(drawingDevice, interpolation);
+	}
+
+	/* Draw text */
+	if (showInfo) {
+		char text[256];
+		snprintf(text, sizeof(text), "CPU: %.1f%%", CPUUsage::getUsage());
+		drawingDevice->screenText(text, 10, 10);
+		snprintf(text, sizeof(text), "Action frequency: %d Hz", Engine::simulatorParameters.actionFrequency);
+		drawingDevice->screenText(text, 10, 30);
+		snprintf(text, sizeof(text), "Simulation speed: %dx", Engine::simulatorParameters.simulationSpeed);
+		drawingDevice->screenText(text, 10, 50);
+		snprintf(text, sizeof(text), "Manual force: %.1f N", Engine::simulatorParameters.manualForce);
+		drawingDevice->screenText(text, 10, 70);
+		PhysicalParameters physicalParameters = getCartParameters();
+		snprintf(text, sizeof(text), "Mass: %.1f Kg / %.1f Kg",
+			physicalParameters.cartMass, physicalParameters.poleMass);
+		drawingDevice->screenText(text, 10, 90);
+		snprintf(text, sizeof(text), "Damping: %.1f / %.1f",
+			physicalParameters.cartDamping, physicalParameters.poleDamping);
+		drawingDevice->screenText(text, 10, 110);
+		if (Engine::isLoaded()) {
+			if (Engine::simulatorParameters.engineName == nullptr || *Engine::simulatorParameters.engineName == 0)
+				snprintf(text, sizeof(text), "Engine loaded");
+			else
+				snprintf(text, sizeof(text), "Engine: %s", Engine::simulatorParameters.engineName);
+		}
+		else
+			snprintf(text, sizeof(text), "No engine");
+		drawingDevice->screenText(text, 10, 130);
+		snprintf(text, sizeof(text), "Episode: %d", episode.number);
+		drawingDevice->screenText(text, 10, 150);
+		if (lastEpisode.number > 0) {
+			snprintf(text, sizeof(text), "Last episode: %d ticks, return %.1f",
+				lastEpisode.length, lastEpisode.episodeReturn);
+			drawingDevice->screenText(text, 10, 170);
+		}
+		drawingDevice->screenText("Press F1 for help", 10, height - 25);
+	}
+
+	/* Draw recorder rectangle. */
+	if (showCameraFrame || recording != nullptr) {
+		drawingDevice->animateObjects(Engine::simulatorParameters.actionFrequency);
+		double hbar = (drawingDevice->getWidth() / 2) - 640;
+		double vbar = (drawingDevice->getHeight() / 2) - 360;
+		drawingDevice->screenRectangleEmpty(hbar, vbar, hbar + 1280, vbar + 720, 2.0,
+			drawingDevice->brushText, drawingDevice->cameraStrokeStyle);
+	}
+
+	/* Draw log or help. */
+	LogStore* logText = nullptr;
+	if (showHelp)
+		logText = &help;
+	else if (showLog)
+		logText = &log;
+
+	if (logText != nullptr) {
+		/* Draw the log rectangle. */
+		drawingDevice->screenRectangle(2 * width / 3, 0, width, height, drawingDevice->brushLog);
+
+		/* How many lines are visible? */
+		int lines = logText->lineCount();
+		double logWidth = width / 3;
+		double logHeight = height;
+		int visibleLines = static_cast<int>(std::floor(logHeight / 18));
+		if (visibleLines > lines) visibleLines = lines;
+
+		/* Draw only the visible lines. */
+		double y = 0;
+		for (int i = lines - visibleLines; i < lines; i++) {
+			drawingDevice->screenText(logText->getLine(i), 2 * width / 3 + 2, y, logWidth - 4);
+			y += 18;
+		}
+	}
+
+	/* Display recording information. */
+	if (recording != nullptr) {
+		switch (recording->state) {
+		case Recording::State::RECORDING:
+		{
+			int tempo = static_cast<int>(recording->time * 2);
+			if (tempo % 2 == 0) {
+				drawingDevice->screenTextMsg(
+					"Recording",
+					drawingDevice->getHeight() / 2 - 15,
+					drawingDevice->brushTextRed
+				);
+			}
+			break;
+		}
+		case Recording::State::PROCESSING:
+		{
+			char msg[256];
+			snprintf(msg, sizeof(msg), "Processing frames [%s] ... %d/%d",
+				recording->getRecordingName().c_str(),
+				recording->savedFrames + 1,
+				recording->frameCount()
+			);
+			drawingDevice->screenTextMsg(msg, drawingDevice->getHeight() / 2 - 15);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+void Simulator::paintScenery(DrawingDevice* drawingDevice)
+{
+	drawingDevice->draw(scenery);
+}
+
+void Simulator::paintBatch(DrawingDevice* drawingDevice)
+{
+	const Engine::SimulationState* states = Engine::simulatorParameters.batchStates;
+	int n = Engine::simulatorParameters.batchSize;
+	if (states == nullptr || n <= 0)
+		return;
+
+	if (static_cast<int>(batchAngles.size()) < 4 * n) {
+		batchAngles.resize(4 * n);
+		batchVertices.resize(8 * n);
+	}
+
+	/* The same shape as the cart: the body and the pole. */
+	double width = Engine::simulatorParameters.cart.size;
+	double halfWidth = width / 2;
+	double height = width / 6;
+	double wheel = width / 10;
+	double poleLength = Engine::simulatorParameters.pole.size;
+	double poleHalfWidth = width / 40;
+
+	/* Compute the angles of all the carts first, then all the vertices. */
+	double* sinP = &batchAngles[0];
+	double* cosP = &batchAngles[n];
+	double* sinT = &batchAngles[2 * n];
+	double* cosT = &batchAngles[3 * n];
+	for (int i = 0; i < n; i++) {
+		sinP[i] = sin(states[i].phi);
+		cosP[i] = cos(states[i].phi);
+		sinT[i] = sin(states[i].phi - states[i].theta);
+		cosT[i] = cos(states[i].phi - states[i].theta);
+	}
+
+	DrawingDevice::Point* v = &batchVertices[0];
+	for (int i = 0; i < n; i++) {
+		double x = states[i].x;
+		double y = states[i].y;
+
+		/* Body: local (-halfWidth..halfWidth, wheel..wheel + height) rotated by phi. */
+		double bx = -wheel * sinP[i], by = wheel * cosP[i];
+		double wx = halfWidth * cosP[i], wy = halfWidth * sinP[i];
+		double hx = -height * sinP[i], hy = height * cosP[i];
+		v[0] = DrawingDevice::Point(x + bx - wx, y + by - wy);
+		v[1] = DrawingDevice::Point(x + bx + wx, y + by + wy);
+		v[2] = DrawingDevice::Point(x + bx + wx + hx, y + by + wy + hy);
+		v[3] = DrawingDevice::Point(x + bx - wx + hx, y + by - wy + hy);
+
+		/* Pole: local (-poleHalfWidth..poleHalfWidth, 0..poleLength) rotated by phi - theta on top of the body. */
+		double px = x + bx + hx, py = y + by + hy;
+		double ax = poleHalfWidth * cosT[i], ay = poleHalfWidth * sinT[i];
+		double lx = -poleLength * sinT[i], ly = poleLength * cosT[i];
+		v[4] = DrawingDevice::Point(px - ax, py - ay);
+		v[5] = DrawingDevice::Point(px + ax, py + ay);
+		v[6] = DrawingDevice::Point(px + ax + lx, py + ay + ly);
+		v[7] = DrawingDevice::Point(px - ax + lx, py - ay + ly);
+		v += 8;
+	}
+
+	drawingDevice->polygons(&batchVertices[0], 2 * n, 4, drawingDevice->brushGhost);
+}
+
+void Simulator::paintMosaic(DrawingDevice* drawingDevice)
+{
+	const Engine::MosaicTile* tiles = Engine::simulatorParameters.mosaicTiles;
+	int n = Engine::simulatorParameters.mosaicSize;
+	if (tiles == nullptr || n <= 0)
+		return;
+
+	/* Take a snapshot, so that all tiles show the same moment. */
+	mosaicTiles.assign(tiles, tiles + n);
+	prepareMosaic();
+
+	int columns = Engine::simulatorParameters.mosaicColumns;
+	if (columns <= 0)
+		columns = static_cast<int>(ceil(sqrt(static_cast<double>(n))));
+	int rows = (n + columns - 1) / columns;
+	double tileWidth = drawingDevice->getWidth() / columns;
+	double tileHeight = drawingDevice->getHeight() / rows;
+
+	/* The zoom of a tile is relative to the whole window. */
+	double scale = tileWidth / drawingDevice->getWidth();
+	if (tileHeight / drawingDevice->getHeight() < scale)
+		scale = tileHeight / drawingDevice->getHeight();
+
+	double x = drawingDevice->getCameraX();
+	double y = drawingDevice->getCameraY();
+	double zoom = drawingDevice->getCameraZoom();
+	for (int i = 0; i < n; i++) {
+		const Engine::MosaicTile& tile = mosaicTiles[i];
+		drawingDevice->setViewport((i % columns) * tileWidth, (i / columns) * tileHeight, tileWidth, tileHeight);
+		drawingDevice->setCamera(tile.camera.x, tile.camera.y, tile.camera.zoom * scale);
+		drawingDevice->draw(mosaic[i].scenery);
+
+		mosaicCart.x = tile.state.x;
+		mosaicCart.y = tile.state.y;
+		mosaicCart.phi = tile.state.phi;
+		mosaicCart.theta = tile.state.theta;
+		mosaicCart.paint(drawingDevice);
+	}
+	drawingDevice->resetViewport();
+	drawingDevice->setCamera(x, y, zoom);
+}
+
+void Simulator::prepareMosaic()
+{
+	int n = static_cast<int>(mosaicTiles.size());
+	if (static_cast<int>(mosaic.size()) != n)
+		mosaic.resize(n);
+
+	mosaicPending.clear();
+	for (int i = 0; i < n; i++) {
+		const Engine::MosaicTile& tile = mosaicTiles[i];
+		MosaicView& view = mosaic[i];
+		if (!view.valid || view.craters != tile.craters || view.cratersVersion != tile.cratersVersion) {
+			view.craters = tile.craters;
+			view.cratersVersion = tile.cratersVersion;
+			view.valid = true;
+			mosaicPending.push_back(i);
+		}
+	}
+	if (mosaicPending.empty())
+		return;
+
+	/* The terrain of the tiles is prepared in parallel; only the drawing itself
+	   has to stay on this thread, together with the render target. */
+	int pending = static_cast<int>(mosaicPending.size());
+	int threadCount = static_cast<int>(std::thread::hardware_concurrency());
+	if (threadCount > pending)
+		threadCount = pending;
+	if (threadCount < 1)
+		threadCount = 1;
+
+	auto prepare = [this, pending, threadCount](int first) {
+		for (int i = first; i < pending; i += threadCount) {
+			MosaicView& view = mosaic[mosaicPending[i]];
+			view.terrain.compute(view.craters);
+			recordScenery(view.scenery, view.terrain);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int t = 1; t < threadCount; t++)
+		threads.push_back(std::thread(prepare, t));
+	prepare(0);
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+void Simulator::recordScenery(DisplayList& scenery, const Terrain& terrain)
+{
+	scenery.clear();
+
+	/* Draw background. */
+	scenery.fillBackground();
+
+	/* Draw markers. */
+	if (Engine::simulatorParameters.markers != nullptr) {
+		const Engine::Marker* pMarker = Engine::simulatorParameters.markers;
+		while (pMarker->width > 0) {
+			scenery.stripe(
+				pMarker->x,
+				pMarker->width,
+				pMarker->red,
+				pMarker->green,
+				pMarker->blue
+			);
+			pMarker++;
+		}
+	}
+
+	/* Draw floor. */
+	const std::vector<DrawingDevice::Bezier>& floor = terrain.getFloor();
+	scenery.polygonBezier(
+		&floor[0],
+		static_cast<int>(floor.size()),
+		&DrawingDevice::brushFloor
+	);
+	scenery.ground(-100, 100, -10, &DrawingDevice::brushFloor);
+}
+
+void Simulator::updateLog(bool echo)
+{
+	/* Text written into the log buffer. */
+	if (Engine::simulatorParameters.pLogBuffer != nullptr && *Engine::simulatorParameters.pLogBuffer != 0) {
+		log.append(Engine::simulatorParameters.pLogBuffer);
+		if (echo)
+			std::cout << Engine::simulatorParameters.pLogBuffer;
+	}
+
+	/* Records written into the log channel. */
+	LogChannel::Record record;
+	char line[LogChannel::lineSize];
+	while (LogChannel::read(record)) {
+		LogChannel::format(record, line, sizeof(line));
+		log.append(line);
+		if (echo)
+			std::cout << line;
+	}
+
+	unsigned int dropped = LogChannel::takeDropped();
+	if (dropped > 0) {
+		snprintf(line, sizeof(line), "%u log records dropped.\n", dropped);
+		log.append(line);
+		if (echo)
+			std::cout << line;
+	}
+}
+
+void Simulator::closeLog()
+{
+	log.close();
 }
\ No newline at end of file
@@ -1,68 +1,163 @@
-#pragma once
-#include <string>
-#include <vector>
-#include "engine.h"
-#include "drawingDevice.h"
-#include "cart.h"
-#include "recording.h"
-
-class Simulator
-{
-public:
-	Simulator();
-	~Simulator();
-
-	bool hasPriorityUpdate() const { return priorityUpdate; }
-	bool wantsToTerminate()  const { return terminate; }
-	bool isMouseOverLog(int x, int y, DrawingDevice* drawingDevice);
-	int getObjectAt(double x, double y);
-	void moveObjectBy(int object, double dx, double dy);
-	void freezeObject(int object, bool freeze);
-	void toggleInfo();
-	void toggleLog();
-	void togglehelp();
-	void toggleCameraFrame();
-	void getState(Engine::SimulationState& state);
-	void startStopRecording();
-	void cancel();
-	void reset();
-	void suppressEngineActions(bool suppress) { engineActionsSuppressed = suppress; }
-	void setManualAction(double direction);
-	void tick(double dt);
-	void paint(DrawingDevice* drawingDevice);
-	void updateLog();
-	void saveLog(const char *filename);
-	
-protected:
-	static const char helpText[];
-	std::vector<DrawingDevice::Bezier> floor;
-	bool priorityUpdate;
-	bool terminate;
-	bool frozen;
-	Cart cart;
-	bool engineActionsSuppressed;
-	double simulationTime;
-	double manualAction;
-	double lastAction;
-	bool showInfo;
-	bool showLog;
-	bool showHelp;
-	bool showCameraFrame;
-	double cameraX;
-	double cameraY;
-	double cameraZoom;
-	bool updateCamera;
-	Recording* recording;
-	DrawingDevice* frameDrawingDevice;
-	Cart* frameCart;
-	std::string log;
-
-private:
-	void processRecording();
-	void paintScenery(DrawingDevice* drawingDevice);
-	void computeFloor();
-	void alignCartWithFloor();
-	double computeCartAngle(double x, double r, double epsilon, double& ycorrection);
-	double getFloorHeight(double x);
-	int computeBezierY(DrawingDevice::Point &point, DrawingDevice::Bezier& bezier, double x, double &y);
+#pragma once
+#include <string>
+#include <vector>
+#include "engine.h"
+#include "drawingDevice.h"
+#include "displaylist.h"
+#include "cart.h"
+#include "terrain.h"
+#include "recording.h"
+#include "flightrecorder.h"
+#include "logstore.h"
+#include "arena.h"
+#include "checkpoint.h"
+#include "policy.h"
+
+class Simulator
+{
+public:
+	Simulator();
+	~Simulator();
+
+	bool hasPriorityUpdate() const { return priorityUpdate; }
+	bool wantsToTerminate()  const { return terminate; }
+	bool isMouseOverLog(int x, int y, DrawingDevice* drawingDevice);
+	int getObjectAt(double x, double y);
+	void moveObjectBy(int object, double dx, double dy);
+	void freezeObject(int object, bool freeze);
+	void toggleInfo();
+	void toggleLog();
+	void togglehelp();
+	void toggleCameraFrame();
+	void toggleBatch();
+	void toggleMosaic();
+	void getState(Engine::SimulationState& state);
+	void startStopRecording();
+	void saveFlightRecorder();
+	void takeCheckpoint();
+	bool saveCheckpoint(const char* fileName);
+	bool loadCheckpoint(const char* fileName);
+	void cancel();
+	void reset();
+	void suppressEngineActions(bool suppress) { engineActionsSuppressed = suppress; }
+	void setManualAction(double direction);
+	void setInterpolation(double interpolation);
+	void tick(double dt);
+	void paint(DrawingDevice* drawingDevice);
+	void updateLog(bool echo = false);
+	void closeLog();
+	const Engine::EpisodeStatistics& getEpisodeStatistics() const { return episode; }
+	const Engine::EpisodeStatistics& getLastEpisodeStatistics() const { return lastEpisode; }
+
+	/* Engine::FunctionRunSequence of the simulator being run. */
+	static int __cdecl runSequence(
+		const Engine::SimulationState* state,
+		const double* forces,
+		int k,
+		Engine::SimulationState* trajectory
+	);
+
+	/* Engine::FunctionEvaluateSequences of the simulator being run. */
+	static int __cdecl evaluateSequences(
+		const Engine::SimulationState* state,
+		const double* forces,
+		int m,
+		int k,
+		const Engine::QuadraticCost* cost,
+		double* costs
+	);
+
+	/* Engine::FunctionOptimizeSequence of the simulator being run. */
+	static int __cdecl optimizeSequence(
+		const Engine::SimulationState* state,
+		double* forces,
+		int k,
+		const Engine::QuadraticCost* cost,
+		const Engine::OptimizerSettings* settings,
+		double* result
+	);
+	
+protected:
+	/* One tile of the mosaic: its terrain is recorded again only when the
+	   engine hands over a different crater list or a new version of it. */
+	struct MosaicView {
+		const Engine::Crater* craters = nullptr;
+		unsigned int cratersVersion = 0;
+		Terrain terrain;
+		DisplayList scenery;
+		bool valid = false;
+	};
+
+	static const char helpText[];
+	static Simulator* active;
+	Terrain terrain;
+	DisplayList scenery;
+	std::vector<double> batchAngles;
+	std::vector<DrawingDevice::Point> batchVertices;
+	std::vector<Engine::MosaicTile> mosaicTiles;
+	std::vector<MosaicView> mosaic;
+	std::vector<int> mosaicPending;
+	Cart mosaicCart;
+	bool priorityUpdate;
+	bool terminate;
+	bool frozen;
+	Cart cart;
+	bool engineActionsSuppressed;
+	double simulationTime;
+	double manualAction;
+	double lastAction;
+	Engine::EpisodeStatistics episode;
+	Engine::EpisodeStatistics lastEpisode;
+	/* The physical parameters sampled for the episode, and those of the
+	   cart: the simulator parameters with the sampled ones in place of the
+	   randomised quantities, so that the changes the engine makes to the
+	   others take effect during the episode. */
+	PhysicalParameters episodeParameters;
+	PhysicalParameters cartParameters;
+	bool showInfo;
+	bool showLog;
+	bool showHelp;
+	bool showCameraFrame;
+	bool showBatch;
+	bool showMosaic;
+	double cameraX;
+	double cameraY;
+	double cameraZoom;
+	double previousCameraX;
+	double previousCameraY;
+	double previousCameraZoom;
+	bool updateCamera;
+	double interpolation;
+	/* The frames of a recording, which may span several episodes, released
+	   when the recording is finished. */
+	Arena recordingArena;
+	Recording* recording;
+	FlightRecorder* flightRecorder;
+	Policy* policy;
+	DrawingDevice* frameDrawingDevice;
+	Cart* frameCart;
+	LogStore log;
+	LogStore help;
+	CheckpointWriter checkpoint;
+	std::vector<char> engineState;
+	double checkpointTime;
+	int recordingNumber;
+	/* The recording, the frame count and the frames file of the checkpoint
+	   last saved or loaded. */
+	int checkpointRecording;
+	int checkpointFrames;
+	std::string checkpointFramesFile;
+
+private:
+	void processRecording();
+	PhysicalParameters getCartParameters() const;
+	Engine::TerminationReason checkTermination(double dt) const;
+	void endEpisode(Engine::TerminationReason reason);
+	void paintScenery(DrawingDevice* drawingDevice);
+	void paintBatch(DrawingDevice* drawingDevice);
+	void paintMosaic(DrawingDevice* drawingDevice);
+	void prepareMosaic();
+	static void recordScenery(DisplayList& scenery, const Terrain& terrain);
+	static std::string getFramesFile(const char* fileName, int slot);
+	static int readFramesSlot(const char* fileName);
 };
\ No newline at end of file
@@ -0,0 +1,403 @@
+#include <math.h>
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include "sweep.h"
+#include "simulator.h"
+#include "philox.h"
+
+const char* const Sweep::parameterNames[PARAMETER_COUNT] = {
+	"cart.mass",
+	"cart.damping",
+	"pole.mass",
+	"pole.size",
+	"pole.damping",
+	"gravity",
+	"actionFrequency"
+};
+
+Sweep::Sweep() :
+	episodes(10),
+	samples(0),
+	seed(1),
+	maxTime(0),
+	angleLimit(0),
+	positionLimit(0)
+{
+}
+
+Sweep::~Sweep()
+{
+}
+
+/* The specification is a text file with one setting per line ('#' starts a comment):
+     <parameter> <value> [<value> ...]   the values of a parameter (see parameterNames)
+     terrain <name> [<x> <width> <depth> ...]   a terrain made of craters ("flat" if none)
+     episodes <count>                    episodes per configuration
+     samples <count>                     random search instead of the grid
+     seed <seed>                         seed of the random search
+     maxTime, angleLimit, positionLimit   termination rules replacing the engine's
+   On the grid, every combination of the values and terrains is run. In the
+   random search, a parameter with two values is sampled uniformly between
+   them; otherwise one of its values is picked. */
+bool Sweep::load(const char* fileName, std::string& error)
+{
+	std::ifstream file(fileName);
+	if (!file) {
+		error = std::string("Cannot open ") + fileName;
+		return false;
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.erase(comment);
+
+		std::istringstream stream(line);
+		std::string key;
+		if (!(stream >> key))
+			continue;
+
+		bool valid = true;
+		int parameter = 0;
+		while (parameter < PARAMETER_COUNT && key != parameterNames[parameter])
+			parameter++;
+
+		if (parameter < PARAMETER_COUNT) {
+			double value;
+			while (stream >> value)
+				values[parameter].push_back(value);
+			valid = !values[parameter].empty();
+		}
+		else if (key == "terrain") {
+			TerrainOption terrain;
+			valid = static_cast<bool>(stream >> terrain.name);
+			Engine::Crater crater;
+			while (stream >> crater.x >> crater.width >> crater.depth)
+				terrain.craters.push_back(crater);
+			terrain.craters.push_back({ 0, 0, 0 });
+			terrains.push_back(terrain);
+		}
+		else if (key == "episodes")
+			valid = static_cast<bool>(stream >> episodes) && episodes > 0;
+		else if (key == "samples")
+			valid = static_cast<bool>(stream >> samples) && samples >= 0;
+		else if (key == "seed")
+			valid = static_cast<bool>(stream >> seed);
+		else if (key == "maxTime")
+			valid = static_cast<bool>(stream >> maxTime);
+		else if (key == "angleLimit")
+			valid = static_cast<bool>(stream >> angleLimit);
+		else if (key == "positionLimit")
+			valid = static_cast<bool>(stream >> positionLimit);
+		else
+			valid = false;
+
+		if (!valid) {
+			error = std::string(fileName) + "(" + std::to_string(lineNumber) + "): invalid setting \"" + key + "\"";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int Sweep::getConfigurationCount() const
+{
+	if (samples > 0)
+		return samples;
+
+	int count = (terrains.empty() ? 1 : static_cast<int>(terrains.size()));
+	for (int parameter = 0; parameter < PARAMETER_COUNT; parameter++) {
+		if (!values[parameter].empty())
+			count *= static_cast<int>(values[parameter].size());
+	}
+	return count;
+}
+
+Sweep::Configuration Sweep::getConfiguration(int index) const
+{
+	Configuration configuration;
+	configuration.index = index;
+	configuration.terrain = -1;
+
+	/* The random search takes a block of the generator per parameter, so that
+	   every configuration can be made on its own in any of the workers. */
+	int rest = index;
+	for (int parameter = 0; parameter < PARAMETER_COUNT; parameter++) {
+		const std::vector<double>& list = values[parameter];
+		int count = static_cast<int>(list.size());
+		configuration.swept[parameter] = (count > 0);
+		configuration.values[parameter] = 0;
+		if (count == 0)
+			continue;
+
+		if (samples > 0) {
+			Philox::Block block = Philox::generate(parameter, static_cast<uint32_t>(index), 0, 0, seed);
+			double u = Philox::toUniform(block.v[0], block.v[1]);
+			if (count == 2)
+				configuration.values[parameter] = list[0] + (list[1] - list[0]) * u;
+			else
+				configuration.values[parameter] = list[static_cast<int>(u * count)];
+		}
+		else {
+			configuration.values[parameter] = list[rest % count];
+			rest /= count;
+		}
+	}
+
+	if (!terrains.empty()) {
+		int count = static_cast<int>(terrains.size());
+		if (samples > 0) {
+			Philox::Block block = Philox::generate(PARAMETER_COUNT, static_cast<uint32_t>(index), 0, 0, seed);
+			configuration.terrain = static_cast<int>(Philox::toUniform(block.v[0], block.v[1]) * count);
+		}
+		else {
+			configuration.terrain = rest % count;
+		}
+	}
+
+	return configuration;
+}
+
+std::string Sweep::getHeader()
+{
+	std::string header = "configuration";
+	for (int parameter = 0; parameter < PARAMETER_COUNT; parameter++)
+		header += std::string(";") + parameterNames[parameter];
+	header += ";terrain;episodes;success_rate;mean_length;mean_return;mean_abs_theta\n";
+	return header;
+}
+
+/* Runs one configuration in a worker process. An episode is a success if it
+   reaches the target or lasts until the time limit. */
+Sweep::Result Sweep::run(const Configuration& configuration, const Engine::SimulatorParameters& base) const
+{
+	Engine::SimulatorParameters& parameters = Engine::simulatorParameters;
+	parameters = base;
+	double* targets[PARAMETER_COUNT - 1] = {
+		&parameters.cart.mass,
+		&parameters.cart.damping,
+		&parameters.pole.mass,
+		&parameters.pole.size,
+		&parameters.pole.damping,
+		&parameters.gravity
+	};
+	for (int parameter = 0; parameter < ACTION_FREQUENCY; parameter++) {
+		if (configuration.swept[parameter])
+			*targets[parameter] = configuration.values[parameter];
+	}
+	if (configuration.swept[ACTION_FREQUENCY])
+		parameters.actionFrequency = static_cast<int>(configuration.values[ACTION_FREQUENCY] + 0.5);
+	if (parameters.actionFrequency < 1)
+		parameters.actionFrequency = 1;
+	if (configuration.terrain >= 0)
+		parameters.craters = &terrains[configuration.terrain].craters[0];
+
+	/* No files, and the episodes have to end without the engine's help. */
+	parameters.flightRecorderDuration = 0;
+	parameters.logFilename = nullptr;
+	if (maxTime > 0) parameters.termination.maxEpisodeTime = maxTime;
+	if (angleLimit > 0) parameters.termination.angleLimit = angleLimit;
+	if (positionLimit > 0) parameters.termination.positionLimit = positionLimit;
+	if (parameters.termination.action == Engine::SimulationAction::NO_SIMULATION_ACTION)
+		parameters.termination.action = Engine::SimulationAction::RESET_SIMULATION;
+	if (parameters.termination.maxEpisodeTime <= 0)
+		parameters.termination.maxEpisodeTime = 60;
+
+	Result result = {};
+	Simulator simulator;
+	double dt = 1.0 / parameters.actionFrequency;
+	int lastEpisode = 0;
+	while (result.episodes < episodes && !simulator.wantsToTerminate()) {
+		simulator.tick(dt);
+
+		Engine::SimulationState state;
+		simulator.getState(state);
+		result.absThetaSum += fabs(state.theta);
+		result.ticks++;
+
+		const Engine::EpisodeStatistics& statistics = simulator.getLastEpisodeStatistics();
+		if (statistics.number != lastEpisode) {
+			lastEpisode = statistics.number;
+			result.episodes++;
+			result.lengthSum += statistics.length;
+			result.returnSum += statistics.episodeReturn;
+			if (statistics.reason == Engine::TerminationReason::TARGET_REACHED ||
+				statistics.reason == Engine::TerminationReason::TIME_LIMIT)
+				result.successes++;
+		}
+
+		/* Keep the log channel from overflowing. */
+		if (result.ticks % 1000 == 0)
+			simulator.updateLog();
+	}
+
+	return result;
+}
+
+std::string Sweep::format(const Configuration& configuration, const Result& result) const
+{
+	const Engine::SimulatorParameters& parameters = Engine::simulatorParameters;
+	const char* terrain = (configuration.terrain >= 0 ? terrains[configuration.terrain].name.c_str() : "engine");
+	int episodeCount = (result.episodes > 0 ? result.episodes : 1);
+	long long tickCount = (result.ticks > 0 ? result.ticks : 1);
+
+	char line[512];
+	snprintf(line, sizeof(line), "%d;%g;%g;%g;%g;%g;%g;%d;%s;%d;%g;%g;%g;%g\n",
+		configuration.index,
+		parameters.cart.mass,
+		parameters.cart.damping,
+		parameters.pole.mass,
+		parameters.pole.size,
+		parameters.pole.damping,
+		parameters.gravity,
+		parameters.actionFrequency,
+		terrain,
+		result.episodes,
+		static_cast<double>(result.successes) / episodeCount,
+		static_cast<double>(result.lengthSum) / episodeCount,
+		result.returnSum / episodeCount,
+		result.absThetaSum / tickCount
+	);
+	return line;
+}
+
+/* Runs every workers-th configuration and writes the results to the standard
+   output, which the main process reads through a pipe. */
+bool Sweep::runWorker(int worker, int workers)
+{
+	if (workers <= 0 || worker < 0 || worker >= workers)
+		return false;
+
+	const Engine::SimulatorParameters base = Engine::simulatorParameters;
+	HANDLE output = GetStdHandle(STD_OUTPUT_HANDLE);
+	int count = getConfigurationCount();
+	for (int index = worker; index < count; index += workers) {
+		Configuration configuration = getConfiguration(index);
+		Result result = run(configuration, base);
+		std::string line = format(configuration, result);
+		DWORD bytesWritten;
+		WriteFile(output, line.c_str(), static_cast<DWORD>(line.length()), &bytesWritten, nullptr);
+	}
+	Engine::simulatorParameters = base;
+	return true;
+}
+
+bool Sweep::runWorkers(int workers, const char* outputFile, int argc, char** argv, std::string& error)
+{
+	int count = getConfigurationCount();
+	if (workers <= 0)
+		workers = static_cast<int>(std::thread::hardware_concurrency());
+	if (workers > count)
+		workers = count;
+	if (workers < 1)
+		workers = 1;
+
+	/* Report the progress in the console the sweep was started from. */
+	if (AttachConsole(ATTACH_PARENT_PROCESS) || AllocConsole()) {
+		FILE* console;
+		freopen_s(&console, "CONOUT$", "w", stdout);
+	}
+
+	HANDLE file = CreateFileA(outputFile, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		error = std::string("Cannot create ") + outputFile;
+		return false;
+	}
+	std::string header = getHeader();
+	DWORD bytesWritten;
+	WriteFile(file, header.c_str(), static_cast<DWORD>(header.length()), &bytesWritten, nullptr);
+
+	/* The workers get the same arguments, preceded by their share. */
+	char executable[MAX_PATH];
+	GetModuleFileNameA(nullptr, executable, MAX_PATH);
+	std::string arguments;
+	for (int i = 1; i < argc; i++)
+		arguments += std::string(" \"") + argv[i] + "\"";
+
+	std::vector<HANDLE> processes;
+	std::vector<HANDLE> pipes;
+	for (int worker = 0; worker < workers; worker++) {
+		SECURITY_ATTRIBUTES attributes = { sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+		HANDLE readPipe;
+		HANDLE writePipe;
+		if (!CreatePipe(&readPipe, &writePipe, &attributes, 0))
+			break;
+		SetHandleInformation(readPipe, HANDLE_FLAG_INHERIT, 0);
+
+		std::string commandLine = std::string("\"") + executable + "\" -sweep-worker " +
+			std::to_string(worker) + " " + std::to_string(workers) + arguments;
+		STARTUPINFOA startupInfo = {};
+		startupInfo.cb = sizeof(startupInfo);
+		startupInfo.dwFlags = STARTF_USESTDHANDLES;
+		startupInfo.hStdInput = INVALID_HANDLE_VALUE;
+		startupInfo.hStdOutput = writePipe;
+		startupInfo.hStdError = INVALID_HANDLE_VALUE;
+		PROCESS_INFORMATION processInformation;
+		BOOL created = CreateProcessA(nullptr, &commandLine[0], nullptr, nullptr, TRUE,
+			CREATE_NO_WINDOW, nullptr, nullptr, &startupInfo, &processInformation);
+
+		/* Only the worker keeps the writing end, so that the pipe breaks when it exits. */
+		CloseHandle(writePipe);
+		if (!created) {
+			CloseHandle(readPipe);
+			break;
+		}
+		CloseHandle(processInformation.hThread);
+		processes.push_back(processInformation.hProcess);
+		pipes.push_back(readPipe);
+	}
+
+	/* Every finished configuration goes to the file as soon as it arrives. */
+	std::mutex fileMutex;
+	int finished = 0;
+	std::vector<std::thread> readers;
+	for (HANDLE pipe : pipes) {
+		readers.emplace_back([pipe, file, count, &fileMutex, &finished]() {
+			std::string pending;
+			char buffer[4096];
+			DWORD bytesRead;
+			while (ReadFile(pipe, buffer, sizeof(buffer), &bytesRead, nullptr) && bytesRead > 0) {
+				pending.append(buffer, bytesRead);
+				size_t end;
+				while ((end = pending.find('\n')) != std::string::npos) {
+					std::lock_guard<std::mutex> lock(fileMutex);
+					DWORD bytesWritten;
+					WriteFile(file, pending.c_str(), static_cast<DWORD>(end + 1), &bytesWritten, nullptr);
+					finished++;
+					printf("\r%d / %d configurations", finished, count);
+					fflush(stdout);
+					pending.erase(0, end + 1);
+				}
+			}
+		});
+	}
+
+	bool succeeded = (static_cast<int>(processes.size()) == workers);
+	for (std::thread& reader : readers)
+		reader.join();
+	for (HANDLE process : processes) {
+		WaitForSingleObject(process, INFINITE);
+		DWORD exitCode = 0;
+		if (!GetExitCodeProcess(process, &exitCode) || exitCode != 0)
+			succeeded = false;
+		CloseHandle(process);
+	}
+	for (HANDLE pipe : pipes)
+		CloseHandle(pipe);
+	CloseHandle(file);
+	printf("\n");
+
+	if (!succeeded || finished < count) {
+		error = "The sweep did not finish: " + std::to_string(finished) + " of " +
+			std::to_string(count) + " configurations in " + outputFile;
+		return false;
+	}
+	return true;
+}
\ No newline at end of file
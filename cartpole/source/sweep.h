@@ -0,0 +1,75 @@
+#pragma once
+#include <Windows.h>
+#include <string>
+#include <vector>
+#include "engine.h"
+
+/* Runs the loaded engine over a grid or a random sample of simulation
+   parameters and reports one line of aggregated statistics per configuration.
+   The engines keep their state in globals, so the configurations are split
+   among worker processes instead of threads; every worker loads the engine
+   once and runs its share of the configurations without a window. */
+class Sweep
+{
+public:
+	enum Parameter {
+		CART_MASS = 0,
+		CART_DAMPING = 1,
+		POLE_MASS = 2,
+		POLE_SIZE = 3,
+		POLE_DAMPING = 4,
+		GRAVITY = 5,
+		ACTION_FREQUENCY = 6,
+		PARAMETER_COUNT = 7
+	};
+
+	/* The parameters that are not swept keep the values set by the engine,
+	   as does the terrain if the index is negative. */
+	struct Configuration {
+		int index;
+		bool swept[PARAMETER_COUNT];
+		double values[PARAMETER_COUNT];
+		int terrain;
+	};
+
+	Sweep();
+	~Sweep();
+
+	bool load(const char* fileName, std::string& error);
+	int getConfigurationCount() const;
+	Configuration getConfiguration(int index) const;
+	bool runWorkers(int workers, const char* outputFile, int argc, char** argv, std::string& error);
+
+	/* Returns false, without running anything, unless 0 <= worker < workers. */
+	bool runWorker(int worker, int workers);
+
+protected:
+	struct Result {
+		int episodes;
+		int successes;
+		long long ticks;
+		long long lengthSum;
+		double returnSum;
+		double absThetaSum;
+	};
+
+	struct TerrainOption {
+		std::string name;
+		std::vector<Engine::Crater> craters;
+	};
+
+	std::vector<double> values[PARAMETER_COUNT];
+	std::vector<TerrainOption> terrains;
+	int episodes;
+	int samples;
+	unsigned long long seed;
+	double maxTime;
+	double angleLimit;
+	double positionLimit;
+
+private:
+	static const char* const parameterNames[PARAMETER_COUNT];
+	static std::string getHeader();
+	Result run(const Configuration& configuration, const Engine::SimulatorParameters& base) const;
+	std::string format(const Configuration& configuration, const Result& result) const;
+};
\ No newline at end of file
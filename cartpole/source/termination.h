@@ -0,0 +1,42 @@
+#pragma once
+#include <math.h>
+#include "engine.h"
+
+/* The termination rules of Engine::TerminationRules, shared by the simulator
+   and the batches. */
+class Termination
+{
+public:
+	static Engine::TerminationReason check(
+		const Engine::TerminationRules& rules,
+		double x,
+		double theta,
+		double time,
+		double dt
+	);
+};
+
+inline Engine::TerminationReason Termination::check(
+	const Engine::TerminationRules& rules,
+	double x,
+	double theta,
+	double time,
+	double dt
+) {
+	if (rules.action == Engine::SimulationAction::NO_SIMULATION_ACTION)
+		return Engine::TerminationReason::NOT_TERMINATED;
+
+	/* A fallen pole or a cart out of bounds is a failure even in the target. */
+	if (rules.angleLimit > 0 && fabs(theta) > rules.angleLimit)
+		return Engine::TerminationReason::ANGLE_LIMIT;
+	if (rules.positionLimit > 0 && fabs(x) > rules.positionLimit)
+		return Engine::TerminationReason::POSITION_LIMIT;
+	if (rules.targetWidth > 0 && fabs(x - rules.targetX) <= rules.targetWidth / 2)
+		return Engine::TerminationReason::TARGET_REACHED;
+
+	/* The time is a sum of the ticks; half a tick absorbs the rounding. */
+	if (rules.maxEpisodeTime > 0 && time > rules.maxEpisodeTime - dt / 2)
+		return Engine::TerminationReason::TIME_LIMIT;
+
+	return Engine::TerminationReason::NOT_TERMINATED;
+}
\ No newline at end of file
@@ -0,0 +1,447 @@
+#include <algorithm>
+#include <cmath>
+#include "terrain.h"
+
+Terrain::Terrain()
+{
+}
+
+Terrain::~Terrain()
+{
+}
+
+void Terrain::compute(const Engine::Crater* craters)
+{
+	floor.clear();
+	spans.clear();
+	floor.push_back(Bezier(Point(), Point(-100, -11)));
+	floor.push_back(Bezier(Point(-100, 0), Point(-100, 0)));
+	
+	double min = -100, max = 100;
+	if (craters != nullptr) {
+		const Engine::Crater* pCrater = craters;
+		while (pCrater->width > 0) {
+			double left = pCrater->x - pCrater->width / 2;
+			double right = pCrater->x + pCrater->width / 2;
+			bool valid =
+				left >= min &&
+				right <= max &&
+				pCrater->width >= 6 * std::abs(pCrater->depth) &&
+				std::abs(pCrater->depth) < 10;
+			if (valid) {
+				floor.push_back(
+					Bezier(
+						Point(left, 0),
+						Point(left, 0)
+					)
+				);
+				floor.push_back(
+					Bezier(
+						Point(left + 0.1 * pCrater->width, 0),
+						Point(left + 0.25 * pCrater->width, -pCrater->depth / 2)
+					)
+				);
+				floor.push_back(
+					Bezier(
+						Point(left + 0.4 * pCrater->width, -pCrater->depth),
+						Point(left + 0.5 * pCrater->width, -pCrater->depth)
+					)
+				);
+				floor.push_back(
+					Bezier(
+						Point(right - 0.4 * pCrater->width, -pCrater->depth),
+						Point(right - 0.25 * pCrater->width, -pCrater->depth / 2)
+					)
+				);
+				floor.push_back(
+					Bezier(
+						Point(right - 0.1 * pCrater->width, 0),
+						Point(right, 0)
+					)
+				);
+				spans.push_back({ left, right });
+				min = right;
+			}
+			pCrater++;
+		}
+	}
+	
+	floor.push_back(Bezier(Point(100, 0), Point(100, 0)));
+	floor.push_back(Bezier(Point(100, -11), Point(100, -11)));
+
+	/* A bucket of the index starts the search half a bucket to its left, so
+	   that the rounding of x never skips a segment. With 8 buckets per
+	   segment the search rarely has to step to the next one, which the
+	   bisections of the alignment would mispredict. */
+	size_t buckets = std::max<size_t>(1024, 8 * floor.size());
+	indexScale = buckets / 200.0;
+	index.resize(buckets);
+	size_t segment = 1;
+	for (size_t bucket = 0; bucket < buckets; bucket++) {
+		double left = -100 + (bucket - 0.5) / indexScale;
+		while (segment < floor.size() - 1 && floor[segment].end.x < left)
+			segment++;
+		index[bucket] = static_cast<int>(segment);
+	}
+	spanIndex.resize(buckets);
+	size_t span = 0;
+	for (size_t bucket = 0; bucket < buckets; bucket++) {
+		double left = -100 + (bucket - 0.5) / indexScale;
+		while (span < spans.size() && spans[span].right < left)
+			span++;
+		spanIndex[bucket] = static_cast<int>(span);
+	}
+
+	curves.resize(floor.size());
+	for (size_t i = 1; i < floor.size(); i++) {
+		const Point& point = floor[i - 1].end;
+		const Bezier& bezier = floor[i];
+		Curve& curve = curves[i];
+		curve.a = point.x - 2 * bezier.control.x + bezier.end.x;
+		curve.b = 2 * bezier.control.x - 2 * point.x;
+		curve.x0 = point.x;
+		curve.y0 = point.y;
+		curve.controlY = bezier.control.y;
+		curve.endY = bezier.end.y;
+	}
+}
+
+void Terrain::align(CartPhysics& cart) const
+{
+	align(cart.x, cart.getWheelDistance(), cart.y, cart.phi);
+}
+
+void Terrain::align(double x, double wheelDistance, double& y, double& phi) const
+{
+	/* Both wheels on the flat floor: the search below would give exactly 0. */
+	if (isFlatAround(x, wheelDistance / 2)) {
+		y = 0;
+		phi = 0;
+		return;
+	}
+
+	double y0 = getFloorHeight(x);
+	double ycorrection = 0;
+	phi = computeCartAngle(x, y0, wheelDistance / 2, 0.01, ycorrection);
+	y = y0 + ycorrection;
+}
+
+void Terrain::alignLanes(int count, const double* x, double wheelDistance, double* y, double* phi) const
+{
+	/* The carts on the flat floor are done at once; the others are gathered
+	   into full groups. */
+	double r = wheelDistance / 2;
+	int lanes[groupSize];
+	int pending = 0;
+	for (int lane = 0; lane < count; lane++) {
+		if (isFlatAround(x[lane], r)) {
+			y[lane] = 0;
+			phi[lane] = 0;
+			continue;
+		}
+		lanes[pending++] = lane;
+		if (pending == groupSize) {
+			alignGroup(lanes, pending, x, r, y, phi);
+			pending = 0;
+		}
+	}
+	if (pending > 0)
+		alignGroup(lanes, pending, x, r, y, phi);
+}
+
+#ifdef PHYSICS_SSE
+__m128d Terrain::getFloorHeights(__m128d x) const
+{
+	/* The roots of computeBezierY side by side; a point that getFloorHeight
+	   would take past its first segment gets the height from it instead. */
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d one = _mm_set1_pd(1.0);
+	const __m128d two = _mm_set1_pd(2.0);
+	double points[2];
+	_mm_storeu_pd(points, x);
+	size_t low = findSegment(points[0]);
+	size_t high = findSegment(points[1]);
+	const Curve& first = curves[low];
+	const Curve& second = curves[high];
+	__m128d a = _mm_set_pd(second.a, first.a);
+	__m128d b = _mm_set_pd(second.b, first.b);
+	__m128d c = _mm_sub_pd(_mm_set_pd(second.x0, first.x0), x);
+	__m128d d = _mm_sqrt_pd(_mm_sub_pd(_mm_mul_pd(b, b), _mm_mul_pd(_mm_mul_pd(_mm_set1_pd(4.0), a), c)));
+	__m128d nb = _mm_xor_pd(b, _mm_set1_pd(-0.0));
+	__m128d a2 = _mm_mul_pd(two, a);
+	__m128d t1 = _mm_div_pd(_mm_add_pd(nb, d), a2);
+	__m128d t2 = _mm_div_pd(_mm_sub_pd(nb, d), a2);
+	__m128d valid1 = _mm_and_pd(_mm_cmpge_pd(t1, zero), _mm_cmple_pd(t1, one));
+	__m128d valid2 = _mm_and_pd(_mm_cmpge_pd(t2, zero), _mm_cmple_pd(t2, one));
+	__m128d t = _mm_or_pd(_mm_and_pd(valid1, t1), _mm_andnot_pd(valid1, t2));
+	__m128d u = _mm_sub_pd(one, t);
+	__m128d y = _mm_add_pd(
+		_mm_add_pd(
+			_mm_mul_pd(_mm_mul_pd(u, u), _mm_set_pd(second.y0, first.y0)),
+			_mm_mul_pd(_mm_mul_pd(_mm_mul_pd(two, u), t), _mm_set_pd(second.controlY, first.controlY))),
+		_mm_mul_pd(_mm_mul_pd(t, t), _mm_set_pd(second.endY, first.endY)));
+
+	bool exact =
+		!(low > 1 && points[0] - floor[low - 1].end.x < 1e-9) &&
+		!(high > 1 && points[1] - floor[high - 1].end.x < 1e-9) &&
+		_mm_movemask_pd(_mm_or_pd(valid1, valid2)) == 3;
+	if (!exact)
+		y = _mm_set_pd(getFloorHeight(points[1]), getFloorHeight(points[0]));
+	return y;
+}
+#endif
+
+void Terrain::alignGroup(const int* lanes, int count, const double* x, double r, double* y, double* phi) const
+{
+	/* The searches of computeCartAngle, a front and a rear one per cart.
+	   Every search takes a step in every round; one that has converged
+	   keeps its values, as if it had stopped, so that a cart gets the same
+	   points as alone. */
+#ifdef PHYSICS_SSE
+	/* The front search of a cart is low in its registers, the rear one
+	   high. */
+	const double epsilon = 0.01;
+	const __m128d half = _mm_set1_pd(0.5);
+	const __m128d radius = _mm_set1_pd(r);
+	const __m128d tolerance = _mm_set1_pd(epsilon);
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d sign = _mm_set1_pd(-0.0);
+	__m128d x0[groupSize];
+	__m128d y0[groupSize];
+	__m128d minimum[groupSize];
+	__m128d maximum[groupSize];
+	__m128d error[groupSize];
+	__m128d xs[groupSize];
+	__m128d ys[groupSize];
+	for (int i = 0; i < count; i += 2) {
+		double left = x[lanes[i]];
+		double right = (i + 1 < count ? x[lanes[i + 1]] : left);
+		__m128d heights = getFloorHeights(_mm_set_pd(right, left));
+		y0[i] = _mm_unpacklo_pd(heights, heights);
+		y0[i + 1] = _mm_unpackhi_pd(heights, heights);
+	}
+	for (int i = 0; i < count; i++) {
+		double center = x[lanes[i]];
+		x0[i] = _mm_set1_pd(center);
+		minimum[i] = x0[i];
+		maximum[i] = _mm_set_pd(center - r, center + r);
+		error[i] = _mm_set1_pd(epsilon + 1);
+		xs[i] = zero;
+		ys[i] = zero;
+	}
+
+	/* A round finds the heights of all the carts before it compares the
+	   distances, so that the square roots and the divisions of different
+	   carts overlap. */
+	bool searching = true;
+	while (searching) {
+		__m128d xp[groupSize];
+		__m128d yp[groupSize];
+		for (int i = 0; i < count; i++) {
+			xp[i] = _mm_mul_pd(_mm_add_pd(minimum[i], maximum[i]), half);
+			yp[i] = getFloorHeights(xp[i]);
+		}
+
+		searching = false;
+		for (int i = 0; i < count; i++) {
+			__m128d active = _mm_cmpgt_pd(error[i], tolerance);
+			__m128d xr = _mm_sub_pd(xp[i], x0[i]);
+			__m128d yr = _mm_sub_pd(yp[i], y0[i]);
+			__m128d dist = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(xr, xr), _mm_mul_pd(yr, yr)));
+			__m128d distError = _mm_andnot_pd(sign, _mm_sub_pd(dist, radius));
+			__m128d closer = _mm_and_pd(active, _mm_cmplt_pd(dist, radius));
+			__m128d farther = _mm_and_pd(active, _mm_cmpgt_pd(dist, radius));
+			xs[i] = _mm_or_pd(_mm_and_pd(active, xp[i]), _mm_andnot_pd(active, xs[i]));
+			ys[i] = _mm_or_pd(_mm_and_pd(active, yp[i]), _mm_andnot_pd(active, ys[i]));
+			error[i] = _mm_or_pd(_mm_and_pd(active, distError), _mm_andnot_pd(active, error[i]));
+			minimum[i] = _mm_or_pd(_mm_and_pd(closer, xp[i]), _mm_andnot_pd(closer, minimum[i]));
+			maximum[i] = _mm_or_pd(_mm_and_pd(farther, xp[i]), _mm_andnot_pd(farther, maximum[i]));
+			searching = searching || _mm_movemask_pd(_mm_cmpgt_pd(error[i], tolerance)) != 0;
+		}
+	}
+
+	for (int i = 0; i < count; i++) {
+		double points[4];
+		_mm_storeu_pd(points, xs[i]);
+		_mm_storeu_pd(points + 2, ys[i]);
+		double height = _mm_cvtsd_f64(y0[i]);
+		phi[lanes[i]] = atan2(points[2] - points[3], points[0] - points[1]);
+		y[lanes[i]] = height + ((points[2] + points[3]) / 2 - height);
+	}
+#else
+	/* The front search of a cart is at 2 * i, the rear one at 2 * i + 1. */
+	const double epsilon = 0.01;
+	const int searches = 2 * count;
+	double x0[2 * groupSize];
+	double y0[2 * groupSize];
+	double minimum[2 * groupSize];
+	double maximum[2 * groupSize];
+	double error[2 * groupSize];
+	double xs[2 * groupSize];
+	double ys[2 * groupSize];
+	for (int i = 0; i < count; i++) {
+		double center = x[lanes[i]];
+		double height = getFloorHeight(center);
+		for (int side = 0; side < 2; side++) {
+			int search = 2 * i + side;
+			x0[search] = center;
+			y0[search] = height;
+			minimum[search] = center;
+			maximum[search] = (side == 0 ? center + r : center - r);
+			error[search] = epsilon + 1;
+			xs[search] = 0;
+			ys[search] = 0;
+		}
+	}
+
+	bool searching = true;
+	while (searching) {
+		searching = false;
+		for (int search = 0; search < searches; search++) {
+			double xp = (minimum[search] + maximum[search]) / 2;
+			double yp = getFloorHeight(xp);
+			double xr = xp - x0[search];
+			double yr = yp - y0[search];
+			double dist = sqrt(xr * xr + yr * yr);
+			bool active = error[search] > epsilon;
+			xs[search] = (active ? xp : xs[search]);
+			ys[search] = (active ? yp : ys[search]);
+			error[search] = (active ? fabs(dist - r) : error[search]);
+			minimum[search] = (active && dist < r ? xp : minimum[search]);
+			maximum[search] = (active && dist > r ? xp : maximum[search]);
+			searching = searching || error[search] > epsilon;
+		}
+	}
+
+	for (int i = 0; i < count; i++) {
+		int front = 2 * i;
+		int rear = 2 * i + 1;
+		phi[lanes[i]] = atan2(ys[front] - ys[rear], xs[front] - xs[rear]);
+		y[lanes[i]] = y0[front] + ((ys[front] + ys[rear]) / 2 - y0[front]);
+	}
+#endif
+}
+
+double Terrain::computeCartAngle(double x, double r, double epsilon, double& ycorrection) const
+{
+	return computeCartAngle(x, getFloorHeight(x), r, epsilon, ycorrection);
+}
+
+double Terrain::computeCartAngle(double x0, double y0, double r, double epsilon, double& ycorrection) const
+{
+	/* Find the front and the rear point, where the wheels touch the floor at
+	   the distance r from the central point (x0, y0). The two searches do not
+	   depend on each other, so they are interleaved to overlap their latency. */
+	double x1 = 0;
+	double y1 = 0;
+	double min1 = x0;
+	double max1 = x0 + r;
+	double error1 = epsilon + 1;
+	double x2 = 0;
+	double y2 = 0;
+	double min2 = x0;
+	double max2 = x0 - r;
+	double error2 = epsilon + 1;
+	while (error1 > epsilon || error2 > epsilon) {
+		if (error1 > epsilon) {
+			x1 = (min1 + max1) / 2;
+			y1 = getFloorHeight(x1);
+			double xr = x1 - x0;
+			double yr = y1 - y0;
+			double dist = sqrt(xr * xr + yr * yr);
+			error1 = fabs(dist - r);
+			if (dist < r) min1 = x1;
+			else if (dist > r) max1 = x1;
+		}
+		if (error2 > epsilon) {
+			x2 = (min2 + max2) / 2;
+			y2 = getFloorHeight(x2);
+			double xr = x2 - x0;
+			double yr = y2 - y0;
+			double dist = sqrt(xr * xr + yr * yr);
+			error2 = fabs(dist - r);
+			if (dist < r) min2 = x2;
+			else if (dist > r) max2 = x2;
+		}
+	}
+
+	/* Compute the angle. */
+	double angle = atan2(y1 - y2, x1 - x2);
+
+	/* Compute correction of y, so the wheels touch the floor. */
+	ycorrection = (y1 + y2) / 2 - y0;
+
+	/* Return the angle. */
+	return angle;
+}
+
+size_t Terrain::findSegment(double x) const
+{
+	double position = (x + 100) * indexScale;
+	size_t bucket = 0;
+	if (position >= index.size())
+		bucket = index.size() - 1;
+	else if (position > 0)
+		bucket = static_cast<size_t>(position);
+
+	size_t segment = index[bucket];
+	while (segment < floor.size() - 1 && floor[segment].end.x < x)
+		segment++;
+	return segment;
+}
+
+bool Terrain::isFlatAround(double x, double r) const
+{
+	if (x - r <= -100 || x + r >= 100)
+		return false;
+
+	if (spans.empty())
+		return true;
+
+	/* The first crater that does not end left of the interval. */
+	double left = x - r;
+	double position = (left + 100) * indexScale;
+	size_t span = spanIndex[position > 0 ? static_cast<size_t>(position) : 0];
+	while (span < spans.size() && spans[span].right < left)
+		span++;
+	return (span == spans.size() || spans[span].left > x + r);
+}
+
+double Terrain::getFloorHeight(double x) const
+{
+	/* The segments are ordered by x: skip those that end left of x. The one
+	   before is tried too if x is (within rounding) on its end point. */
+	size_t first = findSegment(x);
+	if (first > 1 && x - floor[first - 1].end.x < 1e-9)
+		first--;
+
+	double y = 0;
+	for (size_t i = first; i < floor.size() - 1; i++) {
+		int result = computeBezierY(floor[i - 1].end, floor[i], x, y);
+		if (result == 0) return y;
+	}
+	return 0;
+}
+
+int Terrain::computeBezierY(const Point& point, const Bezier& bezier, double x, double& y)
+{
+	double a = point.x - 2 * bezier.control.x + bezier.end.x;
+	double b = 2 * bezier.control.x - 2 * point.x;
+	double c = point.x - x;
+
+	double d = b * b - 4 * a * c;
+	if (d < 0) return -1;
+	d = sqrt(d);
+
+	/* The second root is needed only if the first one is off the segment. */
+	double t = (-1 * b + d) / (2 * a);
+	if (!(t >= 0 && t <= 1)) {
+		t = (-1 * b - d) / (2 * a);
+		if (!(t >= 0 && t <= 1)) return -1;
+	}
+
+	double u = 1 - t;
+	y = u * u * point.y + 2 * u * t * bezier.control.y + t * t * bezier.end.y;
+
+	return 0;
+}
\ No newline at end of file
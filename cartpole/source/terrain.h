@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include "engine.h"
+#include "geometry.h"
+#include "physics.h"
+
+/* The floor between -100 and 100 m: flat, except for the craters, which are
+   shaped by quadratic Bezier segments. */
+class Terrain
+{
+public:
+	Terrain();
+	~Terrain();
+
+	const std::vector<Bezier>& getFloor() const { return floor; }
+	bool isFlat() const { return spans.empty(); }
+	bool isFlatAround(double x, double r) const;
+	void compute(const Engine::Crater* craters);
+	void align(CartPhysics& cart) const;
+	void align(double x, double wheelDistance, double& y, double& phi) const;
+
+	/* align for count carts, one value per cart in every array; gives
+	   exactly what align gives. The searches of several carts go side by
+	   side without branches on their outcome, so that their latencies
+	   overlap instead of adding up. */
+	void alignLanes(int count, const double* x, double wheelDistance, double* y, double* phi) const;
+	double computeCartAngle(double x, double r, double epsilon, double& ycorrection) const;
+	double getFloorHeight(double x) const;
+	static int computeBezierY(const Point& point, const Bezier& bezier, double x, double& y);
+
+protected:
+	/* The stretches of the floor taken by the craters, from left to right. */
+	struct Span {
+		double left;
+		double right;
+	};
+
+	std::vector<Bezier> floor;
+	std::vector<Span> spans;
+
+	/* The first segment to try for x in every bucket of the floor's width. */
+	std::vector<int> index;
+	double indexScale;
+
+	/* The first span to try for x in every bucket, likewise. */
+	std::vector<int> spanIndex;
+
+	/* The terms of computeBezierY that depend on the segment alone, for
+	   every segment with the end of the one before: x = a t^2 + b t + x0. */
+	struct Curve {
+		double a;
+		double b;
+		double x0;
+		double y0;
+		double controlY;
+		double endY;
+	};
+	std::vector<Curve> curves;
+
+	/* The carts aligned side by side by alignLanes. */
+	static const int groupSize = 8;
+
+	size_t findSegment(double x) const;
+#ifdef PHYSICS_SSE
+	/* getFloorHeight for the two values of x. */
+	__m128d getFloorHeights(__m128d x) const;
+#endif
+	void alignGroup(const int* lanes, int count, const double* x, double r, double* y, double* phi) const;
+	double computeCartAngle(double x0, double y0, double r, double epsilon, double& ycorrection) const;
+};
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include <math.h>
+#include <string.h>
+#include "trajectoryoptimizer.h"
+
+/* Bounds of the regularisation of the force curvature. */
+static const double minMu = 1e-6;
+static const double maxMu = 1e10;
+
+/* Step sizes tried by the line search: 1, 1/2, ... 1/128. */
+static const int lineSearchSteps = 8;
+
+static double wrapAngle(double angle)
+{
+	return angle - CartPhysics::doublePi * floor(angle / CartPhysics::doublePi + 0.5);
+}
+
+/* The state (x, dx, theta, dtheta) less the target, with the angle wrapped. */
+static void stateError(const Engine::SimulationState& state, const double* target, double* e)
+{
+	e[0] = state.x - target[0];
+	e[1] = state.dx - target[1];
+	e[2] = wrapAngle(state.theta - target[2]);
+	e[3] = state.dtheta - target[3];
+}
+
+/* Adds the gradient (M + M') e and the Hessian M + M' of e'Me. */
+static void addStateCost(const double* matrix, const double* e, double* Vx, double* Vxx)
+{
+	for (int row = 0; row < 4; row++) {
+		for (int column = 0; column < 4; column++) {
+			double m = matrix[row * 4 + column] + matrix[column * 4 + row];
+			Vx[row] += m * e[column];
+			Vxx[row * 4 + column] += m;
+		}
+	}
+}
+
+TrajectoryOptimizer::TrajectoryOptimizer(const Terrain& terrain, double cartSize, double dt) :
+	rollout(terrain, cartSize, dt),
+	dt(dt)
+{
+}
+
+TrajectoryOptimizer::~TrajectoryOptimizer()
+{
+}
+
+int TrajectoryOptimizer::optimize(
+	const PhysicalParameters& parameters,
+	const Engine::SimulationState& state,
+	double* forces,
+	int k,
+	const Engine::QuadraticCost& cost,
+	const Engine::OptimizerSettings& settings,
+	double* result
+) {
+	if (k <= 0)
+		return 0;
+
+	states.resize(k + 1);
+	candidateStates.resize(k + 1);
+	candidateForces.resize(k);
+	models.resize(k);
+	feedforward.resize(k);
+	feedback.resize(4 * k);
+
+	double forceLimit = settings.forceLimit;
+	if (forceLimit > 0) {
+		for (int i = 0; i < k; i++)
+			forces[i] = (forces[i] > forceLimit ? forceLimit : (forces[i] < -forceLimit ? -forceLimit : forces[i]));
+	}
+
+	states[0] = state;
+	candidateStates[0] = state;
+	double total = simulate(parameters, forces, k, cost);
+
+	double mu = minMu;
+	bool linearized = false;
+	int iterations = 0;
+	while (iterations < settings.iterations) {
+		iterations++;
+
+		if (!linearized) {
+			for (int i = 0; i < k; i++)
+				linearize(parameters, states[i], forces[i], models[i]);
+			linearized = true;
+		}
+
+		double linear = 0;
+		double quadratic = 0;
+		if (!backward(forces, k, cost, forceLimit, mu, linear, quadratic)) {
+			mu *= 10;
+			if (mu > maxMu)
+				break;
+			continue;
+		}
+
+		/* The line search stops as soon as the quadratic model predicts an
+		   improvement below the tolerance for the step. */
+		double alpha = 1;
+		double candidate = total;
+		bool converged = false;
+		for (int n = 0; n < lineSearchSteps; n++) {
+			double predicted = -alpha * (linear + alpha * quadratic);
+			if (predicted <= settings.tolerance * total) {
+				converged = true;
+				break;
+			}
+			candidate = simulate(parameters, forces, k, cost, alpha, forceLimit);
+			if (candidate < total)
+				break;
+			alpha *= 0.5;
+		}
+
+		if (converged)
+			break;
+		if (candidate < total) {
+			double improvement = total - candidate;
+			states.swap(candidateStates);
+			memcpy(forces, &candidateForces[0], k * sizeof(double));
+			total = candidate;
+			linearized = false;
+			mu = (mu / 10 > minMu ? mu / 10 : minMu);
+			if (improvement <= settings.tolerance * total)
+				break;
+		}
+		else {
+			mu *= 10;
+			if (mu > maxMu)
+				break;
+		}
+	}
+
+	if (result != nullptr)
+		*result = total;
+
+	return iterations;
+}
+
+double TrajectoryOptimizer::simulate(
+	const PhysicalParameters& parameters,
+	const double* forces,
+	int k,
+	const Engine::QuadraticCost& cost
+) {
+	Engine::SimulationState state = states[0];
+	double total = 0;
+	for (int i = 0; i < k; i++) {
+		rollout.run(parameters, state, &forces[i], 1, nullptr);
+		states[i + 1] = state;
+		total += Rollout::evaluateCost(cost.Q, cost.target, state.x, state.dx, state.theta, state.dtheta);
+		total += cost.R * forces[i] * forces[i];
+	}
+	total += Rollout::evaluateCost(cost.Qf, cost.target, state.x, state.dx, state.theta, state.dtheta);
+
+	return total;
+}
+
+double TrajectoryOptimizer::simulate(
+	const PhysicalParameters& parameters,
+	const double* forces,
+	int k,
+	const Engine::QuadraticCost& cost,
+	double alpha,
+	double forceLimit
+) {
+	/* The forces of the plan, corrected by the feedback on the deviation
+	   from its states. */
+	Engine::SimulationState state = states[0];
+	double total = 0;
+	for (int i = 0; i < k; i++) {
+		const Engine::SimulationState& nominal = states[i];
+		const double* K = &feedback[4 * i];
+		double F = forces[i] + alpha * feedforward[i];
+		F += K[0] * (state.x - nominal.x);
+		F += K[1] * (state.dx - nominal.dx);
+		F += K[2] * wrapAngle(state.theta - nominal.theta);
+		F += K[3] * (state.dtheta - nominal.dtheta);
+		if (forceLimit > 0)
+			F = (F > forceLimit ? forceLimit : (F < -forceLimit ? -forceLimit : F));
+
+		candidateForces[i] = F;
+		rollout.run(parameters, state, &F, 1, nullptr);
+		candidateStates[i + 1] = state;
+		total += Rollout::evaluateCost(cost.Q, cost.target, state.x, state.dx, state.theta, state.dtheta);
+		total += cost.R * F * F;
+	}
+	total += Rollout::evaluateCost(cost.Qf, cost.target, state.x, state.dx, state.theta, state.dtheta);
+
+	return total;
+}
+
+bool TrajectoryOptimizer::backward(
+	const double* forces,
+	int k,
+	const Engine::QuadraticCost& cost,
+	double forceLimit,
+	double mu,
+	double& linear,
+	double& quadratic
+) {
+	/* The value function V(state) = Vx'd + d'Vxx d / 2 near the plan, from
+	   the last state backwards. The last state costs both Q and Qf. */
+	double Vx[4] = {};
+	double Vxx[16] = {};
+	double e[4];
+	stateError(states[k], cost.target, e);
+	addStateCost(cost.Q, e, Vx, Vxx);
+	addStateCost(cost.Qf, e, Vx, Vxx);
+
+	linear = 0;
+	quadratic = 0;
+	for (int i = k - 1; i >= 0; i--) {
+		const double* A = models[i].A;
+		const double* B = models[i].B;
+		double u = forces[i];
+
+		/* The products run along the rows, which the compiler vectorises. */
+		double VA[16] = {};
+		double VB[4] = {};
+		for (int row = 0; row < 4; row++) {
+			for (int j = 0; j < 4; j++) {
+				double v = Vxx[row * 4 + j];
+				for (int column = 0; column < 4; column++)
+					VA[row * 4 + column] += v * A[j * 4 + column];
+				VB[row] += v * B[j];
+			}
+		}
+
+		double Qx[4] = {};
+		double Qux[4] = {};
+		double Qxx[16] = {};
+		double Qu = 2 * cost.R * u;
+		double Quu = 2 * cost.R;
+		for (int row = 0; row < 4; row++) {
+			Qu += B[row] * Vx[row];
+			Quu += B[row] * VB[row];
+			for (int column = 0; column < 4; column++) {
+				Qx[column] += A[row * 4 + column] * Vx[row];
+				Qux[column] += VB[row] * A[row * 4 + column];
+			}
+			for (int other = 0; other < 4; other++) {
+				double a = A[row * 4 + other];
+				for (int column = 0; column < 4; column++)
+					Qxx[other * 4 + column] += a * VA[row * 4 + column];
+			}
+		}
+
+		double regularized = Quu + mu;
+		if (regularized <= 0)
+			return false;
+
+		/* The force is a scalar, so the bounded problem is solved by clamping:
+		   a force held at the limit gets no feedback. */
+		double* K = &feedback[4 * i];
+		double ff = -Qu / regularized;
+		for (int column = 0; column < 4; column++)
+			K[column] = -Qux[column] / regularized;
+		if (forceLimit > 0 && (u + ff > forceLimit || u + ff < -forceLimit)) {
+			ff = (u + ff > forceLimit ? forceLimit : -forceLimit) - u;
+			for (int column = 0; column < 4; column++)
+				K[column] = 0;
+		}
+		feedforward[i] = ff;
+		linear += ff * Qu;
+		quadratic += 0.5 * ff * ff * Quu;
+
+		for (int row = 0; row < 4; row++) {
+			Vx[row] = Qx[row] + K[row] * Quu * ff + K[row] * Qu + Qux[row] * ff;
+			for (int column = 0; column < 4; column++)
+				Vxx[row * 4 + column] = Qxx[row * 4 + column] + K[row] * Quu * K[column] + K[row] * Qux[column] + Qux[row] * K[column];
+		}
+		for (int row = 0; row < 4; row++) {
+			for (int column = row + 1; column < 4; column++) {
+				double mean = 0.5 * (Vxx[row * 4 + column] + Vxx[column * 4 + row]);
+				Vxx[row * 4 + column] = mean;
+				Vxx[column * 4 + row] = mean;
+			}
+		}
+
+		/* The cost of the state reached by the previous tick; the start
+		   state is given and costs nothing. */
+		if (i > 0) {
+			stateError(states[i], cost.target, e);
+			addStateCost(cost.Q, e, Vx, Vxx);
+		}
+	}
+
+	return true;
+}
+
+void TrajectoryOptimizer::linearize(const PhysicalParameters& parameters, const Engine::SimulationState& state, double F, Linearization& model) const
+{
+	CartPhysics::linearize(parameters, F, dt, state.phi, state.theta, state.dtheta, model.A, model.B);
+}
\ No newline at end of file
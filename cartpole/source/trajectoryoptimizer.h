@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+#include "engine.h"
+#include "physics.h"
+#include "rollout.h"
+
+/* Optimises the forces of one cart over a horizon with iLQR (iterative LQR,
+   the first-order variant of DDP) on the dynamics of the simulation. The
+   sequences are simulated with a Rollout, so the terrain and the bounds are
+   taken into account; the linearisation holds the slope of the floor fixed
+   over a tick. The forces given are the initial guess, so a controller that
+   shifts its previous plan by one tick converges in a few iterations. */
+class TrajectoryOptimizer
+{
+public:
+	TrajectoryOptimizer() = delete;
+	TrajectoryOptimizer(const Terrain& terrain, double cartSize, double dt);
+	~TrajectoryOptimizer();
+
+	/* Improves the k forces in place and returns the number of iterations;
+	   the cost of the optimised forces is written to the result (may be
+	   nullptr). */
+	int optimize(
+		const PhysicalParameters& parameters,
+		const Engine::SimulationState& state,
+		double* forces,
+		int k,
+		const Engine::QuadraticCost& cost,
+		const Engine::OptimizerSettings& settings,
+		double* result
+	);
+
+protected:
+	/* The linear model of one tick: next = A state + B force, for the state
+	   (x, dx, theta, dtheta). */
+	struct Linearization {
+		double A[16];
+		double B[4];
+	};
+
+	Rollout rollout;
+	double dt;
+	std::vector<Engine::SimulationState> states;
+	std::vector<Engine::SimulationState> candidateStates;
+	std::vector<double> candidateForces;
+	std::vector<Linearization> models;
+	std::vector<double> feedforward;
+	std::vector<double> feedback;
+
+	double simulate(
+		const PhysicalParameters& parameters,
+		const double* forces,
+		int k,
+		const Engine::QuadraticCost& cost
+	);
+	double simulate(
+		const PhysicalParameters& parameters,
+		const double* forces,
+		int k,
+		const Engine::QuadraticCost& cost,
+		double alpha,
+		double forceLimit
+	);
+	bool backward(
+		const double* forces,
+		int k,
+		const Engine::QuadraticCost& cost,
+		double forceLimit,
+		double mu,
+		double& linear,
+		double& quadratic
+	);
+	void linearize(const PhysicalParameters& parameters, const Engine::SimulationState& state, double F, Linearization& model) const;
+};
\ No newline at end of file
@@ -0,0 +1,457 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "transitiontable.h"
+#include "rollout.h"
+#include "terrain.h"
+
+static_assert(sizeof(TransitionTable::Entry) == 20, "the entries of the file are 20 bytes");
+
+static const char* const axisNames[4] = { "x", "dx", "theta", "dtheta" };
+
+/* Cells computed by a thread at a time. */
+static const uint32_t chunkSize = 4096;
+
+TransitionTable::MappedFile::MappedFile() :
+	data(nullptr),
+	size(0),
+#ifdef _WIN32
+	file(INVALID_HANDLE_VALUE),
+	mapping(nullptr)
+#else
+	file(-1)
+#endif
+{
+}
+
+TransitionTable::MappedFile::~MappedFile()
+{
+	close();
+}
+
+#ifdef _WIN32
+bool TransitionTable::MappedFile::create(const char* fileName, uint64_t size)
+{
+	close();
+	file = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	/* The mapping extends the file to its size. */
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+	if (mapping != nullptr)
+		data = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, static_cast<size_t>(size)));
+	if (data == nullptr) {
+		close();
+		return false;
+	}
+	this->size = size;
+	return true;
+}
+
+bool TransitionTable::MappedFile::open(const char* fileName)
+{
+	close();
+	file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	LARGE_INTEGER length;
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+		close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping != nullptr)
+		data = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (data == nullptr) {
+		close();
+		return false;
+	}
+	size = static_cast<uint64_t>(length.QuadPart);
+	return true;
+}
+
+void TransitionTable::MappedFile::close()
+{
+	if (data != nullptr)
+		UnmapViewOfFile(data);
+	if (mapping != nullptr)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+	data = nullptr;
+	mapping = nullptr;
+	file = INVALID_HANDLE_VALUE;
+	size = 0;
+}
+#else
+bool TransitionTable::MappedFile::create(const char* fileName, uint64_t size)
+{
+	close();
+	file = ::open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (file < 0 || ftruncate(file, static_cast<off_t>(size)) != 0) {
+		close();
+		return false;
+	}
+
+	void* address = mmap(nullptr, static_cast<size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	if (address == MAP_FAILED) {
+		close();
+		return false;
+	}
+	data = static_cast<char*>(address);
+	this->size = size;
+	return true;
+}
+
+bool TransitionTable::MappedFile::open(const char* fileName)
+{
+	close();
+	file = ::open(fileName, O_RDONLY);
+	struct stat status;
+	if (file < 0 || fstat(file, &status) != 0 || status.st_size == 0) {
+		close();
+		return false;
+	}
+
+	void* address = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+	if (address == MAP_FAILED) {
+		close();
+		return false;
+	}
+	data = static_cast<char*>(address);
+	size = static_cast<uint64_t>(status.st_size);
+	return true;
+}
+
+void TransitionTable::MappedFile::close()
+{
+	if (data != nullptr)
+		munmap(data, static_cast<size_t>(size));
+	if (file >= 0)
+		::close(file);
+	data = nullptr;
+	file = -1;
+	size = 0;
+}
+#endif
+
+TransitionTable::TransitionTable() :
+	entries(nullptr),
+	forces(nullptr),
+	cells(0),
+	actions(0),
+	dt(0)
+{
+}
+
+TransitionTable::~TransitionTable()
+{
+}
+
+bool TransitionTable::loadGrid(const char* fileName, Grid& grid, std::string& error)
+{
+	std::ifstream file(fileName);
+	if (!file) {
+		error = std::string("Cannot open ") + fileName;
+		return false;
+	}
+
+	bool given[4] = {};
+	grid.forces.clear();
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.erase(comment);
+
+		std::istringstream stream(line);
+		std::string key;
+		if (!(stream >> key))
+			continue;
+
+		bool valid = true;
+		int axis = 0;
+		while (axis < 4 && key != axisNames[axis])
+			axis++;
+
+		if (axis < 4) {
+			Axis& value = grid.axes[axis];
+			valid = static_cast<bool>(stream >> value.min >> value.max >> value.count);
+			given[axis] = valid;
+		}
+		else if (key == "forces") {
+			double force;
+			while (stream >> force)
+				grid.forces.push_back(force);
+			valid = !grid.forces.empty();
+		}
+		else
+			valid = false;
+
+		if (!valid) {
+			error = std::string(fileName) + "(" + std::to_string(lineNumber) + "): invalid setting \"" + key + "\"";
+			return false;
+		}
+	}
+
+	for (int axis = 0; axis < 4; axis++) {
+		if (!given[axis]) {
+			error = std::string(fileName) + ": the axis " + axisNames[axis] + " is missing";
+			return false;
+		}
+	}
+	if (grid.forces.empty()) {
+		error = std::string(fileName) + ": the forces are missing";
+		return false;
+	}
+
+	return true;
+}
+
+uint64_t TransitionTable::getEntriesOffset(int actions)
+{
+	/* The entries start on a cache line. */
+	uint64_t offset = sizeof(Header) + static_cast<uint64_t>(actions) * sizeof(double);
+	return (offset + 63) / 64 * 64;
+}
+
+bool TransitionTable::build(
+	const Engine::SimulatorParameters& simulatorParameters,
+	const Grid& grid,
+	int threads,
+	const char* fileName,
+	std::string& error
+) {
+	uint64_t cellCount = 1;
+	for (int axis = 0; axis < 4; axis++) {
+		const Axis& value = grid.axes[axis];
+		if (value.count < 2 || !(value.max > value.min)) {
+			error = std::string("invalid axis ") + axisNames[axis];
+			return false;
+		}
+		cellCount *= static_cast<uint64_t>(value.count);
+	}
+	if (cellCount >= outside) {
+		error = "too many cells";
+		return false;
+	}
+	if (grid.forces.empty()) {
+		error = "no forces";
+		return false;
+	}
+	if (simulatorParameters.actionFrequency <= 0) {
+		error = "invalid action frequency";
+		return false;
+	}
+
+	Header header = {};
+	header.version = version;
+	header.actions = static_cast<uint32_t>(grid.forces.size());
+	for (int axis = 0; axis < 4; axis++) {
+		header.counts[axis] = static_cast<uint32_t>(grid.axes[axis].count);
+		header.minimum[axis] = grid.axes[axis].min;
+		header.maximum[axis] = grid.axes[axis].max;
+	}
+	header.dt = 1.0 / simulatorParameters.actionFrequency;
+	header.cartSize = simulatorParameters.cart.size;
+	header.physics.cartMass = simulatorParameters.cart.mass;
+	header.physics.cartDamping = simulatorParameters.cart.damping;
+	header.physics.poleMass = simulatorParameters.pole.mass;
+	header.physics.poleLength = simulatorParameters.pole.size;
+	header.physics.poleDamping = simulatorParameters.pole.damping;
+	header.physics.gravity = simulatorParameters.gravity;
+	header.entries = getEntriesOffset(header.actions);
+
+	/* The table is built next to the file, as a checkpoint is written, so
+	   that the mappings of the table in the file are not truncated under
+	   their readers. */
+	std::string temporaryName = std::string(fileName) + ".tmp";
+	uint64_t size = header.entries + cellCount * header.actions * sizeof(Entry);
+	MappedFile output;
+	if (!output.create(temporaryName.c_str(), size)) {
+		error = std::string("Cannot write ") + temporaryName;
+		return false;
+	}
+	memcpy(output.getData() + sizeof(Header), grid.forces.data(), grid.forces.size() * sizeof(double));
+
+	/* The table reads the header it is built for, so that the cells of the
+	   next states are the ones of a lookup. */
+	TransitionTable table;
+	table.cells = static_cast<uint32_t>(cellCount);
+	table.actions = static_cast<int>(header.actions);
+	table.forces = grid.forces.data();
+	table.dt = header.dt;
+	for (int axis = 0; axis < 4; axis++) {
+		table.counts[axis] = grid.axes[axis].count;
+		table.minimum[axis] = grid.axes[axis].min;
+		table.step[axis] = (grid.axes[axis].max - grid.axes[axis].min) / (grid.axes[axis].count - 1);
+	}
+
+	Terrain terrain;
+	terrain.compute(simulatorParameters.craters);
+	Rollout rollout(terrain, header.cartSize, header.dt);
+	double wheelDistance = 3 * header.cartSize / 5;
+	Entry* out = reinterpret_cast<Entry*>(output.getData() + header.entries);
+
+	/* The threads take chunks of cells as they go. */
+	std::atomic<uint64_t> next(0);
+	auto work = [&]() {
+		for (;;) {
+			uint64_t start = next.fetch_add(chunkSize);
+			if (start >= table.cells)
+				break;
+			uint32_t first = static_cast<uint32_t>(start);
+			uint32_t last = (table.cells - first < chunkSize ? table.cells : first + chunkSize);
+			for (uint32_t cell = first; cell < last; cell++) {
+				double point[4];
+				table.getState(cell, point);
+
+				Engine::SimulationState origin = {};
+				origin.x = point[0];
+				origin.dx = point[1];
+				origin.theta = point[2];
+				origin.dtheta = point[3];
+				if (!terrain.isFlat())
+					terrain.align(origin.x, wheelDistance, origin.y, origin.phi);
+
+				for (int action = 0; action < table.actions; action++) {
+					Engine::SimulationState state = origin;
+					rollout.run(header.physics, state, &table.forces[action], 1, nullptr);
+
+					double reached[4] = { state.x, state.dx, state.theta, state.dtheta };
+					Entry& entry = out[static_cast<size_t>(cell) * table.actions + action];
+					for (int i = 0; i < 4; i++)
+						entry.next[i] = static_cast<float>(reached[i]);
+					entry.cell = table.getCell(reached);
+				}
+			}
+		}
+	};
+
+	if (threads <= 0)
+		threads = static_cast<int>(std::thread::hardware_concurrency());
+	if (threads < 1)
+		threads = 1;
+	std::vector<std::thread> workers;
+	for (int t = 1; t < threads; t++)
+		workers.push_back(std::thread(work));
+	work();
+	for (std::thread& worker : workers)
+		worker.join();
+
+	/* The header goes last, so that an interrupted build leaves no valid table. */
+	header.magic = magic;
+	memcpy(output.getData(), &header, sizeof(Header));
+	output.close();
+
+#ifdef _WIN32
+	bool moved = MoveFileExA(temporaryName.c_str(), fileName, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	bool moved = rename(temporaryName.c_str(), fileName) == 0;
+#endif
+	if (!moved) {
+		error = std::string("Cannot replace ") + fileName;
+		return false;
+	}
+	return true;
+}
+
+bool TransitionTable::open(const char* fileName, std::string& error)
+{
+	close();
+	if (!mapped.open(fileName)) {
+		error = std::string("Cannot open ") + fileName;
+		return false;
+	}
+
+	Header header;
+	bool valid = mapped.getSize() >= sizeof(Header);
+	if (valid) {
+		memcpy(&header, mapped.getData(), sizeof(Header));
+		valid = header.magic == magic && header.version == version;
+	}
+	if (!valid) {
+		error = std::string(fileName) + ": not a transition table of version " + std::to_string(version);
+		mapped.close();
+		return false;
+	}
+
+	uint64_t cellCount = 1;
+	for (int axis = 0; axis < 4; axis++) {
+		valid = valid && header.counts[axis] >= 2 && header.maximum[axis] > header.minimum[axis];
+		cellCount *= header.counts[axis];
+	}
+	valid = valid && cellCount < outside && header.actions > 0 && header.entries == getEntriesOffset(header.actions);
+	valid = valid && mapped.getSize() == header.entries + cellCount * header.actions * sizeof(Entry);
+	if (!valid) {
+		error = std::string(fileName) + ": the table is damaged";
+		mapped.close();
+		return false;
+	}
+
+	cells = static_cast<uint32_t>(cellCount);
+	actions = static_cast<int>(header.actions);
+	dt = header.dt;
+	for (int axis = 0; axis < 4; axis++) {
+		counts[axis] = static_cast<int>(header.counts[axis]);
+		minimum[axis] = header.minimum[axis];
+		step[axis] = (header.maximum[axis] - header.minimum[axis]) / (counts[axis] - 1);
+	}
+	forces = reinterpret_cast<const double*>(mapped.getData() + sizeof(Header));
+	entries = reinterpret_cast<const Entry*>(mapped.getData() + header.entries);
+
+	return true;
+}
+
+void TransitionTable::close()
+{
+	mapped.close();
+	entries = nullptr;
+	forces = nullptr;
+	cells = 0;
+	actions = 0;
+}
+
+TransitionTable::Axis TransitionTable::getAxis(int axis) const
+{
+	Axis result;
+	result.min = minimum[axis];
+	result.max = minimum[axis] + step[axis] * (counts[axis] - 1);
+	result.count = counts[axis];
+	return result;
+}
+
+uint32_t TransitionTable::getCell(const double* state) const
+{
+	/* The cells are ordered with x the slowest and dtheta the fastest. */
+	uint32_t cell = 0;
+	for (int axis = 0; axis < 4; axis++) {
+		double index = floor((state[axis] - minimum[axis]) / step[axis] + 0.5);
+		if (!(index >= 0 && index < counts[axis]))
+			return outside;
+		cell = cell * counts[axis] + static_cast<uint32_t>(index);
+	}
+	return cell;
+}
+
+void TransitionTable::getState(uint32_t cell, double* state) const
+{
+	for (int axis = 3; axis >= 0; axis--) {
+		uint32_t index = cell % counts[axis];
+		cell /= counts[axis];
+		state[axis] = minimum[axis] + index * step[axis];
+	}
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "engine.h"
+#include "physics.h"
+
+/* The transitions of the cart tabulated on a grid of the state (x, dx,
+   theta, dtheta) for a set of forces, for tabular methods (e.g. value
+   iteration) that look up the next state millions of times. Every entry is
+   one action period of the simulator physics and terrain, from the grid
+   point with the cart aligned on the floor. The table is built straight into
+   a file next to the table and moved over it when complete, and read through
+   a read-only mapping of it, so that a lookup is a single read and the
+   processes that open the same file share its pages. */
+class TransitionTable
+{
+public:
+	static const uint32_t magic = 0x54545043;   // "CPTT"
+	static const uint32_t version = 1;
+
+	/* The cell of a state off the grid. */
+	static const uint32_t outside = 0xFFFFFFFF;
+
+	/* count points from min to max, both included (count >= 2). */
+	struct Axis {
+		double min;
+		double max;
+		int count;
+	};
+
+	/* The axes x, dx, theta and dtheta, and the forces of the actions. */
+	struct Grid {
+		Axis axes[4];
+		std::vector<double> forces;
+	};
+
+	/* The state after one action period and the cell nearest to it. */
+	struct Entry {
+		float next[4];
+		uint32_t cell;
+	};
+
+	TransitionTable();
+	~TransitionTable();
+
+	/* The grid is a text file with one setting per line ('#' starts a comment):
+	     x|dx|theta|dtheta <min> <max> <count>   an axis of the grid
+	     forces <force> [<force> ...]            the actions */
+	static bool loadGrid(const char* fileName, Grid& grid, std::string& error);
+
+	/* Computes every transition of the grid with the physics, the terrain and
+	   the action frequency of the parameters on the given number of threads
+	   (0 for one per core) and writes the table to the file. A table already
+	   in the file is replaced only once the new one is complete; the
+	   processes that have it open keep reading the old one. */
+	static bool build(
+		const Engine::SimulatorParameters& simulatorParameters,
+		const Grid& grid,
+		int threads,
+		const char* fileName,
+		std::string& error
+	);
+
+	bool open(const char* fileName, std::string& error);
+	void close();
+	bool isOpen() const { return entries != nullptr; }
+
+	uint32_t getCellCount() const { return cells; }
+	int getActionCount() const { return actions; }
+	Axis getAxis(int axis) const;
+	double getForce(int action) const { return forces[action]; }
+	double getDt() const { return dt; }
+
+	/* The cell nearest to the state (x, dx, theta, dtheta), or outside. */
+	uint32_t getCell(const double* state) const;
+
+	/* The grid point of a cell. */
+	void getState(uint32_t cell, double* state) const;
+
+	const Entry& lookup(uint32_t cell, int action) const { return entries[static_cast<size_t>(cell) * actions + action]; }
+
+	/* All the entries, cell by cell, with the actions of a cell side by side. */
+	const Entry* getEntries() const { return entries; }
+
+protected:
+	struct Header {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t counts[4];
+		uint32_t actions;
+		uint32_t reserved;
+		double minimum[4];
+		double maximum[4];
+		double dt;
+		double cartSize;
+		PhysicalParameters physics;
+		uint64_t entries;
+	};
+
+	/* A file mapped into memory, read-only or for writing. */
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		bool create(const char* fileName, uint64_t size);
+		bool open(const char* fileName);
+		void close();
+		char* getData() const { return data; }
+		uint64_t getSize() const { return size; }
+
+	private:
+		char* data;
+		uint64_t size;
+#ifdef _WIN32
+		HANDLE file;
+		HANDLE mapping;
+#else
+		int file;
+#endif
+	};
+
+	MappedFile mapped;
+	const Entry* entries;
+	const double* forces;
+	uint32_t cells;
+	int actions;
+	int counts[4];
+	double minimum[4];
+	double step[4];
+	double dt;
+
+	static uint64_t getEntriesOffset(int actions);
+};
\ No newline at end of file
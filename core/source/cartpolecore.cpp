@@ -0,0 +1,530 @@
+#include "cartpolecore.h"
+#include "batchsimulator.h"
+#include "episodebatch.h"
+#include "framestream.h"
+#include "policy.h"
+#include "rolloutbuffer.h"
+#include "transitiontable.h"
+
+struct cp_env {
+	BatchSimulator batch;
+
+	cp_env(int count, const Engine::SimulatorParameters& simulatorParameters) :
+		batch(count, simulatorParameters)
+	{
+	}
+};
+
+struct cp_policy {
+	Policy policy;
+};
+
+struct cp_table {
+	TransitionTable table;
+};
+
+struct cp_episodes {
+	EpisodeBatch batch;
+
+	cp_episodes(int count, const Engine::SimulatorParameters& simulatorParameters) :
+		batch(count, simulatorParameters)
+	{
+	}
+};
+
+struct cp_buffer {
+	RolloutBuffer buffer;
+
+	cp_buffer(int steps, int count) :
+		buffer(steps, count)
+	{
+	}
+};
+
+struct cp_frames {
+	FrameStream stream;
+
+	cp_frames(int batchRows) :
+		stream(batchRows)
+	{
+	}
+};
+
+static Engine::Distribution toDistribution(const cp_distribution& distribution)
+{
+	Engine::Distribution result;
+	result.type = static_cast<Engine::DistributionType>(distribution.type);
+	result.a = distribution.a;
+	result.b = distribution.b;
+	return result;
+}
+
+void cp_default_config(cp_config* config)
+{
+	Engine::SimulatorParameters simulatorParameters;
+	Engine::InitSimulatorParameters(&simulatorParameters);
+
+	*config = {};
+	config->num_envs = 1;
+	config->action_frequency = simulatorParameters.actionFrequency;
+	config->gravity = simulatorParameters.gravity;
+	config->cart_size = simulatorParameters.cart.size;
+	config->cart_mass = simulatorParameters.cart.mass;
+	config->cart_damping = simulatorParameters.cart.damping;
+	config->pole_size = simulatorParameters.pole.size;
+	config->pole_mass = simulatorParameters.pole.mass;
+	config->pole_damping = simulatorParameters.pole.damping;
+	config->craters = nullptr;
+	config->angle_limit = 12 * 3.14159265358979323846 / 180;
+	config->position_limit = 2.4;
+	config->max_episode_time = 10.0;
+	config->target_x = 0;
+	config->target_width = 0;
+	config->step_reward = simulatorParameters.termination.stepReward;
+	config->target_reward = 0;
+	config->seed = simulatorParameters.randomization.seed;
+	config->stream = 0;
+}
+
+/* The parameters of the simulator for the configuration; false if it is
+   invalid. The craters are referenced, not copied. */
+static bool toSimulatorParameters(const cp_config* config, Engine::SimulatorParameters& simulatorParameters)
+{
+	if (config == nullptr || config->action_frequency <= 0)
+		return false;
+	if (config->cart_size <= 0 || config->cart_mass <= 0 || config->pole_size <= 0 || config->pole_mass < 0)
+		return false;
+	for (int i = 0; i < CP_RANDOM_COUNT; i++) {
+		if (config->random[i].type < CP_FIXED || config->random[i].type > CP_NORMAL)
+			return false;
+	}
+
+	Engine::InitSimulatorParameters(&simulatorParameters);
+	simulatorParameters.actionFrequency = config->action_frequency;
+	simulatorParameters.gravity = config->gravity;
+	simulatorParameters.cart = { config->cart_size, config->cart_mass, config->cart_damping };
+	simulatorParameters.pole = { config->pole_size, config->pole_mass, config->pole_damping };
+
+	/* The craters of the C API have the layout of Engine::Crater. */
+	static_assert(sizeof(cp_crater) == sizeof(Engine::Crater), "cp_crater must match Engine::Crater");
+	simulatorParameters.craters = reinterpret_cast<const Engine::Crater*>(config->craters);
+
+	Engine::TerminationRules& termination = simulatorParameters.termination;
+	termination.angleLimit = config->angle_limit;
+	termination.positionLimit = config->position_limit;
+	termination.maxEpisodeTime = config->max_episode_time;
+	termination.targetX = config->target_x;
+	termination.targetWidth = config->target_width;
+	termination.stepReward = config->step_reward;
+	termination.targetReward = config->target_reward;
+	termination.action = Engine::SimulationAction::RESET_SIMULATION;
+
+	Engine::Randomization& randomization = simulatorParameters.randomization;
+	randomization.seed = config->seed;
+	randomization.stream = config->stream;
+	randomization.cartMass = toDistribution(config->random[CP_RANDOM_CART_MASS]);
+	randomization.cartDamping = toDistribution(config->random[CP_RANDOM_CART_DAMPING]);
+	randomization.poleMass = toDistribution(config->random[CP_RANDOM_POLE_MASS]);
+	randomization.poleSize = toDistribution(config->random[CP_RANDOM_POLE_SIZE]);
+	randomization.poleDamping = toDistribution(config->random[CP_RANDOM_POLE_DAMPING]);
+	randomization.gravity = toDistribution(config->random[CP_RANDOM_GRAVITY]);
+	randomization.x = toDistribution(config->random[CP_RANDOM_X]);
+	randomization.dx = toDistribution(config->random[CP_RANDOM_DX]);
+	randomization.theta = toDistribution(config->random[CP_RANDOM_THETA]);
+	randomization.dtheta = toDistribution(config->random[CP_RANDOM_DTHETA]);
+	return true;
+}
+
+cp_env* cp_create(const cp_config* config)
+{
+	Engine::SimulatorParameters simulatorParameters;
+	if (config == nullptr || config->num_envs <= 0 || !toSimulatorParameters(config, simulatorParameters))
+		return nullptr;
+
+	/* No exception may cross the C interface. */
+	try {
+		return new cp_env(config->num_envs, simulatorParameters);
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+void cp_destroy(cp_env* env)
+{
+	delete env;
+}
+
+int cp_num_envs(const cp_env* env)
+{
+	return env->batch.getCount();
+}
+
+static PhysicalParameters toPhysicalParameters(const cp_physics& physics)
+{
+	PhysicalParameters parameters;
+	parameters.cartMass = physics.cart_mass;
+	parameters.cartDamping = physics.cart_damping;
+	parameters.poleMass = physics.pole_mass;
+	parameters.poleLength = physics.pole_size;
+	parameters.poleDamping = physics.pole_damping;
+	parameters.gravity = physics.gravity;
+	return parameters;
+}
+
+int cp_set_physics(cp_env* env, int index, const cp_physics* physics)
+{
+	if (index < 0 || index >= env->batch.getCount() || physics == nullptr)
+		return 0;
+
+	env->batch.setParameters(index, toPhysicalParameters(*physics));
+	return 1;
+}
+
+void cp_reset(cp_env* env, double* observations)
+{
+	env->batch.reset(observations);
+}
+
+void cp_step(cp_env* env, const double* forces, double* observations, double* rewards, uint8_t* dones)
+{
+	env->batch.step(forces, observations, rewards, dones);
+}
+
+void cp_run_sequence(cp_env* env, const double* forces, int k, cp_state* trajectory)
+{
+	/* The states of the C API have the layout of Engine::SimulationState. */
+	static_assert(sizeof(cp_state) == sizeof(Engine::SimulationState), "cp_state must match Engine::SimulationState");
+	env->batch.runSequence(forces, k, reinterpret_cast<Engine::SimulationState*>(trajectory));
+}
+
+int cp_evaluate_sequences(const cp_env* env, int index, const double* forces, int m, int k, const cp_cost* cost, double* costs)
+{
+	if (index < 0 || index >= env->batch.getCount() || m <= 0 || k < 0)
+		return 0;
+	if (forces == nullptr || cost == nullptr || costs == nullptr)
+		return 0;
+
+	/* The costs of the C API have the layout of Engine::QuadraticCost. */
+	static_assert(sizeof(cp_cost) == sizeof(Engine::QuadraticCost), "cp_cost must match Engine::QuadraticCost");
+	env->batch.evaluateSequences(index, forces, m, k, *reinterpret_cast<const Engine::QuadraticCost*>(cost), costs);
+	return 1;
+}
+
+int cp_optimize_sequence(const cp_env* env, int index, double* forces, int k, const cp_cost* cost, const cp_optimizer_settings* settings, double* result)
+{
+	if (index < 0 || index >= env->batch.getCount() || k < 0)
+		return 0;
+	if (forces == nullptr || cost == nullptr || settings == nullptr)
+		return 0;
+
+	Engine::OptimizerSettings optimizerSettings;
+	optimizerSettings.iterations = settings->iterations;
+	optimizerSettings.forceLimit = settings->force_limit;
+	optimizerSettings.tolerance = settings->tolerance;
+	return env->batch.optimizeSequence(index, forces, k, *reinterpret_cast<const Engine::QuadraticCost*>(cost), optimizerSettings, result);
+}
+
+int cp_last_episode(const cp_env* env, int index, cp_episode* episode)
+{
+	if (index < 0 || index >= env->batch.getCount())
+		return 0;
+
+	const Engine::EpisodeStatistics& statistics = env->batch.getLastEpisode(index);
+	if (statistics.length == 0)
+		return 0;
+
+	episode->number = statistics.number;
+	episode->length = statistics.length;
+	episode->time = statistics.time;
+	episode->episode_return = statistics.episodeReturn;
+	episode->done = static_cast<int>(statistics.reason);
+	return 1;
+}
+
+cp_policy* cp_policy_load(const char* file_name)
+{
+	if (file_name == nullptr)
+		return nullptr;
+
+	try {
+		cp_policy* policy = new cp_policy();
+		std::string error;
+		if (!policy->policy.load(file_name, error)) {
+			delete policy;
+			return nullptr;
+		}
+		return policy;
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+void cp_policy_destroy(cp_policy* policy)
+{
+	delete policy;
+}
+
+void cp_policy_forces(const cp_policy* policy, const double* observations, int count, double* forces)
+{
+	policy->policy.evaluate(observations, count, CP_OBS_SIZE, forces);
+}
+
+cp_episodes* cp_episodes_create(const cp_config* config)
+{
+	Engine::SimulatorParameters simulatorParameters;
+	if (config == nullptr || config->num_envs <= 0 || !toSimulatorParameters(config, simulatorParameters))
+		return nullptr;
+
+	try {
+		return new cp_episodes(config->num_envs, simulatorParameters);
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+void cp_episodes_destroy(cp_episodes* episodes)
+{
+	delete episodes;
+}
+
+void cp_episodes_set_compaction(cp_episodes* episodes, double fraction)
+{
+	episodes->batch.setCompaction(fraction);
+}
+
+int cp_episodes_set_physics(cp_episodes* episodes, int index, const cp_physics* physics)
+{
+	if (index < 0 || index >= episodes->batch.getCount() || physics == nullptr)
+		return 0;
+
+	episodes->batch.setParameters(index, toPhysicalParameters(*physics));
+	return 1;
+}
+
+int cp_episodes_start(cp_episodes* episodes, double* observations)
+{
+	return episodes->batch.start(observations);
+}
+
+int cp_episodes_step(cp_episodes* episodes, const double* forces, double* observations, double* rewards, uint8_t* dones)
+{
+	return episodes->batch.step(forces, observations, rewards, dones);
+}
+
+const int* cp_episodes_ids(const cp_episodes* episodes)
+{
+	return episodes->batch.getIds();
+}
+
+int cp_episodes_result(const cp_episodes* episodes, int index, cp_episode* episode)
+{
+	if (index < 0 || index >= episodes->batch.getCount())
+		return 0;
+
+	const Engine::EpisodeStatistics& statistics = episodes->batch.getEpisode(index);
+	if (statistics.number == 0)
+		return 0;
+
+	episode->number = statistics.number;
+	episode->length = statistics.length;
+	episode->time = statistics.time;
+	episode->episode_return = statistics.episodeReturn;
+	episode->done = static_cast<int>(statistics.reason);
+	return 1;
+}
+
+int cp_table_build(const cp_config* config, const cp_table_grid* grid, int threads, const char* file_name)
+{
+	Engine::SimulatorParameters simulatorParameters;
+	if (grid == nullptr || file_name == nullptr || grid->forces == nullptr || grid->num_forces <= 0)
+		return 0;
+	if (!toSimulatorParameters(config, simulatorParameters))
+		return 0;
+
+	try {
+		TransitionTable::Grid tableGrid;
+		for (int axis = 0; axis < 4; axis++)
+			tableGrid.axes[axis] = { grid->min[axis], grid->max[axis], grid->count[axis] };
+		tableGrid.forces.assign(grid->forces, grid->forces + grid->num_forces);
+
+		std::string error;
+		return TransitionTable::build(simulatorParameters, tableGrid, threads, file_name, error) ? 1 : 0;
+	}
+	catch (...) {
+		return 0;
+	}
+}
+
+cp_table* cp_table_open(const char* file_name)
+{
+	if (file_name == nullptr)
+		return nullptr;
+
+	try {
+		cp_table* table = new cp_table();
+		std::string error;
+		if (!table->table.open(file_name, error)) {
+			delete table;
+			return nullptr;
+		}
+		return table;
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+void cp_table_close(cp_table* table)
+{
+	delete table;
+}
+
+uint32_t cp_table_num_cells(const cp_table* table)
+{
+	return table->table.getCellCount();
+}
+
+int cp_table_num_actions(const cp_table* table)
+{
+	return table->table.getActionCount();
+}
+
+uint32_t cp_table_cell(const cp_table* table, const double* state)
+{
+	return table->table.getCell(state);
+}
+
+void cp_table_state(const cp_table* table, uint32_t cell, double* state)
+{
+	table->table.getState(cell, state);
+}
+
+const cp_transition* cp_table_transitions(const cp_table* table)
+{
+	/* The transitions of the C API have the layout of the entries. */
+	static_assert(sizeof(cp_transition) == sizeof(TransitionTable::Entry), "cp_transition must match TransitionTable::Entry");
+	return reinterpret_cast<const cp_transition*>(table->table.getEntries());
+}
+
+uint32_t cp_table_next(const cp_table* table, uint32_t cell, int action)
+{
+	/* Outside, like a cell off the grid, has no transitions. */
+	if (cell >= table->table.getCellCount() || action < 0 || action >= table->table.getActionCount())
+		return CP_TABLE_OUTSIDE;
+	return table->table.lookup(cell, action).cell;
+}
+
+cp_buffer* cp_buffer_create(int steps, int num_envs)
+{
+	if (steps <= 0 || num_envs <= 0)
+		return nullptr;
+
+	try {
+		return new cp_buffer(steps, num_envs);
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+void cp_buffer_destroy(cp_buffer* buffer)
+{
+	delete buffer;
+}
+
+void cp_buffer_clear(cp_buffer* buffer)
+{
+	buffer->buffer.clear();
+}
+
+int cp_buffer_size(const cp_buffer* buffer)
+{
+	return buffer->buffer.getSize();
+}
+
+const double* cp_buffer_observations(const cp_buffer* buffer)
+{
+	return buffer->buffer.getObservations(buffer->buffer.getSize());
+}
+
+double* cp_buffer_actions(cp_buffer* buffer)
+{
+	if (buffer->buffer.isFull())
+		return nullptr;
+	return buffer->buffer.getActions(buffer->buffer.getSize());
+}
+
+int cp_reset_buffer(cp_env* env, cp_buffer* buffer)
+{
+	if (buffer->buffer.getCount() != env->batch.getCount())
+		return 0;
+
+	buffer->buffer.reset(env->batch);
+	return 1;
+}
+
+int cp_step_buffer(cp_env* env, cp_buffer* buffer)
+{
+	return buffer->buffer.step(env->batch) ? 1 : 0;
+}
+
+int cp_buffer_save_npy(const cp_buffer* buffer, const char* prefix)
+{
+	if (prefix == nullptr)
+		return 0;
+
+	try {
+		std::string error;
+		return buffer->buffer.saveArrays(prefix, error) ? 1 : 0;
+	}
+	catch (...) {
+		return 0;
+	}
+}
+
+int cp_buffer_save_npz(const cp_buffer* buffer, const char* file_name)
+{
+	if (file_name == nullptr)
+		return 0;
+
+	try {
+		std::string error;
+		return buffer->buffer.saveArchive(file_name, error) ? 1 : 0;
+	}
+	catch (...) {
+		return 0;
+	}
+}
+
+cp_frames* cp_frames_open(const char* file_name, int batch_rows)
+{
+	if (file_name == nullptr || batch_rows < 0)
+		return nullptr;
+
+	try {
+		cp_frames* frames = new cp_frames(batch_rows > 0 ? batch_rows : 65536);
+		if (!frames->stream.open(file_name)) {
+			delete frames;
+			return nullptr;
+		}
+		return frames;
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+int cp_frames_add(cp_frames* frames, const cp_env* env, const double* forces)
+{
+	return frames->stream.add(env->batch, forces) ? 1 : 0;
+}
+
+int cp_frames_close(cp_frames* frames)
+{
+	int closed = frames->stream.close() ? 1 : 0;
+	delete frames;
+	return closed;
+}
\ No newline at end of file
@@ -0,0 +1,362 @@
+#pragma once
+#include <stdint.h>
+
+/* The simulator core as a library: a batch of environments stepped by the
+   caller, without a window, a message loop or an engine. The observations,
+   the rewards and the done flags are written to buffers owned by the caller;
+   the library keeps no copy of them. */
+
+#if defined(_WIN32)
+#if defined(CARTPOLECORE_EXPORTS)
+#define CP_API __declspec(dllexport)
+#else
+#define CP_API __declspec(dllimport)
+#endif
+#else
+#define CP_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Layout of the observation of one environment. */
+enum cp_observation {
+	CP_OBS_X = 0,
+	CP_OBS_DX = 1,
+	CP_OBS_THETA = 2,
+	CP_OBS_DTHETA = 3,
+	CP_OBS_PHI = 4,
+	CP_OBS_SIZE = 5
+};
+
+/* Values of the done flags: the rule that has ended the episode. */
+enum cp_done {
+	CP_RUNNING = 0,
+	CP_ANGLE_LIMIT = 1,
+	CP_POSITION_LIMIT = 2,
+	CP_TARGET_REACHED = 3,
+	CP_TIME_LIMIT = 4
+};
+
+/* Quantities sampled at the start of every episode. */
+enum cp_random {
+	CP_RANDOM_CART_MASS = 0,
+	CP_RANDOM_CART_DAMPING = 1,
+	CP_RANDOM_POLE_MASS = 2,
+	CP_RANDOM_POLE_SIZE = 3,
+	CP_RANDOM_POLE_DAMPING = 4,
+	CP_RANDOM_GRAVITY = 5,
+	CP_RANDOM_X = 6,
+	CP_RANDOM_DX = 7,
+	CP_RANDOM_THETA = 8,
+	CP_RANDOM_DTHETA = 9,
+	CP_RANDOM_COUNT = 10
+};
+
+enum cp_distribution_type {
+	CP_FIXED = 0,
+	CP_UNIFORM = 1,
+	CP_NORMAL = 2
+};
+
+typedef struct cp_crater {
+	double x;
+	double width;
+	double depth;
+} cp_crater;
+
+/* Uniform in [a, b] or normal with the mean a and the standard deviation b.
+   A fixed value keeps the value of the configuration (0 for the state). */
+typedef struct cp_distribution {
+	int type;
+	double a;
+	double b;
+} cp_distribution;
+
+/* The meaning of the fields is the one of the simulator parameters. A limit
+   of 0 disables the rule. */
+typedef struct cp_config {
+	int num_envs;
+	int action_frequency;
+	double gravity;
+	double cart_size;
+	double cart_mass;
+	double cart_damping;
+	double pole_size;
+	double pole_mass;
+	double pole_damping;
+	const cp_crater* craters; /* ends with a crater of width 0; NULL for a flat floor */
+	double angle_limit;
+	double position_limit;
+	double max_episode_time;
+	double target_x;
+	double target_width;
+	double step_reward;
+	double target_reward;
+	uint64_t seed;
+	uint64_t stream; /* stream of the first environment; the others follow */
+	cp_distribution random[CP_RANDOM_COUNT];
+} cp_config;
+
+/* The physical parameters of one environment. */
+typedef struct cp_physics {
+	double cart_mass;
+	double cart_damping;
+	double pole_mass;
+	double pole_size;
+	double pole_damping;
+	double gravity;
+} cp_physics;
+
+/* The state of one environment after a tick of cp_run_sequence. */
+typedef struct cp_state {
+	double x;
+	double y;
+	double phi;
+	double dx;
+	double ddx;
+	double theta;
+	double dtheta;
+	double ddtheta;
+} cp_state;
+
+/* Cost of a sequence of forces: the sum over the ticks of e'Q e + R F^2,
+   plus e'Qf e after the last tick, where e is the state (x, dx, theta,
+   dtheta) less the target, with the angle wrapped to [-pi, pi). The
+   matrices are 4x4, row by row. */
+typedef struct cp_cost {
+	double target[4];
+	double Q[16];
+	double R;
+	double Qf[16];
+} cp_cost;
+
+/* Settings of cp_optimize_sequence: the maximum number of iterations, the
+   bound on the magnitude of the forces (0 for none) and the relative
+   improvement of the cost below which the optimiser stops. */
+typedef struct cp_optimizer_settings {
+	int iterations;
+	double force_limit;
+	double tolerance;
+} cp_optimizer_settings;
+
+typedef struct cp_episode {
+	int number;
+	int length;
+	double time;
+	double episode_return;
+	int done;
+} cp_episode;
+
+/* The grid of a transition table: count points from min to max, both
+   included (count >= 2), on the axes x, dx, theta and dtheta, and the forces
+   of the actions. */
+typedef struct cp_table_grid {
+	double min[4];
+	double max[4];
+	int count[4];
+	const double* forces;
+	int num_forces;
+} cp_table_grid;
+
+/* The cell of a state off the grid of a transition table. */
+#define CP_TABLE_OUTSIDE 0xFFFFFFFFu
+
+/* A transition of a table: the state (x, dx, theta, dtheta) after one action
+   period and the cell nearest to it. */
+typedef struct cp_transition {
+	float next[4];
+	uint32_t cell;
+} cp_transition;
+
+typedef struct cp_env cp_env;
+typedef struct cp_policy cp_policy;
+typedef struct cp_table cp_table;
+typedef struct cp_episodes cp_episodes;
+typedef struct cp_buffer cp_buffer;
+typedef struct cp_frames cp_frames;
+
+/* The physics of the simulator, and the classic rules of the balancing task:
+   the pole within 12 degrees, the cart within 2.4 m and episodes of 10 s. */
+CP_API void cp_default_config(cp_config* config);
+
+/* Returns NULL if the configuration is invalid. The craters are not used
+   after the call. */
+CP_API cp_env* cp_create(const cp_config* config);
+CP_API void cp_destroy(cp_env* env);
+CP_API int cp_num_envs(const cp_env* env);
+
+/* Gives an environment its own physical parameters instead of those of the
+   configuration, at once and for its next episodes, e.g. for robustness
+   studies; the randomised quantities are still sampled at the start of
+   every episode. Environments that share the configuration's parameters are
+   stepped on a faster path. Returns 0 if the index is invalid. */
+CP_API int cp_set_physics(cp_env* env, int index, const cp_physics* physics);
+
+/* Starts a new episode in every environment. The observations hold
+   num_envs * CP_OBS_SIZE values and may be NULL. */
+CP_API void cp_reset(cp_env* env, double* observations);
+
+/* Applies one force per environment for 1 / action_frequency seconds. The
+   rewards and the dones hold num_envs values; any output may be NULL. An
+   environment whose episode has ended is reset right away: its observation
+   is then the first one of the next episode. */
+CP_API void cp_step(cp_env* env, const double* forces, double* observations, double* rewards, uint8_t* dones);
+
+/* Applies k forces per environment in open loop, for planners that know the
+   actions in advance: no rewards, no termination rules and no resets. The
+   sequences run on copies of the states; the environments and their
+   episodes are not changed. The forces (k * num_envs) and the trajectory
+   (k * num_envs states; may be NULL) are laid out tick by tick, one value
+   per environment in every tick. */
+CP_API void cp_run_sequence(cp_env* env, const double* forces, int k, cp_state* trajectory);
+
+/* For sampling-based planners: applies m sequences of k forces (m * k values,
+   one sequence after the other) to copies of the state of an environment and
+   writes the cost of every sequence (m values). The environment is not
+   changed. Returns 1, or 0 if the index is invalid, m is not positive or a
+   pointer is NULL. */
+CP_API int cp_evaluate_sequences(const cp_env* env, int index, const double* forces, int m, int k, const cp_cost* cost, double* costs);
+
+/* For model-predictive control: optimises k forces from the state of an
+   environment for the cost with iLQR on the simulator dynamics. The forces
+   hold the initial guess (e.g. the previous plan shifted by one action) and
+   receive the optimised forces, whose cost is written to result (may be
+   NULL). The environment is not changed. Returns the number of iterations
+   (0 if the index is invalid or forces, cost or settings is NULL). */
+CP_API int cp_optimize_sequence(const cp_env* env, int index, double* forces, int k, const cp_cost* cost, const cp_optimizer_settings* settings, double* result);
+
+/* The last finished episode of an environment; returns 0 if there is none. */
+CP_API int cp_last_episode(const cp_env* env, int index, cp_episode* episode);
+
+/* Loads a policy file: a small network that maps an observation to a force
+   (see the README for the layout). Returns NULL if the file cannot be read
+   or is not a valid policy. */
+CP_API cp_policy* cp_policy_load(const char* file_name);
+CP_API void cp_policy_destroy(cp_policy* policy);
+
+/* Computes the forces of count observations (count * CP_OBS_SIZE values),
+   e.g. those of all the environments written by cp_reset or cp_step, so
+   that the forces may be given straight to the next cp_step. */
+CP_API void cp_policy_forces(const cp_policy* policy, const double* observations, int count, double* forces);
+
+/* Runs one episode per environment until the termination rules end them
+   all, e.g. to evaluate a policy: an environment whose episode has ended is
+   not reset but dropped. The running environments are kept dense by
+   compacting their lanes from time to time; cp_episodes_ids gives the
+   environment of every lane. Returns NULL if the configuration is invalid. */
+CP_API cp_episodes* cp_episodes_create(const cp_config* config);
+CP_API void cp_episodes_destroy(cp_episodes* episodes);
+
+/* Compacts the lanes after a step that leaves more than the fraction of them
+   ended (0.125 by default; 0 after every step that ends an episode). */
+CP_API void cp_episodes_set_compaction(cp_episodes* episodes, double fraction);
+
+/* As cp_set_physics, from the next cp_episodes_start. */
+CP_API int cp_episodes_set_physics(cp_episodes* episodes, int index, const cp_physics* physics);
+
+/* Starts an episode in every environment and returns the number of lanes
+   (num_envs): the lane i holds the environment i. The observations hold
+   num_envs * CP_OBS_SIZE values and may be NULL. */
+CP_API int cp_episodes_start(cp_episodes* episodes, double* observations);
+
+/* Applies one force per lane (as many as the lanes returned by the previous
+   call) and returns the number of lanes after the step, 0 once every episode
+   has ended. The observations are written per lane, for the next forces; the
+   rewards and the dones are indexed by the environment and written only for
+   the episodes that were running. Any output may be NULL. */
+CP_API int cp_episodes_step(cp_episodes* episodes, const double* forces, double* observations, double* rewards, uint8_t* dones);
+
+/* The environment of every lane, valid until the next step. */
+CP_API const int* cp_episodes_ids(const cp_episodes* episodes);
+
+/* The episode of an environment so far; returns 0 if the index is invalid or
+   no episode has started. */
+CP_API int cp_episodes_result(const cp_episodes* episodes, int index, cp_episode* episode);
+
+/* Computes the transitions of every point of the grid under every force,
+   for one action period of the physics, the terrain and the action frequency
+   of the configuration (the randomisation is not used), on the given number
+   of threads (0 for one per core), and writes the table to a file. Returns 0
+   if the configuration or the grid is invalid or the file cannot be written. */
+CP_API int cp_table_build(const cp_config* config, const cp_table_grid* grid, int threads, const char* file_name);
+
+/* Maps a table file read-only; processes that open the same file share its
+   memory. Returns NULL if the file is not a valid table. */
+CP_API cp_table* cp_table_open(const char* file_name);
+CP_API void cp_table_close(cp_table* table);
+CP_API uint32_t cp_table_num_cells(const cp_table* table);
+CP_API int cp_table_num_actions(const cp_table* table);
+
+/* The cell nearest to a state (x, dx, theta, dtheta), e.g. the first values
+   of an observation, or CP_TABLE_OUTSIDE; and the grid point of a cell. */
+CP_API uint32_t cp_table_cell(const cp_table* table, const double* state);
+CP_API void cp_table_state(const cp_table* table, uint32_t cell, double* state);
+
+/* The num_cells * num_actions transitions, cell by cell, valid until the
+   table is closed; the transition of an action from a cell is at
+   cell * num_actions + action. cp_table_next returns its cell, and
+   CP_TABLE_OUTSIDE for CP_TABLE_OUTSIDE or any other cell or action off
+   the table. */
+CP_API const cp_transition* cp_table_transitions(const cp_table* table);
+CP_API uint32_t cp_table_next(const cp_table* table, uint32_t cell, int action);
+
+/* A rollout buffer: the observations, the actions, the rewards and the
+   dones of num_envs environments over up to `steps` steps, one array per
+   quantity, step after step and environment after environment. Returns NULL
+   if the sizes are invalid or the memory cannot be allocated. */
+CP_API cp_buffer* cp_buffer_create(int steps, int num_envs);
+CP_API void cp_buffer_destroy(cp_buffer* buffer);
+
+/* Empties the buffer; the last observations become the first ones, so that
+   the rollouts go on where they stopped. */
+CP_API void cp_buffer_clear(cp_buffer* buffer);
+
+/* The steps filled since the buffer was cleared. */
+CP_API int cp_buffer_size(const cp_buffer* buffer);
+
+/* The num_envs * CP_OBS_SIZE observations before the next step, for the
+   policy, and the num_envs actions of the next step, to be written before
+   cp_step_buffer (NULL once the buffer is full). */
+CP_API const double* cp_buffer_observations(const cp_buffer* buffer);
+CP_API double* cp_buffer_actions(cp_buffer* buffer);
+
+/* Empties the buffer and resets the environments into its first
+   observations. Returns 0 if the buffer is not of num_envs environments. */
+CP_API int cp_reset_buffer(cp_env* env, cp_buffer* buffer);
+
+/* As cp_step with the actions of the next step of the buffer, writing the
+   observations, the rewards and the dones straight into it. Returns 0,
+   without stepping, if the buffer is full or not of num_envs environments. */
+CP_API int cp_step_buffer(cp_env* env, cp_buffer* buffer);
+
+/* Writes the filled steps to prefix + "observations.npy", "actions.npy",
+   "rewards.npy" and "dones.npy" (shapes (size + 1, num_envs, CP_OBS_SIZE),
+   then (size, num_envs) of float64 and of uint8 for the dones), which
+   np.load(mmap_mode='r') maps without reading; or all four into one .npz
+   archive (at most 4 GiB), which NumPy reads. Return 0 on failure. */
+CP_API int cp_buffer_save_npy(const cp_buffer* buffer, const char* prefix);
+CP_API int cp_buffer_save_npz(const cp_buffer* buffer, const char* file_name);
+
+/* An Arrow IPC stream of frames, with the columns episode, environment and
+   frame (int32), then time, F, x, y, theta, phi, dx, ddx, dtheta, ddtheta,
+   camerax, cameray and zoom (float64), as the recordings of the simulator
+   write them. The frames of an episode are numbered from 1 in both, and
+   frame n is the state at the time (n - 1) * dt, before the nth step of
+   the episode. The frames are written as a record batch every batch_rows
+   frames (65536 if 0). Returns NULL if the file cannot be created. */
+CP_API cp_frames* cp_frames_open(const char* file_name, int batch_rows);
+
+/* Adds one frame per environment: its state before a step with the forces,
+   and its episode, frame and time within the episode; call it before
+   cp_step with the same forces. Returns 0 once a write has failed. */
+CP_API int cp_frames_add(cp_frames* frames, const cp_env* env, const double* forces);
+
+/* Writes the remaining frames and the end of the stream and frees the
+   stream; returns 0 if a write has failed. */
+CP_API int cp_frames_close(cp_frames* frames);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
@@ -1,112 +1,262 @@
-#pragma once
-
-enum UIType {
-	GUI = 0,
-	CONSOLE = 1
-};
-
-enum ActionOptions {
-	APPLY_NO_ACTION = 0,
-	APPLY_FORCE = 1,
-	APPLY_MANUAL_ACTION = 2,
-	APPLY_FORCE_IF_NO_MANUAL_ACTION = 3
-};
-
-enum SimulationAction {
-	NO_SIMULATION_ACTION = 0,
-	RESET_SIMULATION = 1,
-	TERMINATE_SIMULATION = 2
-};
-
-enum CameraAction {
-	NO_CAMERA_ACTION = 0,
-	UPDATE_CAMERA = 1
-};
-
-enum KeyState {
-	UNPRESSED = 0,
-	PRESSED = 1
-};
-
-typedef struct {
-	double size;
-	double mass;
-	double damping;
-} ObjectParameters;
-
-typedef struct {
-	double x;
-	double y;
-	double zoom;
-} CameraParameters;
-
-typedef struct {
-	double x;
-	double width;
-	unsigned char red;
-	unsigned char green;
-	unsigned char blue;
-} Marker;
-
-typedef struct {
-	double x;
-	double width;
-	double depth;
-} Crater;
-
-typedef struct {
-	char** argv;
-	int argc;
-	UIType applicationType;
-	const char* engineName;
-	int windowWidth;
-	int windowHeight;
-	int actionFrequency;
-	int simulationSpeed;
-	double gravity;
-	double manualForce;
-	ObjectParameters cart;
-	ObjectParameters pole;
-	CameraParameters camera;
-	const Crater* craters;
-	const Marker* markers;
-	char* pLogBuffer;
-	const char* logFilename;
-} SimulatorParameters;
-
-typedef struct {
-	CameraParameters cameraParameters;
-	CameraAction cameraAction;
-	SimulationAction simulationAction;
-} SimulationParameters;
-
-typedef struct {
-	double x;
-	double dx;
-	double ddx;
-	double theta;
-	double dtheta;
-	double ddtheta;
-} InitialState;
-
-typedef struct {
-	double x;
-	double y;
-	double phi;
-	double dx;
-	double ddx;
-	double theta;
-	double dtheta;
-	double ddtheta;
-} SimulationState;
-
-typedef struct {
-	double force;
-	ActionOptions options;
-} CartAction;
-
-typedef struct {
-	unsigned int code;
-	char character;
-	KeyState state;
+#pragma once
+
+enum UIType {
+	GUI = 0,
+	CONSOLE = 1
+};
+
+enum ActionOptions {
+	APPLY_NO_ACTION = 0,
+	APPLY_FORCE = 1,
+	APPLY_MANUAL_ACTION = 2,
+	APPLY_FORCE_IF_NO_MANUAL_ACTION = 3
+};
+
+enum SimulationAction {
+	NO_SIMULATION_ACTION = 0,
+	RESET_SIMULATION = 1,
+	TERMINATE_SIMULATION = 2
+};
+
+enum CameraAction {
+	NO_CAMERA_ACTION = 0,
+	UPDATE_CAMERA = 1
+};
+
+enum KeyState {
+	UNPRESSED = 0,
+	PRESSED = 1
+};
+
+enum LogLevel {
+	LOG_DEBUG = 0,
+	LOG_INFO = 1,
+	LOG_WARNING = 2,
+	LOG_ERROR = 3
+};
+
+enum FlightRecorderTrigger {
+	DUMP_MANUALLY = 0,
+	DUMP_ON_RESET = 1,
+	DUMP_ON_TERMINATE = 2
+};
+
+enum TerminationReason {
+	NOT_TERMINATED = 0,
+	ANGLE_LIMIT = 1,
+	POSITION_LIMIT = 2,
+	TARGET_REACHED = 3,
+	TIME_LIMIT = 4,
+	RESET_REQUESTED = 5,
+	TERMINATE_REQUESTED = 6
+};
+
+enum DistributionType {
+	FIXED_VALUE = 0,
+	UNIFORM_DISTRIBUTION = 1,
+	NORMAL_DISTRIBUTION = 2
+};
+
+typedef struct {
+	double size;
+	double mass;
+	double damping;
+} ObjectParameters;
+
+typedef struct {
+	double x;
+	double y;
+	double zoom;
+} CameraParameters;
+
+typedef struct {
+	double x;
+	double width;
+	unsigned char red;
+	unsigned char green;
+	unsigned char blue;
+} Marker;
+
+typedef struct {
+	double x;
+	double width;
+	double depth;
+} Crater;
+
+/* Rules checked by the simulator after every tick. A limit of 0 disables
+   the rule; the action is taken when any rule applies (NO_SIMULATION_ACTION
+   disables them all). */
+typedef struct {
+	double angleLimit;
+	double positionLimit;
+	double maxEpisodeTime;
+	double targetX;
+	double targetWidth;
+	double stepReward;
+	double targetReward;
+	SimulationAction action;
+} TerminationRules;
+
+/* Uniform in [a, b] or normal with the mean a and the standard deviation b.
+   A fixed value keeps the value of the simulator parameters (or the one
+   given by the engine in setInitialState). */
+typedef struct {
+	DistributionType type;
+	double a;
+	double b;
+} Distribution;
+
+/* Distributions sampled on every reset. The seed and the stream select
+   a reproducible sequence of episodes; environments of a batch use
+   different streams. */
+typedef struct {
+	unsigned long long seed;
+	unsigned long long stream;
+	Distribution cartMass;
+	Distribution cartDamping;
+	Distribution poleMass;
+	Distribution poleSize;
+	Distribution poleDamping;
+	Distribution gravity;
+	Distribution x;
+	Distribution dx;
+	Distribution theta;
+	Distribution dtheta;
+} Randomization;
+
+typedef struct {
+	int number;
+	int length;
+	double time;
+	double episodeReturn;
+	TerminationReason reason;
+} EpisodeStatistics;
+
+typedef struct {
+	double x;
+	double y;
+	double phi;
+	double dx;
+	double ddx;
+	double theta;
+	double dtheta;
+	double ddtheta;
+} SimulationState;
+
+/* One environment of the mosaic view: its state, its own camera and its terrain.
+   The terrain of a tile is recomputed only when craters or cratersVersion
+   change; increase the version when the crater list is changed in place. */
+typedef struct {
+	SimulationState state;
+	CameraParameters camera;
+	const Crater* craters;
+	unsigned int cratersVersion;
+} MosaicTile;
+
+/* Writes a log record (level, text, optional binary payload and its size in bytes).
+   Safe to call from any thread; returns 0 if the record had to be dropped.
+   The text and the payload share 232 bytes per record: a longer text is cut
+   off there, and the payload gets what the text leaves. Log longer texts in
+   several calls. */
+typedef int (__cdecl* FunctionLogRecord)(LogLevel, const char*, const void*, int);
+
+/* Simulates the cart from a state under k forces, one per action period,
+   without calling back the engine; the simulation itself is not affected.
+   Writes the k states to the trajectory and returns k (0 if not available). */
+typedef int (__cdecl* FunctionRunSequence)(const SimulationState*, const double*, int, SimulationState*);
+
+/* Cost of a sequence of forces: the sum over the ticks of e'Q e + R F^2,
+   plus e'Qf e after the last tick, where e is the state (x, dx, theta,
+   dtheta) less the target, with the angle wrapped to [-pi, pi). The
+   matrices are 4x4, row by row. */
+typedef struct {
+	double target[4];
+	double Q[16];
+	double R;
+	double Qf[16];
+} QuadraticCost;
+
+/* Simulates m sequences of k forces (one sequence after the other) from
+   the same state, like FunctionRunSequence, and writes the cost of every
+   sequence. Returns m (0 if not available). */
+typedef int (__cdecl* FunctionEvaluateSequences)(const SimulationState*, const double*, int, int, const QuadraticCost*, double*);
+
+/* Settings of the trajectory optimiser: the maximum number of iterations,
+   the bound on the magnitude of the forces (0 for none) and the relative
+   improvement of the cost below which the optimiser stops. */
+typedef struct {
+	int iterations;
+	double forceLimit;
+	double tolerance;
+} OptimizerSettings;
+
+/* Optimises k forces, one per action period, from a state for the cost
+   with iLQR on the dynamics of the simulation. The forces hold the initial
+   guess on entry (e.g. the previous plan shifted by one period) and the
+   optimised forces on return; the cost of the result is written to the last
+   argument (may be null). Returns the number of iterations (0 if not
+   available). */
+typedef int (__cdecl* FunctionOptimizeSequence)(const SimulationState*, double*, int, const QuadraticCost*, const OptimizerSettings*, double*);
+
+typedef struct {
+	char** argv;
+	int argc;
+	UIType applicationType;
+	const char* engineName;
+	int windowWidth;
+	int windowHeight;
+	int actionFrequency;
+	int simulationSpeed;
+	double gravity;
+	double manualForce;
+	ObjectParameters cart;
+	ObjectParameters pole;
+	CameraParameters camera;
+	const Crater* craters;
+	const Marker* markers;
+	char* pLogBuffer;
+	const char* logFilename;
+	double flightRecorderDuration;
+	int flightRecorderTriggers;
+	FunctionLogRecord logRecord;
+	int renderFrequency;
+	const SimulationState* batchStates;
+	int batchSize;
+	const MosaicTile* mosaicTiles;
+	int mosaicSize;
+	int mosaicColumns;
+	TerminationRules termination;
+	Randomization randomization;
+	const char* checkpointFilename;
+	double checkpointInterval;
+	FunctionRunSequence runSequence;
+	FunctionEvaluateSequences evaluateSequences;
+	FunctionOptimizeSequence optimizeSequence;
+	const char* policyFilename;
+} SimulatorParameters;
+
+typedef struct {
+	CameraParameters cameraParameters;
+	CameraAction cameraAction;
+	SimulationAction simulationAction;
+} SimulationParameters;
+
+typedef struct {
+	double x;
+	double dx;
+	double ddx;
+	double theta;
+	double dtheta;
+	double ddtheta;
+} InitialState;
+
+typedef struct {
+	double force;
+	ActionOptions options;
+} CartAction;
+
+typedef struct {
+	unsigned int code;
+	char character;
+	KeyState state;
 } KeyInfo;
\ No newline at end of file